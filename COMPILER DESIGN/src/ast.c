@@ -53,12 +53,6 @@ static char* int_to_str(int value) {
 }
 
 
-static char* char_to_str(char c) {
-    char buffer[2] = {c, '\0'};
-    return strdup(buffer);
-}
-
-
 ASTNode* make_int_node(int value) {
     char* val_str = int_to_str(value);
     ASTNode* node = create_node(NODE_INT, val_str);
@@ -77,10 +71,8 @@ ASTNode* make_var_node(char* name) {
 }
 
 
-ASTNode* make_binop_node(char op, ASTNode* left, ASTNode* right) {
-    char* op_str = char_to_str(op);
-    ASTNode* node = create_node(NODE_BINOP, op_str);
-    free(op_str);
+ASTNode* make_binop_node(Operator op, ASTNode* left, ASTNode* right) {
+    ASTNode* node = create_node(NODE_BINOP, operator_info(op)->spelling);
     
     node->left = left;
     node->right = right;
@@ -89,8 +81,8 @@ ASTNode* make_binop_node(char op, ASTNode* left, ASTNode* right) {
 }
 
 
-ASTNode* make_unary_node(char* op, ASTNode* expr) {
-    ASTNode* node = create_node(NODE_UNARY, op);
+ASTNode* make_unary_node(Operator op, ASTNode* expr) {
+    ASTNode* node = create_node(NODE_UNARY, operator_info(op)->spelling);
     node->left = expr;
     return node;
 }
@@ -103,9 +95,25 @@ ASTNode* make_decl_node(char* name, ASTNode* init_expr) {
 }
 
 
+// name = expr; the value is the only child
+ASTNode* make_assign_node(char* name, ASTNode* expr) {
+    ASTNode* node = create_node(NODE_ASSIGN, name);
+    node->left = expr;
+    return node;
+}
+
+
 ASTNode* make_func_call_node(char* name, ASTNode* args) {
     ASTNode* node = create_node(NODE_FUNC_CALL, name);
-    node->left = args;  
+    // The grammar chains the arguments last to first; store them in order
+    ASTNode* ordered = NULL;
+    while (args) {
+        ASTNode* next = args->next;
+        args->next = ordered;
+        ordered = args;
+        args = next;
+    }
+    node->left = ordered;
     return node;
 }
 
@@ -177,6 +185,7 @@ const char* get_node_type_str(NodeType type) {
         case NODE_STRING: return "STRING";
         case NODE_VAR: return "VAR";
         case NODE_DECL: return "DECLARATION";
+        case NODE_ASSIGN: return "ASSIGNMENT";
         case NODE_BINOP: return "BINARY_EXPR";
         case NODE_UNARY: return "UNARY_EXPR";
         case NODE_FUNC_CALL: return "FUNCTION_CALL";
@@ -192,20 +201,28 @@ const char* get_node_type_str(NodeType type) {
 }
 
 
-void print_ast(ASTNode* node, FILE* output, int indent) {
+void print_ast(ASTNode* node, Emitter* output, int indent) {
     if (!node) return;
     
 
-    for (int i = 0; i < indent; i++) {
-        fprintf(output, "  ");
-    }
+    emit_indent(output, 2 * indent);
     
 
-    fprintf(output, "%s", get_node_type_str(node->type));
+    emit_str(output, get_node_type_str(node->type));
     if (node->value) {
-        fprintf(output, " (%s)", node->value);
+        emit_str(output, " (");
+        emit_str(output, node->value);
+        emit_char(output, ')');
+    }
+    emit_char(output, '\n');
+
+    // One EXPR_LIST holds every argument of a call, in order
+    if (node->type == NODE_EXPR_LIST) {
+        for (ASTNode* item = node; item; item = item->next) {
+            print_ast(item->left, output, indent + 1);
+        }
+        return;
     }
-    fprintf(output, "\n");
 
     if (node->left) {
         print_ast(node->left, output, indent + 1);
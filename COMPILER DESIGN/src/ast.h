@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "ops.h"
+#include "emit.h"
 
 
 typedef enum {
@@ -11,6 +13,7 @@ typedef enum {
     NODE_STRING,
     NODE_VAR,
     NODE_DECL,
+    NODE_ASSIGN,
     NODE_BINOP,
     NODE_UNARY,
     NODE_FUNC_CALL,
@@ -40,12 +43,14 @@ ASTNode* make_string_node(char* value);
 
 ASTNode* make_var_node(char* name);
 
-ASTNode* make_binop_node(char op, ASTNode* left, ASTNode* right);
+ASTNode* make_binop_node(Operator op, ASTNode* left, ASTNode* right);
 
-ASTNode* make_unary_node(char* op, ASTNode* expr);
+ASTNode* make_unary_node(Operator op, ASTNode* expr);
 
 ASTNode* make_decl_node(char* name, ASTNode* init_expr);
 
+ASTNode* make_assign_node(char* name, ASTNode* expr);
+
 ASTNode* make_func_call_node(char* name, ASTNode* args);
 
 ASTNode* make_function_node(char* name, ASTNode* body);
@@ -73,6 +78,6 @@ void add_sibling(ASTNode* node, ASTNode* sibling);
 void free_ast(ASTNode* node);
 
 
-void print_ast(ASTNode* node, FILE* output, int indent);
+void print_ast(ASTNode* node, Emitter* output, int indent);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,906 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include "ops.h"
+
+/*
+    Compiles an AST dump (newOutput.txt by default) to x86-64 machine code
+    in memory and runs it in-process, for evaluating a program without a
+    C compiler. The exit status is the program's return value, and the
+    compile and run times are reported on stderr.
+
+    Code is generated in one pass over the AST, template style: every
+    variable and temporary gets its own 8-byte slot in the frame, and
+    expressions are computed in %eax with constants and variables used
+    directly as immediate and memory operands. Calls go to the addresses
+    dlsym resolves in the running process, so printf and friends are the
+    real libc functions. The code is written to an anonymous mapping that
+    is made executable (and read-only) only once it is complete.
+*/
+
+#if !defined(__x86_64__) || defined(_WIN32)
+#error "ast_jit generates x86-64 code for the System V ABI"
+#endif
+
+
+#define MAX_LINE_LEN 256
+
+typedef enum {
+    NODE_FUNCTION_DEF,
+    NODE_SEQUENCE,
+    NODE_DECLARATION,
+    NODE_ASSIGNMENT,
+    NODE_INT,
+    NODE_BINARY_EXPR,
+    NODE_VAR,
+    NODE_IF_STMT,
+    NODE_FUNCTION_CALL,
+    NODE_EXPR_LIST,
+    NODE_FOR_STMT,
+    NODE_UNARY_EXPR,
+    NODE_RETURN_STMT,
+    NODE_STRING,
+    NODE_REPEAT,
+    NODE_UNKNOWN
+} NodeType;
+
+typedef struct ASTNode {
+    NodeType type;
+    char *name;
+    int int_value;
+    char *string_value;
+    Operator op;
+    struct ASTNode **children;
+    int child_count;
+    int child_capacity;
+} ASTNode;
+
+/* Forward declarations */
+ASTNode *parse_ast(FILE *f);
+void free_ast(ASTNode *node);
+void append_child(ASTNode *parent, ASTNode *child);
+
+/* Helper function to skip spaces */
+void skip_spaces(const char **str) {
+    while (**str == ' ' || **str == '\t') (*str)++;
+}
+
+/* Helper to count the leading spaces */
+int count_leading_spaces(const char *line) {
+    int count = 0;
+    while (*line == ' ') {
+        count++;
+        line++;
+    }
+    return count;
+}
+
+/* Convert string to NodeType */
+NodeType node_type_from_string(const char *str) {
+    if (strcmp(str, "FUNCTION_DEF") == 0) return NODE_FUNCTION_DEF;
+    if (strcmp(str, "SEQUENCE") == 0) return NODE_SEQUENCE;
+    if (strcmp(str, "DECLARATION") == 0) return NODE_DECLARATION;
+    if (strcmp(str, "ASSIGNMENT") == 0) return NODE_ASSIGNMENT;
+    if (strcmp(str, "INT") == 0) return NODE_INT;
+    if (strcmp(str, "BINARY_EXPR") == 0) return NODE_BINARY_EXPR;
+    if (strcmp(str, "VAR") == 0) return NODE_VAR;
+    if (strcmp(str, "IF_STMT") == 0) return NODE_IF_STMT;
+    if (strcmp(str, "FUNCTION_CALL") == 0) return NODE_FUNCTION_CALL;
+    if (strcmp(str, "EXPR_LIST") == 0) return NODE_EXPR_LIST;
+    if (strcmp(str, "FOR_STMT") == 0) return NODE_FOR_STMT;
+    if (strcmp(str, "UNARY_EXPR") == 0) return NODE_UNARY_EXPR;
+    if (strcmp(str, "RETURN_STMT") == 0) return NODE_RETURN_STMT;
+    if (strcmp(str, "STRING") == 0) return NODE_STRING;
+    if (strcmp(str, "REPEAT") == 0) return NODE_REPEAT;
+    return NODE_UNKNOWN;
+}
+
+/* Parse a line in the AST text and (optionally) extract an argument */
+NodeType parse_line(const char *line, char **arg) {
+    *arg = NULL;
+    const char *p = line;
+
+    char type_buf[64];
+    int i = 0;
+    while (*p && *p != ' ' && *p != '(' && *p != '\n' && i < 63) {
+        type_buf[i++] = *p++;
+    }
+    type_buf[i] = 0;
+    NodeType t = node_type_from_string(type_buf);
+    if (t == NODE_UNKNOWN) return NODE_UNKNOWN;
+
+    skip_spaces(&p);
+    if (*p == '(') {
+        p++;
+        const char *start = p;
+        while (*p && *p != ')') p++;
+        if (*p != ')') return NODE_UNKNOWN;
+        int len = (int)(p - start);
+        *arg = malloc(len + 1);
+        strncpy(*arg, start, len);
+        (*arg)[len] = 0;
+    }
+    return t;
+}
+
+/* Remove the quote characters the AST printers wrap around string literals */
+void strip_outer_quotes(char *s) {
+    int len = (int)strlen(s);
+    int start = 0, end = len - 1;
+    while (start < len && s[start] == '"') start++;
+    while (end >= start && s[end] == '"') end--;
+    int new_len = end - start + 1;
+    memmove(s, s + start, new_len);
+    s[new_len] = 0;
+}
+
+/* Recursively parse the AST from a file */
+ASTNode *parse_ast_recursive(FILE *f, int current_indent) {
+    char line[MAX_LINE_LEN];
+    long last_pos = ftell(f);
+    if (!fgets(line, MAX_LINE_LEN, f)) return NULL;
+
+    int indent = count_leading_spaces(line);
+    if (indent < current_indent) {
+        fseek(f, last_pos, SEEK_SET);
+        return NULL;
+    }
+    if (indent > current_indent) {
+        fprintf(stderr, "Unexpected indentation\n");
+        return NULL;
+    }
+
+    char *arg = NULL;
+    char *trim_line = line + indent;
+    NodeType t = parse_line(trim_line, &arg);
+    if (t == NODE_UNKNOWN) {
+        fprintf(stderr, "Unknown node type in line: %s\n", trim_line);
+        if (arg) free(arg);
+        return NULL;
+    }
+
+    ASTNode *node = calloc(1, sizeof(ASTNode));
+    node->type = t;
+
+    if (arg) {
+        switch (t) {
+            case NODE_FUNCTION_DEF:
+            case NODE_DECLARATION:
+            case NODE_ASSIGNMENT:
+            case NODE_VAR:
+            case NODE_FUNCTION_CALL:
+            case NODE_REPEAT:
+                node->name = arg;
+                break;
+            case NODE_BINARY_EXPR:
+            case NODE_UNARY_EXPR:
+                node->op = operator_from_spelling(arg);
+                free(arg);
+                break;
+            case NODE_INT:
+                node->int_value = atoi(arg);
+                free(arg);
+                break;
+            case NODE_STRING:
+                node->string_value = arg;
+                strip_outer_quotes(node->string_value);
+                break;
+            default:
+                free(arg);
+                break;
+        }
+    }
+
+    while (1) {
+        long pos_before = ftell(f);
+        ASTNode *child = parse_ast_recursive(f, current_indent + 2);
+        if (!child) {
+            fseek(f, pos_before, SEEK_SET);
+            break;
+        }
+        append_child(node, child);
+    }
+
+    return node;
+}
+
+/* Wrapper to parse AST from file */
+ASTNode *parse_ast(FILE *f) {
+    return parse_ast_recursive(f, 0);
+}
+
+/* Append a child, growing the child array as needed */
+void append_child(ASTNode *parent, ASTNode *child) {
+    if (parent->child_count == parent->child_capacity) {
+        int cap = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        ASTNode **grown = realloc(parent->children, cap * sizeof(ASTNode *));
+        if (!grown) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        parent->children = grown;
+        parent->child_capacity = cap;
+    }
+    parent->children[parent->child_count++] = child;
+}
+
+/* Free the AST recursively */
+void free_ast(ASTNode *node) {
+    if (!node) return;
+    if (node->name) free(node->name);
+    if (node->string_value) free(node->string_value);
+    for (int i = 0; i < node->child_count; i++) {
+        free_ast(node->children[i]);
+    }
+    free(node->children);
+    free(node);
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Machine code buffer                                                     */
+/* ---------------------------------------------------------------------- */
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11 };
+
+static const int arg_regs[] = { RDI, RSI, RDX, RCX, R8, R9 };
+#define ARG_REG_COUNT 6
+
+/* Condition codes, as in the low nibble of jcc/setcc */
+#define CC_E  0x4
+#define CC_NE 0x5
+#define CC_L  0xc
+#define CC_GE 0xd
+#define CC_ALWAYS -1
+
+typedef struct {
+    int at;                     /* offset of the rel32 to patch */
+    int label;
+} Fixup;
+
+typedef struct {
+    unsigned char *bytes;
+    int size, capacity;
+    int *labels;                /* label -> code offset */
+    int label_count, label_capacity;
+    Fixup *fixups;
+    int fixup_count, fixup_capacity;
+    char **strings;             /* decoded string literals the code points to */
+    int string_count, string_capacity;
+    int slot_count;             /* 8-byte frame slots below %rbp */
+    int return_label;
+} Jit;
+
+/* Grow a dense array so that it can hold at least needed elements */
+void *grow_array(void *data, int *capacity, int needed, size_t elem_size) {
+    if (needed <= *capacity) return data;
+    int cap = *capacity ? *capacity : 8;
+    while (cap < needed) cap *= 2;
+    data = realloc(data, cap * elem_size);
+    if (!data) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    *capacity = cap;
+    return data;
+}
+
+void code_byte(Jit *jit, int byte) {
+    jit->bytes = grow_array(jit->bytes, &jit->capacity, jit->size + 1, 1);
+    jit->bytes[jit->size++] = (unsigned char)byte;
+}
+
+void code_bytes(Jit *jit, const char *bytes, int n) {
+    for (int i = 0; i < n; i++) code_byte(jit, (unsigned char)bytes[i]);
+}
+
+void code_int32(Jit *jit, int32_t value) {
+    uint32_t v = (uint32_t)value;
+    for (int i = 0; i < 4; i++) code_byte(jit, (v >> (8 * i)) & 0xff);
+}
+
+void code_int64(Jit *jit, uint64_t value) {
+    for (int i = 0; i < 8; i++) code_byte(jit, (int)((value >> (8 * i)) & 0xff));
+}
+
+/* ModRM (and displacement) for the memory operand disp(%rbp) */
+void code_frame_operand(Jit *jit, int reg, int disp) {
+    if (disp >= -128 && disp <= 127) {
+        code_byte(jit, 0x45 | (reg & 7) << 3);
+        code_byte(jit, disp & 0xff);
+    } else {
+        code_byte(jit, 0x85 | (reg & 7) << 3);
+        code_int32(jit, disp);
+    }
+}
+
+/* REX prefix; omitted when it would be the plain 0x40 */
+void code_rex(Jit *jit, int wide, int reg, int rm) {
+    int rex = 0x40 | (wide ? 8 : 0) | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0);
+    if (rex != 0x40) code_byte(jit, rex);
+}
+
+/* movl disp(%rbp), %r32 or movq disp(%rbp), %r64 */
+void code_load(Jit *jit, int reg, int disp, int wide) {
+    code_rex(jit, wide, reg, 0);
+    code_byte(jit, 0x8b);
+    code_frame_operand(jit, reg, disp);
+}
+
+/* movq %rax, disp(%rbp) */
+void code_store_rax(Jit *jit, int disp) {
+    code_byte(jit, 0x48);
+    code_byte(jit, 0x89);
+    code_frame_operand(jit, RAX, disp);
+}
+
+/* movl $imm, %r32 (zero-extends into the full register) */
+void code_load_imm(Jit *jit, int reg, int32_t imm) {
+    code_rex(jit, 0, 0, reg);
+    code_byte(jit, 0xb8 + (reg & 7));
+    code_int32(jit, imm);
+}
+
+/* movabs $imm64, %r64 */
+void code_load_imm64(Jit *jit, int reg, uint64_t imm) {
+    code_rex(jit, 1, 0, reg);
+    code_byte(jit, 0xb8 + (reg & 7));
+    code_int64(jit, imm);
+}
+
+int new_label(Jit *jit) {
+    jit->labels = grow_array(jit->labels, &jit->label_capacity, jit->label_count + 1, sizeof(int));
+    jit->labels[jit->label_count] = -1;
+    return jit->label_count++;
+}
+
+void place_label(Jit *jit, int label) {
+    jit->labels[label] = jit->size;
+}
+
+/* jmp or jcc with a rel32 patched once the label is placed */
+void code_jump(Jit *jit, int cc, int label) {
+    if (cc == CC_ALWAYS) {
+        code_byte(jit, 0xe9);
+    } else {
+        code_byte(jit, 0x0f);
+        code_byte(jit, 0x80 | cc);
+    }
+    jit->fixups = grow_array(jit->fixups, &jit->fixup_capacity, jit->fixup_count + 1, sizeof(Fixup));
+    jit->fixups[jit->fixup_count].at = jit->size;
+    jit->fixups[jit->fixup_count].label = label;
+    jit->fixup_count++;
+    code_int32(jit, 0);
+}
+
+/* A fresh frame slot, as its displacement from %rbp */
+int new_slot(Jit *jit) {
+    return -8 * ++jit->slot_count;
+}
+
+/* Decode the C escapes of a string literal into the bytes it stands for */
+char *decode_string(const char *s) {
+    char *out = malloc(strlen(s) + 1);
+    char *p = out;
+    while (*s) {
+        int c = (unsigned char)*s++;
+        if (c == '\\' && *s) {
+            c = (unsigned char)*s++;
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'a': c = '\a'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                case 'x': {
+                    int value = 0;
+                    while ((*s >= '0' && *s <= '9') || (*s >= 'a' && *s <= 'f') || (*s >= 'A' && *s <= 'F')) {
+                        int digit = *s <= '9' ? *s - '0' : (*s | 0x20) - 'a' + 10;
+                        value = value * 16 + digit;
+                        s++;
+                    }
+                    c = value & 0xff;
+                    break;
+                }
+                default:
+                    if (c >= '0' && c <= '7') {
+                        int value = c - '0';
+                        for (int k = 0; k < 2 && *s >= '0' && *s <= '7'; k++) value = value * 8 + (*s++ - '0');
+                        c = value & 0xff;
+                    }
+                    break;
+            }
+        }
+        *p++ = (char)c;
+    }
+    *p = 0;
+    return out;
+}
+
+void free_jit(Jit *jit) {
+    for (int i = 0; i < jit->string_count; i++) free(jit->strings[i]);
+    free(jit->strings);
+    free(jit->bytes);
+    free(jit->labels);
+    free(jit->fixups);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Code generation                                                         */
+/* ---------------------------------------------------------------------- */
+
+typedef enum {
+    OPND_IMM,       /* value: 32-bit constant */
+    OPND_SLOT,      /* value: frame displacement */
+    OPND_PTR,       /* ptr: 64-bit constant address */
+    OPND_RAX,       /* computed into %rax */
+    OPND_RCX        /* moved to %rcx, to keep it while %rax is reused */
+} OperandKind;
+
+typedef struct {
+    OperandKind kind;
+    int value;
+    const void *ptr;
+} Operand;
+
+Operand make_operand(OperandKind kind, int value) {
+    Operand o = { kind, value, NULL };
+    return o;
+}
+
+/* Lexical scope: source names bound to a frame slot, or to a constant for
+   the induction variable of a REPEAT replica */
+typedef struct {
+    const char *name;
+    Operand value;
+} Binding;
+
+typedef struct {
+    Binding *bindings;
+    int count, capacity;
+} Scope;
+
+void scope_bind(Scope *s, const char *name, Operand value) {
+    s->bindings = grow_array(s->bindings, &s->capacity, s->count + 1, sizeof(Binding));
+    s->bindings[s->count].name = name;
+    s->bindings[s->count].value = value;
+    s->count++;
+}
+
+Binding *scope_lookup(Scope *s, const char *name) {
+    for (int i = s->count - 1; i >= 0; i--) {
+        if (strcmp(s->bindings[i].name, name) == 0) return &s->bindings[i];
+    }
+    return NULL;
+}
+
+/* The operand in %eax, or all of %rax for addresses */
+void load_rax(Jit *jit, Operand o) {
+    switch (o.kind) {
+        case OPND_IMM:
+            if (o.value == 0) code_bytes(jit, "\x31\xc0", 2);          /* xorl %eax, %eax */
+            else code_load_imm(jit, RAX, o.value);
+            break;
+        case OPND_SLOT:
+            code_load(jit, RAX, o.value, 1);
+            break;
+        case OPND_PTR:
+            code_load_imm64(jit, RAX, (uint64_t)(uintptr_t)o.ptr);
+            break;
+        case OPND_RCX:
+            code_bytes(jit, "\x48\x89\xc8", 3);                         /* movq %rcx, %rax */
+            break;
+        case OPND_RAX:
+            break;
+    }
+}
+
+/* Park a value computed in %rax in a frame slot, so %rax can be reused */
+Operand spill_rax(Jit *jit, Operand o) {
+    if (o.kind != OPND_RAX) return o;
+    int slot = new_slot(jit);
+    code_store_rax(jit, slot);
+    return make_operand(OPND_SLOT, slot);
+}
+
+/* One ALU instruction on %eax with b as immediate, memory or %ecx operand.
+   Opcodes per form, for add, sub, imul and cmp. */
+void code_alu(Jit *jit, Operator op, Operand b) {
+    static const struct {
+        Operator op;
+        const char *imm, *mem, *reg;
+    } forms[] = {
+        { OP_ADD, "\x05",     "\x03",     "\x01\xc8" },
+        { OP_SUB, "\x2d",     "\x2b",     "\x29\xc8" },
+        { OP_MUL, "\x69\xc0", "\x0f\xaf", "\x0f\xaf\xc1" },
+        { OP_LT,  "\x3d",     "\x3b",     "\x39\xc8" },
+    };
+    int f = 0;
+    while (forms[f].op != op) f++;
+    if (b.kind == OPND_IMM) {
+        code_bytes(jit, forms[f].imm, (int)strlen(forms[f].imm));
+        code_int32(jit, b.value);
+    } else if (b.kind == OPND_SLOT) {
+        code_bytes(jit, forms[f].mem, (int)strlen(forms[f].mem));
+        code_frame_operand(jit, RAX, b.value);
+    } else {
+        code_bytes(jit, forms[f].reg, (int)strlen(forms[f].reg));
+    }
+}
+
+Operand gen_expr(Jit *jit, Scope *scope, ASTNode *node, int want_result);
+
+/* Evaluate both operands of a binary node, leaving a in %eax and b as an
+   immediate, a slot or %ecx. Returns 1 with the value in *folded when
+   both are constants. */
+int gen_operands(Jit *jit, Scope *scope, ASTNode *node, Operand *b, int *folded) {
+    if (node->child_count != 2) {
+        fprintf(stderr, "Malformed binary expression\n");
+        exit(1);
+    }
+    Operand a = spill_rax(jit, gen_expr(jit, scope, node->children[0], 1));
+    *b = gen_expr(jit, scope, node->children[1], 1);
+    const OperatorInfo *info = operator_info(node->op);
+    if (a.kind == OPND_IMM && b->kind == OPND_IMM && info->fold && info->fold(a.value, b->value, folded))
+        return 1;
+    if (b->kind == OPND_RAX || b->kind == OPND_PTR) {
+        load_rax(jit, *b);
+        code_bytes(jit, "\x48\x89\xc1", 3);                             /* movq %rax, %rcx */
+        *b = make_operand(OPND_RCX, 0);
+    }
+    load_rax(jit, a);
+    return 0;
+}
+
+Operand gen_expr(Jit *jit, Scope *scope, ASTNode *node, int want_result) {
+    switch (node->type) {
+        case NODE_INT:
+            return make_operand(OPND_IMM, node->int_value);
+        case NODE_STRING: {
+            jit->strings = grow_array(jit->strings, &jit->string_capacity, jit->string_count + 1, sizeof(char *));
+            Operand o = make_operand(OPND_PTR, 0);
+            o.ptr = jit->strings[jit->string_count++] = decode_string(node->string_value);
+            return o;
+        }
+        case NODE_VAR: {
+            Binding *b = scope_lookup(scope, node->name);
+            if (b) return b->value;
+            /* A global of the process, such as stdout */
+            void *address = dlsym(RTLD_DEFAULT, node->name);
+            if (!address) {
+                fprintf(stderr, "Unresolved symbol %s\n", node->name);
+                exit(1);
+            }
+            code_load_imm64(jit, RAX, (uint64_t)(uintptr_t)address);
+            code_bytes(jit, "\x48\x8b\x00", 3);                         /* movq (%rax), %rax */
+            return make_operand(OPND_RAX, 0);
+        }
+        case NODE_BINARY_EXPR: {
+            Operand b;
+            int folded;
+            if (gen_operands(jit, scope, node, &b, &folded)) return make_operand(OPND_IMM, folded);
+            switch (node->op) {
+                case OP_ADD:
+                case OP_SUB:
+                case OP_MUL:
+                    code_alu(jit, node->op, b);
+                    break;
+                case OP_LT:
+                    code_alu(jit, OP_LT, b);
+                    code_bytes(jit, "\x0f\x9c\xc0\x0f\xb6\xc0", 6);     /* setl %al; movzbl %al, %eax */
+                    break;
+                case OP_DIV:
+                    if (b.kind == OPND_IMM) {
+                        code_load_imm(jit, RCX, b.value);
+                        b = make_operand(OPND_RCX, 0);
+                    }
+                    code_byte(jit, 0x99);                               /* cltd */
+                    if (b.kind == OPND_SLOT) {
+                        code_byte(jit, 0xf7);                           /* idivl disp(%rbp) */
+                        code_frame_operand(jit, 7, b.value);
+                    } else {
+                        code_bytes(jit, "\xf7\xf9", 2);                 /* idivl %ecx */
+                    }
+                    break;
+                default:
+                    fprintf(stderr, "Unsupported binary operator %s\n", operator_info(node->op)->spelling);
+                    exit(1);
+            }
+            return make_operand(OPND_RAX, 0);
+        }
+        case NODE_UNARY_EXPR: {
+            /* Postfix: yields the old value, then adds or subtracts 1 in memory */
+            Binding *b = node->children[0]->type == NODE_VAR ? scope_lookup(scope, node->children[0]->name) : NULL;
+            if (!b || b->value.kind != OPND_SLOT) {
+                fprintf(stderr, "Cannot assign to %s\n", node->children[0]->name ? node->children[0]->name : "expression");
+                exit(1);
+            }
+            if (want_result) code_load(jit, RAX, b->value.value, 0);
+            code_byte(jit, 0x83);                                       /* addl/subl $1, disp(%rbp) */
+            code_frame_operand(jit, node->op == OP_DEC ? 5 : 0, b->value.value);
+            code_byte(jit, 1);
+            return want_result ? make_operand(OPND_RAX, 0) : make_operand(OPND_IMM, 0);
+        }
+        case NODE_FUNCTION_CALL: {
+            void *function = dlsym(RTLD_DEFAULT, node->name);
+            if (!function) {
+                fprintf(stderr, "Unresolved function %s\n", node->name);
+                exit(1);
+            }
+            ASTNode *args = node->child_count == 1 ? node->children[0] : NULL;
+            int argc = args ? args->child_count : 0;
+            Operand *values = malloc((argc ? argc : 1) * sizeof(Operand));
+            for (int i = 0; i < argc; i++) {
+                values[i] = spill_rax(jit, gen_expr(jit, scope, args->children[i], 1));
+            }
+            /* The frame is 16-byte aligned, so only stack arguments can
+               misalign %rsp at the call */
+            int stack_args = argc > ARG_REG_COUNT ? argc - ARG_REG_COUNT : 0;
+            int pad = stack_args % 2;
+            if (pad) code_bytes(jit, "\x48\x83\xec\x08", 4);            /* subq $8, %rsp */
+            for (int i = argc - 1; i >= ARG_REG_COUNT; i--) {
+                if (values[i].kind == OPND_IMM) {
+                    code_byte(jit, 0x68);                               /* pushq $imm32 */
+                    code_int32(jit, values[i].value);
+                } else if (values[i].kind == OPND_SLOT) {
+                    code_byte(jit, 0xff);                               /* pushq disp(%rbp) */
+                    code_frame_operand(jit, 6, values[i].value);
+                } else {
+                    load_rax(jit, values[i]);
+                    code_byte(jit, 0x50);                               /* pushq %rax */
+                }
+            }
+            for (int i = 0; i < argc && i < ARG_REG_COUNT; i++) {
+                if (values[i].kind == OPND_IMM) code_load_imm(jit, arg_regs[i], values[i].value);
+                else if (values[i].kind == OPND_SLOT) code_load(jit, arg_regs[i], values[i].value, 1);
+                else code_load_imm64(jit, arg_regs[i], (uint64_t)(uintptr_t)values[i].ptr);
+            }
+            free(values);
+            /* Variadic callees read the number of vector registers used from %al */
+            code_bytes(jit, "\x31\xc0", 2);                             /* xorl %eax, %eax */
+            code_load_imm64(jit, R11, (uint64_t)(uintptr_t)function);
+            code_bytes(jit, "\x41\xff\xd3", 3);                         /* call *%r11 */
+            if (stack_args + pad > 0) {
+                code_bytes(jit, "\x48\x81\xc4", 3);                     /* addq $n, %rsp */
+                code_int32(jit, 8 * (stack_args + pad));
+            }
+            return make_operand(OPND_RAX, 0);
+        }
+        default:
+            fprintf(stderr, "Unsupported expression node %d\n", node->type);
+            exit(1);
+    }
+}
+
+/* Jump to label when the condition's truth equals jump_if; constant
+   conditions jump unconditionally or not at all */
+void gen_cond(Jit *jit, Scope *scope, ASTNode *node, int jump_if, int label) {
+    if (node->type == NODE_BINARY_EXPR && node->op == OP_LT) {
+        Operand b;
+        int folded;
+        if (gen_operands(jit, scope, node, &b, &folded)) {
+            if (folded == jump_if) code_jump(jit, CC_ALWAYS, label);
+            return;
+        }
+        code_alu(jit, OP_LT, b);
+        code_jump(jit, jump_if ? CC_L : CC_GE, label);
+        return;
+    }
+    Operand value = gen_expr(jit, scope, node, 1);
+    if (value.kind == OPND_IMM || value.kind == OPND_PTR) {
+        int truth = value.kind == OPND_PTR || value.value != 0;
+        if (truth == jump_if) code_jump(jit, CC_ALWAYS, label);
+        return;
+    }
+    load_rax(jit, value);
+    code_bytes(jit, "\x85\xc0", 2);                                     /* testl %eax, %eax */
+    code_jump(jit, jump_if ? CC_NE : CC_E, label);
+}
+
+void gen_stmt(Jit *jit, Scope *scope, ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+        case NODE_SEQUENCE:
+            for (int i = 0; i < node->child_count; i++) {
+                gen_stmt(jit, scope, node->children[i]);
+            }
+            break;
+        case NODE_DECLARATION: {
+            int slot;
+            if (node->child_count == 1) {
+                Operand value = gen_expr(jit, scope, node->children[0], 1);
+                slot = new_slot(jit);
+                if (value.kind == OPND_IMM) {
+                    code_bytes(jit, "\x48\xc7", 2);                     /* movq $imm32, disp(%rbp) */
+                    code_frame_operand(jit, 0, slot);
+                    code_int32(jit, value.value);
+                } else {
+                    load_rax(jit, value);
+                    code_store_rax(jit, slot);
+                }
+            } else {
+                slot = new_slot(jit);
+            }
+            scope_bind(scope, node->name, make_operand(OPND_SLOT, slot));
+            break;
+        }
+        case NODE_ASSIGNMENT: {
+            Binding *b = scope_lookup(scope, node->name);
+            if (!b || b->value.kind != OPND_SLOT) {
+                fprintf(stderr, "Cannot assign to %s\n", node->name);
+                exit(1);
+            }
+            int slot = b->value.value;
+            Operand value = gen_expr(jit, scope, node->children[0], 1);
+            if (value.kind == OPND_IMM) {
+                code_bytes(jit, "\x48\xc7", 2);                         /* movq $imm32, disp(%rbp) */
+                code_frame_operand(jit, 0, slot);
+                code_int32(jit, value.value);
+            } else {
+                load_rax(jit, value);
+                code_store_rax(jit, slot);
+            }
+            break;
+        }
+        case NODE_IF_STMT: {
+            int join = new_label(jit);
+            gen_cond(jit, scope, node->children[0], 0, join);
+            int mark = scope->count;
+            gen_stmt(jit, scope, node->children[1]);
+            scope->count = mark;
+            place_label(jit, join);
+            break;
+        }
+        case NODE_FOR_STMT: {
+            /* children: init, condition, update, body. Inverted: tested
+               once on entry and again at the bottom. */
+            int mark = scope->count;
+            gen_stmt(jit, scope, node->children[0]);
+            int body = new_label(jit);
+            int exit_label = new_label(jit);
+            gen_cond(jit, scope, node->children[1], 0, exit_label);
+            place_label(jit, body);
+            int body_mark = scope->count;
+            gen_stmt(jit, scope, node->children[3]);
+            scope->count = body_mark;
+            gen_expr(jit, scope, node->children[2], 0);
+            gen_cond(jit, scope, node->children[1], 1, body);
+            place_label(jit, exit_label);
+            scope->count = mark;
+            break;
+        }
+        case NODE_REPEAT: {
+            /* children: first value, count, body. The replicas are laid
+               out in straight line with the induction variable constant. */
+            int first = node->children[0]->int_value;
+            int count = node->children[1]->int_value;
+            for (int k = 0; k < count; k++) {
+                int mark = scope->count;
+                scope_bind(scope, node->name, make_operand(OPND_IMM, first + k));
+                gen_stmt(jit, scope, node->children[2]);
+                scope->count = mark;
+            }
+            break;
+        }
+        case NODE_RETURN_STMT: {
+            Operand value = node->child_count == 1 ? gen_expr(jit, scope, node->children[0], 1)
+                                                   : make_operand(OPND_IMM, 0);
+            load_rax(jit, value);
+            code_jump(jit, CC_ALWAYS, jit->return_label);
+            break;
+        }
+        default:
+            gen_expr(jit, scope, node, 0);
+            break;
+    }
+}
+
+void gen_function(Jit *jit, ASTNode *root) {
+    Scope scope;
+    memset(&scope, 0, sizeof(scope));
+    jit->return_label = new_label(jit);
+
+    code_bytes(jit, "\x55\x48\x89\xe5", 4);                             /* pushq %rbp; movq %rsp, %rbp */
+    code_bytes(jit, "\x48\x81\xec", 3);                                 /* subq $frame, %rsp */
+    int frame_at = jit->size;
+    code_int32(jit, 0);
+
+    gen_stmt(jit, &scope, root);
+
+    /* Falling off the end returns 0 */
+    code_bytes(jit, "\x31\xc0", 2);
+    place_label(jit, jit->return_label);
+    code_bytes(jit, "\xc9\xc3", 2);                                     /* leave; ret */
+
+    int frame = (8 * jit->slot_count + 15) & ~15;
+    memcpy(jit->bytes + frame_at, &frame, 4);
+    for (int i = 0; i < jit->fixup_count; i++) {
+        Fixup *f = &jit->fixups[i];
+        int32_t rel = jit->labels[f->label] - (f->at + 4);
+        memcpy(jit->bytes + f->at, &rel, 4);
+    }
+    free(scope.bindings);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Driver                                                                  */
+/* ---------------------------------------------------------------------- */
+
+double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = "newOutput.txt";
+    const char *dump_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--dump=", 7) == 0)
+            dump_path = argv[i] + 7;
+        else if (argv[i][0] != '-')
+            path = argv[i];
+        else {
+            fprintf(stderr, "Usage: %s [--dump=FILE] [AST.txt]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Failed to open input file %s\n", path);
+        return 1;
+    }
+    ASTNode *root = parse_ast(in);
+    fclose(in);
+    if (!root || root->type != NODE_FUNCTION_DEF) {
+        fprintf(stderr, "Failed to parse AST\n");
+        free_ast(root);
+        return 1;
+    }
+
+    double start = now_ms();
+    Jit jit;
+    memset(&jit, 0, sizeof(jit));
+    gen_function(&jit, root);
+    /* Written while writable, then flipped to executable: never both */
+    size_t length = (size_t)jit.size;
+    void *memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    memcpy(memory, jit.bytes, length);
+    if (mprotect(memory, length, PROT_READ | PROT_EXEC) != 0) {
+        perror("mprotect");
+        return 1;
+    }
+    double compiled = now_ms();
+
+    if (dump_path) {
+        FILE *dump = fopen(dump_path, "wb");
+        if (!dump || fwrite(jit.bytes, 1, length, dump) != length) perror(dump_path);
+        if (dump) fclose(dump);
+    }
+
+    int (*entry)(void);
+    *(void **)&entry = memory;
+    int result = entry();
+    fflush(stdout);
+    double finished = now_ms();
+
+    fprintf(stderr, "jit: %d bytes of machine code compiled in %.3f ms, ran in %.3f ms, returned %d\n",
+            jit.size, compiled - start, finished - compiled, result);
+    munmap(memory, length);
+    free_jit(&jit);
+    free_ast(root);
+    return result;
+}
@@ -2,14 +2,62 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "ops.h"
+#include "cache.h"
+#include "emit.h"
+#include "profile.h"
 
-#define MAX_CHILDREN 10
 #define MAX_LINE_LEN 256
 
+/* Unrolling cost model. Sizes are weighted node counts; every iteration
+   removed by unrolling saves roughly LOOP_OVERHEAD_COST (compare, increment
+   and branch). Growth is the unrolled size minus the rolled size. */
+#define LOOP_OVERHEAD_COST 3
+#define UNROLL_LOOP_BUDGET 512
+#define UNROLL_FUNCTION_BUDGET 2048
+#define UNROLL_MAX_TRIP 1024
+
+/* Output merging: a run of calls that print fixed text becomes one fputs
+   whose literal is at most OUTPUT_MERGE_BUDGET characters long. Any
+   literal a pass creates must fit on one line of the dump (MAX_LINE_LEN)
+   with room for indentation, so none is longer than OUTPUT_LITERAL_MAX. */
+#define OUTPUT_MERGE_BUDGET 160
+#define OUTPUT_LITERAL_MAX 160
+
+/* --evaluate: statements and expressions main may run at optimization
+   time, and the most output (in literal characters) it may print */
+#define EVALUATE_STEPS 1000000
+#define EVALUATE_OUTPUT_MAX 4096
+
+/* Upper bound on optimize_ast rounds; each round after the first only
+   revisits subtrees the previous one changed */
+#define MAX_OPTIMIZE_ROUNDS 16
+
+/* With --jobs=N, a block whose children include at least two subtrees of
+   this many nodes has its children optimized as parallel tasks */
+#define PARALLEL_MIN_NODES 64
+
+/* Profile-guided weighting. A loop or function whose count is within
+   1/PROFILE_HOT_RATIO of the hottest one in the profile is hot and gets
+   PROFILE_HOT_SCALE times the unroll budgets; one that never ran gets
+   none. An if whose condition held in at least PROFILE_BIAS_PERCENT of
+   its evaluations (or at most 100 minus that) is marked likely (unlikely). */
+#define PROFILE_HOT_RATIO 8
+#define PROFILE_HOT_SCALE 2
+#define PROFILE_BIAS_PERCENT 90
+
+#define PROFILE_COLD (-1)
+#define PROFILE_HOT 1
+
 typedef enum {
     NODE_FUNCTION_DEF,
     NODE_SEQUENCE,
     NODE_DECLARATION,
+    NODE_ASSIGNMENT,
     NODE_INT,
     NODE_BINARY_EXPR,
     NODE_VAR,
@@ -20,30 +68,177 @@ typedef enum {
     NODE_UNARY_EXPR,
     NODE_RETURN_STMT,
     NODE_STRING,
+    NODE_REPEAT,
     NODE_UNKNOWN
 } NodeType;
 
+typedef struct Symbol Symbol;
+
 typedef struct ASTNode {
     NodeType type;
     // For named nodes: FUNCTION_DEF(main), DECLARATION(a), VAR(a), FUNCTION_CALL(printf), etc.
     char *name;
+    // For DECLARATION and VAR nodes, the variable the name resolves to
+    Symbol *sym;
     // For INT nodes, store integer value
     int int_value;
     // For STRING nodes, store string value
     char *string_value;
     // For operators in binary/unary expressions
-    char op[4];
-    // Children nodes
-    struct ASTNode *children[MAX_CHILDREN];
+    Operator op;
+    // Value range proven by range analysis (valid when has_range is set)
+    int has_range;
+    long range_lo, range_hi;
+    // Children nodes (growable array)
+    struct ASTNode **children;
     int child_count;
+    int child_capacity;
+    // Incremental optimization: modified is set on a node that changed,
+    // or has a descendant that changed, since optimize_ast last visited
+    // it; analyzed once the passes have run on it
+    int modified;
+    int analyzed;
+    // From the profile: branch hint of an IF_STMT (1 likely, -1 unlikely)
+    // and PROFILE_HOT or PROFILE_COLD for a FOR_STMT or FUNCTION_DEF
+    int expect;
+    int heat;
 } ASTNode;
 
+/* Passes run by optimize_ast, for per-pass statistics */
+typedef enum {
+    PASS_FUSE,
+    PASS_FOLD,
+    PASS_LIBCALLS,
+    PASS_DEAD_IF,
+    PASS_DEAD_LOOP,
+    PASS_CLOSED_FORM,
+    PASS_UNROLL,
+    PASS_LICM,
+    PASS_EMPTY_IF,
+    PASS_SIMPLIFY,
+    PASS_MERGE_OUTPUT,
+    PASS_COUNT
+} PassId;
+
+typedef struct {
+    const char *name;
+    long visits;    /* nodes the pass was run on */
+    long changes;   /* nodes it rewrote */
+} PassStats;
+
+/* Code-size budgets consulted by the unroller (and any later pass that
+   duplicates code) and the output merger's literal size. Overridable from
+   the command line. */
+typedef struct {
+    int loop_budget;
+    int function_budget;
+    int output_budget;
+    int remarks;
+} CostConfig;
+
+/* One record per declared variable, plus one per undeclared name (such as
+   stdout) the function refers to. Symbols are owned by the table and
+   outlive the nodes that mention them. */
+struct Symbol {
+    int id;                 /* dense index into SymbolTable.symbols */
+    char *name;
+    int scope_depth;        /* 1 = function body; 0 for undeclared names */
+    ASTNode *decl;          /* declaring node, NULL for undeclared names */
+    int escapes;            /* visible outside the function; calls may change it */
+    int temporary;          /* introduced by LICM; renamed by name_temporaries */
+    Symbol *bucket_next;    /* next visible symbol in the same hash bucket */
+};
+
+#define SYMBOL_BUCKETS 256
+
+/* Symbols of the program, and while resolving, a hashed scope stack of the
+   visible ones: buckets[h] chains visible symbols innermost first and
+   scope_stack lists them in declaration order so a scope is popped by
+   unlinking bucket heads. */
+typedef struct {
+    Symbol **symbols;
+    int count, capacity;
+    Symbol *buckets[SYMBOL_BUCKETS];
+    Symbol **scope_stack;
+    int scope_count, scope_capacity;
+    int depth;
+} SymbolTable;
+
+static CostConfig cost_config = { UNROLL_LOOP_BUDGET, UNROLL_FUNCTION_BUDGET, OUTPUT_MERGE_BUDGET, 0 };
+/* A block whose children are being optimized as parallel tasks. Tasks
+   are handed out in child order, and a task that needs the function's
+   unroll budget first waits until every earlier task has finished, so
+   each budget decision sees the same growth as in a sequential run. */
+typedef struct {
+    ASTNode **tasks;
+    int *changed;       /* optimize_ast result of each task */
+    char *done;
+    int count;
+    int next;           /* next task to hand out */
+    int done_prefix;    /* tasks [0, done_prefix) have finished */
+} Region;
+
+/* The task a thread is running, NULL outside parallel regions */
+typedef struct {
+    Region *region;
+    int index;
+} TaskContext;
+
+static PassStats pass_stats[PASS_COUNT] = {
+    [PASS_FUSE] = { "loop-fusion", 0, 0 },
+    [PASS_FOLD] = { "constant-fold", 0, 0 },
+    [PASS_LIBCALLS] = { "libc-calls", 0, 0 },
+    [PASS_DEAD_IF] = { "dead-if", 0, 0 },
+    [PASS_DEAD_LOOP] = { "dead-loop", 0, 0 },
+    [PASS_CLOSED_FORM] = { "closed-form", 0, 0 },
+    [PASS_UNROLL] = { "unroll", 0, 0 },
+    [PASS_LICM] = { "licm", 0, 0 },
+    [PASS_EMPTY_IF] = { "empty-if", 0, 0 },
+    [PASS_SIMPLIFY] = { "simplify-sequence", 0, 0 },
+    [PASS_MERGE_OUTPUT] = { "merge-output", 0, 0 },
+};
+static int show_stats = 0;
+static _Thread_local long pass_visits[PASS_COUNT], pass_changes[PASS_COUNT];
+static _Thread_local TaskContext *current_task;
+static SymbolTable symtab;
+static int function_growth = 0;
+static int function_budget = UNROLL_FUNCTION_BUDGET;
+static int loop_counter = 0;
+static int licm_counter = 0;
+
+/* Worker pool for --jobs. pool_lock guards the active region and the
+   pass statistics; symtab_lock guards symbols created while optimizing. */
+static int jobs = 1;
+static pthread_t *workers;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t symtab_lock = PTHREAD_MUTEX_INITIALIZER;
+static Region *active_region;
+static int pool_shutdown;
+
+/* --evaluate: run main at optimization time */
+static int evaluate_program = 0;
+static int evaluate_steps = EVALUATE_STEPS;
+
+/* Profile given with --profile, and how many of its sites were found */
+static const char *profile_path;
+static Profile profile;
+static int profiled_sites;
+
 /* Forward declarations */
 ASTNode *parse_ast(FILE *f);
 void free_ast(ASTNode *node);
-void optimize_ast(ASTNode *node);
-void print_ast_to_file(ASTNode *node, int indent, FILE *out);
-ASTNode *clone_ast(ASTNode *node);
+int optimize_ast(ASTNode *node);
+void print_ast_to_file(ASTNode *node, int indent, Emitter *out);
+ASTNode *copy_ast(ASTNode *node);
+ASTNode *new_node(NodeType type);
+void append_child(ASTNode *parent, ASTNode *child);
+int declares_in_block(ASTNode *node);
+int constant_int_arg(ASTNode *arg, int *value);
+int is_statement_child(ASTNode *node, int i);
+int mentions_var(ASTNode *node, Symbol *sym);
+int writes_any_var(ASTNode *node);
+int has_side_effects(ASTNode *node);
 
 /* Helper function to skip spaces */
 void skip_spaces(const char **str) {
@@ -65,6 +260,7 @@ NodeType node_type_from_string(const char *str) {
     if (strcmp(str, "FUNCTION_DEF") == 0) return NODE_FUNCTION_DEF;
     if (strcmp(str, "SEQUENCE") == 0) return NODE_SEQUENCE;
     if (strcmp(str, "DECLARATION") == 0) return NODE_DECLARATION;
+    if (strcmp(str, "ASSIGNMENT") == 0) return NODE_ASSIGNMENT;
     if (strcmp(str, "INT") == 0) return NODE_INT;
     if (strcmp(str, "BINARY_EXPR") == 0) return NODE_BINARY_EXPR;
     if (strcmp(str, "VAR") == 0) return NODE_VAR;
@@ -75,6 +271,7 @@ NodeType node_type_from_string(const char *str) {
     if (strcmp(str, "UNARY_EXPR") == 0) return NODE_UNARY_EXPR;
     if (strcmp(str, "RETURN_STMT") == 0) return NODE_RETURN_STMT;
     if (strcmp(str, "STRING") == 0) return NODE_STRING;
+    if (strcmp(str, "REPEAT") == 0) return NODE_REPEAT;
     return NODE_UNKNOWN;
 }
 
@@ -131,22 +328,21 @@ ASTNode *parse_ast_recursive(FILE *f, int current_indent) {
         return NULL;
     }
     
-    ASTNode *node = calloc(1, sizeof(ASTNode));
-    node->type = t;
-    node->child_count = 0;
+    ASTNode *node = new_node(t);
     
     if (arg) {
         switch (t) {
             case NODE_FUNCTION_DEF:
             case NODE_DECLARATION:
+            case NODE_ASSIGNMENT:
             case NODE_VAR:
             case NODE_FUNCTION_CALL:
+            case NODE_REPEAT:
                 node->name = arg;
                 break;
             case NODE_BINARY_EXPR:
             case NODE_UNARY_EXPR:
-                strncpy(node->op, arg, 3);
-                node->op[3] = 0;
+                node->op = operator_from_spelling(arg);
                 free(arg);
                 break;
             case NODE_INT:
@@ -156,6 +352,11 @@ ASTNode *parse_ast_recursive(FILE *f, int current_indent) {
             case NODE_STRING:
                 node->string_value = arg;
                 break;
+            case NODE_IF_STMT:
+                if (strcmp(arg, "likely") == 0) node->expect = 1;
+                else if (strcmp(arg, "unlikely") == 0) node->expect = -1;
+                free(arg);
+                break;
             default:
                 free(arg);
                 break;
@@ -169,13 +370,7 @@ ASTNode *parse_ast_recursive(FILE *f, int current_indent) {
             fseek(f, pos_before, SEEK_SET);
             break;
         }
-        if (node->child_count < MAX_CHILDREN) {
-            node->children[node->child_count++] = child;
-        } else {
-            fprintf(stderr, "Too many children for node\n");
-            free_ast(child);
-            break;
-        }
+        append_child(node, child);
     }
     
     return node;
@@ -186,6 +381,38 @@ ASTNode *parse_ast(FILE *f) {
     return parse_ast_recursive(f, 0);
 }
 
+/* Make room for at least n children */
+void reserve_children(ASTNode *parent, int n) {
+    if (n <= parent->child_capacity) return;
+    int cap = parent->child_capacity ? parent->child_capacity : 4;
+    while (cap < n) cap *= 2;
+    ASTNode **grown = realloc(parent->children, cap * sizeof(ASTNode *));
+    if (!grown) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    parent->children = grown;
+    parent->child_capacity = cap;
+}
+
+/* Append a child, growing the child array as needed */
+void append_child(ASTNode *parent, ASTNode *child) {
+    reserve_children(parent, parent->child_count + 1);
+    parent->children[parent->child_count++] = child;
+}
+
+/* Allocate an exclusively owned node */
+ASTNode *new_node(NodeType type) {
+    ASTNode *node = calloc(1, sizeof(ASTNode));
+    if (!node) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    node->type = type;
+    node->modified = 1;
+    return node;
+}
+
 /* Free the AST recursively */
 void free_ast(ASTNode *node) {
     if (!node) return;
@@ -194,203 +421,2790 @@ void free_ast(ASTNode *node) {
     for (int i = 0; i < node->child_count; i++) {
         free_ast(node->children[i]);
     }
+    free(node->children);
     free(node);
 }
 
-/* Deep clone an AST node */
-ASTNode *clone_ast(ASTNode *node) {
+/* Deep copy of a subtree */
+ASTNode *copy_ast(ASTNode *node) {
     if (!node) return NULL;
-    ASTNode *copy = calloc(1, sizeof(ASTNode));
-    copy->type = node->type;
+    ASTNode *copy = new_node(node->type);
     copy->int_value = node->int_value;
+    copy->sym = node->sym;
+    copy->op = node->op;
+    copy->has_range = node->has_range;
+    copy->range_lo = node->range_lo;
+    copy->range_hi = node->range_hi;
+    copy->expect = node->expect;
+    copy->heat = node->heat;
     if (node->name) copy->name = strdup(node->name);
     if (node->string_value) copy->string_value = strdup(node->string_value);
-    strncpy(copy->op, node->op, sizeof(copy->op));
-    copy->child_count = node->child_count;
     for (int i = 0; i < node->child_count; i++) {
-        copy->children[i] = clone_ast(node->children[i]);
+        append_child(copy, copy_ast(node->children[i]));
     }
     return copy;
 }
 
-/* Optimize the AST with constant folding, dead code elimination, and loop unrolling */
-void optimize_ast(ASTNode *node) {
-    if (!node) return;
+/* Rewrite API. Every pass that restructures a node it may modify goes
+   through these: ownership of subtrees moves between parents and nothing
+   is deep-copied. The rewritten node keeps its identity, so its parent
+   needs no update. */
 
-    /* Recursively optimize children first */
+/* Remove child i from the parent and hand the caller its reference */
+ASTNode *detach_child(ASTNode *parent, int i) {
+    ASTNode *child = parent->children[i];
+    memmove(&parent->children[i], &parent->children[i + 1],
+            (parent->child_count - i - 1) * sizeof(ASTNode *));
+    parent->child_count--;
+    return child;
+}
+
+/* Release every child of the node */
+void release_children(ASTNode *node) {
     for (int i = 0; i < node->child_count; i++) {
-        optimize_ast(node->children[i]);
-    }
-
-    /* Constant folding for binary expressions */
-    if (node->type == NODE_BINARY_EXPR && node->child_count == 2) {
-        ASTNode *left = node->children[0];
-        ASTNode *right = node->children[1];
-        if (left->type == NODE_INT && right->type == NODE_INT) {
-            int res = 0, valid = 1;
-            if (strcmp(node->op, "+") == 0)
-                res = left->int_value + right->int_value;
-            else if (strcmp(node->op, "-") == 0)
-                res = left->int_value - right->int_value;
-            else if (strcmp(node->op, "*") == 0)
-                res = left->int_value * right->int_value;
-            else if (strcmp(node->op, "/") == 0 && right->int_value != 0)
-                res = left->int_value / right->int_value;
-            else
-                valid = 0;
-            if (valid) {
-                free_ast(left);
-                free_ast(right);
-                node->type = NODE_INT;
-                node->int_value = res;
-                node->child_count = 0;
-                node->op[0] = 0;
-            }
+        free_ast(node->children[i]);
+    }
+    node->child_count = 0;
+}
+
+/* Replace child i of the parent, releasing the old one */
+void replace_child(ASTNode *parent, int i, ASTNode *child) {
+    free_ast(parent->children[i]);
+    parent->children[i] = child;
+}
+
+/* Turn the node into an integer constant */
+void replace_with_int(ASTNode *node, int value) {
+    release_children(node);
+    free(node->name);
+    free(node->string_value);
+    node->name = NULL;
+    node->string_value = NULL;
+    node->sym = NULL;
+    node->op = OP_NONE;
+    node->expect = 0;
+    node->heat = 0;
+    node->type = NODE_INT;
+    node->int_value = value;
+}
+
+/* Turn the node into an empty statement list */
+void replace_with_empty(ASTNode *node) {
+    replace_with_int(node, 0);
+    node->type = NODE_SEQUENCE;
+}
+
+/* Replace the node by its child i; the other children are released */
+void replace_with_child(ASTNode *node, int i) {
+    ASTNode *child = detach_child(node, i);
+    release_children(node);
+    free(node->name);
+    free(node->string_value);
+    free(node->children);
+    *node = *child;
+    free(child);
+}
+
+/* Replace child i, a statement list, by its statements */
+void splice_child(ASTNode *parent, int i) {
+    ASTNode *seq = parent->children[i];
+    int n = seq->child_count;
+    reserve_children(parent, parent->child_count - 1 + n);
+    memmove(&parent->children[i + n], &parent->children[i + 1],
+            (parent->child_count - i - 1) * sizeof(ASTNode *));
+    if (n > 0) memcpy(&parent->children[i], seq->children, n * sizeof(ASTNode *));
+    parent->child_count += n - 1;
+    seq->child_count = 0;
+    free_ast(seq);
+}
+
+/* Hash of a variable name (FNV-1a) */
+unsigned symbol_hash(const char *name) {
+    unsigned h = 2166136261u;
+    for (; *name; name++) h = (h ^ (unsigned char)*name) * 16777619u;
+    return h % SYMBOL_BUCKETS;
+}
+
+/* Create a symbol record; it is not made visible to lookups */
+Symbol *symbol_create(SymbolTable *table, const char *name, ASTNode *decl) {
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 32;
+        table->symbols = realloc(table->symbols, table->capacity * sizeof(Symbol *));
+        if (!table->symbols) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
         }
     }
+    Symbol *sym = calloc(1, sizeof(Symbol));
+    sym->id = table->count;
+    sym->name = strdup(name);
+    sym->decl = decl;
+    sym->scope_depth = decl ? table->depth : 0;
+    sym->escapes = decl == NULL;
+    table->symbols[table->count++] = sym;
+    return sym;
+}
+
+/* Innermost visible symbol with this name, or NULL */
+Symbol *symbol_lookup(SymbolTable *table, const char *name) {
+    for (Symbol *sym = table->buckets[symbol_hash(name)]; sym; sym = sym->bucket_next) {
+        if (strcmp(sym->name, name) == 0) return sym;
+    }
+    return NULL;
+}
 
-    /* Constant folding for unary expressions */
-    if (node->type == NODE_UNARY_EXPR && node->child_count == 1) {
-        ASTNode *child = node->children[0];
-        if (child->type == NODE_INT) {
-            int res = child->int_value;
-            if (strcmp(node->op, "++") == 0) res++;
-            else if (strcmp(node->op, "--") == 0) res--;
-            else return;
-            free_ast(child);
-            node->type = NODE_INT;
-            node->int_value = res;
-            node->child_count = 0;
-            node->op[0] = 0;
+/* Make a symbol visible in the current scope, shadowing outer ones */
+void symbol_bind(SymbolTable *table, Symbol *sym) {
+    if (table->scope_count == table->scope_capacity) {
+        table->scope_capacity = table->scope_capacity ? table->scope_capacity * 2 : 32;
+        table->scope_stack = realloc(table->scope_stack, table->scope_capacity * sizeof(Symbol *));
+        if (!table->scope_stack) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
         }
     }
+    unsigned h = symbol_hash(sym->name);
+    sym->bucket_next = table->buckets[h];
+    table->buckets[h] = sym;
+    table->scope_stack[table->scope_count++] = sym;
+}
 
-    /* Dead code elimination for IF_STMT with constant condition */
-    if (node->type == NODE_IF_STMT && node->child_count >= 2) {
-        ASTNode *cond = node->children[0];
-        if (cond->type == NODE_INT) {
-            if (cond->int_value == 0) {
-                for (int i = 0; i < node->child_count; i++) {
-                    free_ast(node->children[i]);
-                }
-                node->type = NODE_SEQUENCE;
-                node->child_count = 0;
-            } else {
-                ASTNode *then_branch = node->children[1];
-                free_ast(cond);
-                for (int i = 2; i < node->child_count; i++) {
-                    free_ast(node->children[i]);
-                }
-                /* Instead of a shallow copy (which can lead to double frees),
-                   we deeply clone then_branch and replace node's data */
-                ASTNode *cloned = clone_ast(then_branch);
-                /* Free current node contents (except the node pointer itself) */
-                for (int i = 0; i < node->child_count; i++) {
-                    node->children[i] = NULL;
-                }
-                *node = *cloned;
-                free(cloned);
+/* Make an undeclared name visible for good: it goes to the tail of its
+   bucket, below every scope, so popping scopes never unlinks it */
+void symbol_bind_outermost(SymbolTable *table, Symbol *sym) {
+    Symbol **link = &table->buckets[symbol_hash(sym->name)];
+    while (*link) link = &(*link)->bucket_next;
+    sym->bucket_next = NULL;
+    *link = sym;
+}
+
+/* Enter a scope; returns the mark that symbol_leave_scope pops back to */
+int symbol_enter_scope(SymbolTable *table) {
+    table->depth++;
+    return table->scope_count;
+}
+
+void symbol_leave_scope(SymbolTable *table, int mark) {
+    while (table->scope_count > mark) {
+        Symbol *sym = table->scope_stack[--table->scope_count];
+        table->buckets[symbol_hash(sym->name)] = sym->bucket_next;
+        sym->bucket_next = NULL;
+    }
+    table->depth--;
+}
+
+/* Symbol that a use of the name refers to. An undeclared name, such as
+   stdout, gets a symbol of its own that is visible everywhere. */
+Symbol *symbol_use(SymbolTable *table, const char *name) {
+    Symbol *sym = symbol_lookup(table, name);
+    if (!sym) {
+        sym = symbol_create(table, name, NULL);
+        symbol_bind_outermost(table, sym);
+    }
+    return sym;
+}
+
+/* Bind every DECLARATION, REPEAT, VAR and ASSIGNMENT under node to its symbol.
+   Function, if and for bodies are scopes; a for init declaration is
+   scoped to the loop; plain SEQUENCEs are statement lists of the
+   enclosing scope. */
+void resolve_node(SymbolTable *table, ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+        case NODE_FUNCTION_DEF: {
+            int mark = symbol_enter_scope(table);
+            for (int i = 0; i < node->child_count; i++) resolve_node(table, node->children[i]);
+            symbol_leave_scope(table, mark);
+            return;
+        }
+        case NODE_IF_STMT:
+            if (node->child_count < 2) break;
+            resolve_node(table, node->children[0]);
+            for (int i = 1; i < node->child_count; i++) {
+                int mark = symbol_enter_scope(table);
+                resolve_node(table, node->children[i]);
+                symbol_leave_scope(table, mark);
             }
+            return;
+        case NODE_FOR_STMT: {
+            if (node->child_count != 4) break;
+            int mark = symbol_enter_scope(table);
+            for (int i = 0; i < 3; i++) resolve_node(table, node->children[i]);
+            int body_mark = symbol_enter_scope(table);
+            resolve_node(table, node->children[3]);
+            symbol_leave_scope(table, body_mark);
+            symbol_leave_scope(table, mark);
+            return;
         }
+        case NODE_REPEAT: {
+            /* The induction variable is bound in the body only */
+            if (node->child_count != 3) break;
+            resolve_node(table, node->children[0]);
+            resolve_node(table, node->children[1]);
+            int mark = symbol_enter_scope(table);
+            node->sym = symbol_create(table, node->name, node);
+            symbol_bind(table, node->sym);
+            resolve_node(table, node->children[2]);
+            symbol_leave_scope(table, mark);
+            return;
+        }
+        case NODE_DECLARATION:
+            /* The initializer cannot see the variable it initializes */
+            for (int i = 0; i < node->child_count; i++) resolve_node(table, node->children[i]);
+            node->sym = symbol_create(table, node->name, node);
+            symbol_bind(table, node->sym);
+            return;
+        case NODE_VAR:
+            node->sym = symbol_use(table, node->name);
+            return;
+        case NODE_ASSIGNMENT:
+            for (int i = 0; i < node->child_count; i++) resolve_node(table, node->children[i]);
+            node->sym = symbol_use(table, node->name);
+            return;
+        default:
+            break;
     }
+    for (int i = 0; i < node->child_count; i++) resolve_node(table, node->children[i]);
+}
 
-    /* Loop Unrolling for simple for-loops */
-    if (node->type == NODE_FOR_STMT && node->child_count == 4) {
-        ASTNode *init = node->children[0];
-        ASTNode *cond = node->children[1];
-        ASTNode *update = node->children[2];
-        ASTNode *body = node->children[3];
-
-        if (init->type == NODE_DECLARATION && init->child_count == 1 &&
-            init->children[0]->type == NODE_INT &&
-            cond->type == NODE_BINARY_EXPR && strcmp(cond->op, "<") == 0 &&
-            cond->child_count == 2 &&
-            cond->children[0]->type == NODE_VAR &&
-            cond->children[1]->type == NODE_INT &&
-            update->type == NODE_UNARY_EXPR && strcmp(update->op, "++") == 0 &&
-            update->child_count == 1 &&
-            update->children[0]->type == NODE_VAR &&
-            body->type == NODE_FUNCTION_CALL) {
-
-            int start = init->children[0]->int_value;
-            int end = cond->children[1]->int_value;
-            const char *var = cond->children[0]->name;
-            if (strcmp(var, init->name) == 0 && strcmp(var, update->children[0]->name) == 0 &&
-                end - start <= 16) {
-                /* Save a clone of the loop body before freeing children */
-                ASTNode *saved_body = clone_ast(body);
-                for (int i = 0; i < node->child_count; i++) {
-                    free_ast(node->children[i]);
-                }
-                node->type = NODE_SEQUENCE;
-                node->child_count = 0;
-                for (int i = start; i < end; i++) {
-                    ASTNode *replica = clone_ast(saved_body);
-                    node->children[node->child_count++] = replica;
-                }
-                free_ast(saved_body);
-            }
+void resolve_symbols(ASTNode *root) {
+    resolve_node(&symtab, root);
+}
+
+void free_symbols(SymbolTable *table) {
+    for (int i = 0; i < table->count; i++) {
+        free(table->symbols[i]->name);
+        free(table->symbols[i]);
+    }
+    free(table->symbols);
+    free(table->scope_stack);
+    memset(table, 0, sizeof(*table));
+}
+
+/* Algebraic identities with one constant operand: x + 0, 0 + x, x - 0,
+   x * 1 and 1 * x become x; x * 0 and 0 * x become 0 when x has no
+   effect */
+int fold_identity(ASTNode *node) {
+    if (node->type != NODE_BINARY_EXPR || node->child_count != 2) return 0;
+    for (int i = 0; i < 2; i++) {
+        ASTNode *constant = node->children[i];
+        ASTNode *other = node->children[1 - i];
+        if (constant->type != NODE_INT) continue;
+        int neutral = (node->op == OP_ADD || (node->op == OP_SUB && i == 1)) ? 0 :
+                      node->op == OP_MUL ? 1 : -1;
+        if (neutral >= 0 && constant->int_value == neutral) {
+            replace_with_child(node, 1 - i);
+            return 1;
+        }
+        if (node->op == OP_MUL && constant->int_value == 0 &&
+            !has_side_effects(other) && !writes_any_var(other)) {
+            replace_with_int(node, 0);
+            return 1;
         }
     }
+    return 0;
+}
+
+/* Constant folding for binary and unary expressions through the operator
+   table, and the identities above when an operand is not constant */
+int fold_operator_expr(ASTNode *node) {
+    if (node->type != NODE_BINARY_EXPR && node->type != NODE_UNARY_EXPR) return 0;
+    const OperatorInfo *info = operator_info(node->op);
+    if (!info->fold || node->child_count != info->arity) return 0;
+    for (int i = 0; i < node->child_count; i++) {
+        if (node->children[i]->type != NODE_INT) return fold_identity(node);
+    }
+    int a = node->children[0]->int_value;
+    int b = info->arity == 2 ? node->children[1]->int_value : 0;
+    int res;
+    if (!info->fold(a, b, &res)) return 0;
+    replace_with_int(node, res);
+    return 1;
+}
+
+/* Dead code elimination for IF_STMT with constant condition */
+int eliminate_dead_if(ASTNode *node) {
+    if (node->type != NODE_IF_STMT || node->child_count < 2) return 0;
+    ASTNode *cond = node->children[0];
+    if (cond->type != NODE_INT) return 0;
+    if (cond->int_value == 0) {
+        replace_with_empty(node);
+    } else {
+        /* Splicing the body into the enclosing block would move its
+           declarations into the outer scope */
+        if (declares_in_block(node->children[1])) return 0;
+        replace_with_child(node, 1);
+    }
+    return 1;
 }
 
-/* Print indentation */
-void print_indent_to_file(int indent, FILE *out) {
-    for (int i = 0; i < indent; i++)
-        fputc(' ', out);
+/* Print an optimization remark when remarks are enabled */
+void remark(const char *fmt, ...) {
+    if (!cost_config.remarks) return;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "remark: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
 }
 
-/* Recursively print the AST to a file */
-void print_ast_to_file(ASTNode *node, int indent, FILE *out) {
-    if (!node) return;
-    print_indent_to_file(indent, out);
+/* Weight of a single node in the code-size estimate */
+int node_cost(ASTNode *node) {
     switch (node->type) {
-        case NODE_FUNCTION_DEF: fprintf(out, "FUNCTION_DEF (%s)\n", node->name ? node->name : ""); break;
-        case NODE_SEQUENCE: fprintf(out, "SEQUENCE\n"); break;
-        case NODE_DECLARATION: fprintf(out, "DECLARATION (%s)\n", node->name ? node->name : ""); break;
-        case NODE_INT: fprintf(out, "INT (%d)\n", node->int_value); break;
-        case NODE_BINARY_EXPR: fprintf(out, "BINARY_EXPR (%s)\n", node->op); break;
-        case NODE_VAR: fprintf(out, "VAR (%s)\n", node->name ? node->name : ""); break;
-        case NODE_IF_STMT: fprintf(out, "IF_STMT\n"); break;
-        case NODE_FUNCTION_CALL: fprintf(out, "FUNCTION_CALL (%s)\n", node->name ? node->name : ""); break;
-        case NODE_EXPR_LIST: fprintf(out, "EXPR_LIST\n"); break;
-        case NODE_FOR_STMT: fprintf(out, "FOR_STMT\n"); break;
-        case NODE_UNARY_EXPR: fprintf(out, "UNARY_EXPR (%s)\n", node->op); break;
-        case NODE_RETURN_STMT: fprintf(out, "RETURN_STMT\n"); break;
-        case NODE_STRING: fprintf(out, "STRING (\"%s\")\n", node->string_value ? node->string_value : ""); break;
-        default: fprintf(out, "UNKNOWN\n"); break;
+        case NODE_SEQUENCE:
+        case NODE_EXPR_LIST:
+            return 0;
+        case NODE_FUNCTION_CALL:
+            return 4;
+        case NODE_IF_STMT:
+            return 2;
+        case NODE_FOR_STMT:
+            return LOOP_OVERHEAD_COST;
+        case NODE_BINARY_EXPR:
+            return node->op == OP_DIV ? 3 : 1;
+        default:
+            return 1;
     }
+}
+
+/* Estimated code size of a subtree (weighted node count). A REPEAT
+   costs as much as the replicas it stands for. */
+int estimate_cost(ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == NODE_REPEAT && node->child_count == 3)
+        return node->children[1]->int_value * estimate_cost(node->children[2]);
+    int cost = node_cost(node);
     for (int i = 0; i < node->child_count; i++) {
-        print_ast_to_file(node->children[i], indent + 2, out);
+        cost += estimate_cost(node->children[i]);
     }
+    return cost;
 }
 
-/* Entry point */
-int main() {
-    FILE *f = fopen("output.txt", "r");
-    if (!f) {
-        perror("Failed to open input file output.txt");
+/* In a parallel task, wait until all earlier tasks of its region are done */
+void wait_for_earlier_tasks(void) {
+    if (!current_task) return;
+    Region *region = current_task->region;
+    pthread_mutex_lock(&pool_lock);
+    while (region->done_prefix < current_task->index)
+        pthread_cond_wait(&pool_cond, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/* Check a proposed code-size growth against the per-loop and per-function
+   budgets. Returns NULL when allowed, otherwise the name of the budget
+   that would be exceeded. Used by the unroller; any pass that duplicates
+   code should consult it and then call charge_growth(). */
+const char *check_growth_budget(int growth, int loop_budget) {
+    if (growth > loop_budget) return "per-loop";
+    if (growth <= 0) return NULL;
+    /* The function budget is consumed in program order */
+    wait_for_earlier_tasks();
+    if (function_growth + growth > function_budget) return "per-function";
+    return NULL;
+}
+
+/* A budget weighted by the profile heat of the loop or function it is for */
+int scaled_budget(int budget, int heat) {
+    if (heat == PROFILE_COLD) return 0;
+    if (heat == PROFILE_HOT) return budget * PROFILE_HOT_SCALE;
+    return budget;
+}
+
+/* Record accepted code-size growth against the current function */
+void charge_growth(int growth) {
+    if (growth > 0) function_growth += growth;
+}
+
+/* Variable modified by a ++/-- node (an operator that is not pure), or NULL */
+Symbol *unary_target(ASTNode *node) {
+    if (node->type != NODE_UNARY_EXPR || operator_info(node->op)->pure ||
+        node->child_count != 1 || node->children[0]->type != NODE_VAR)
+        return NULL;
+    return node->children[0]->sym;
+}
+
+/* Variable modified by a ++/-- or an ASSIGNMENT node, or NULL */
+Symbol *written_var(ASTNode *node) {
+    if (node->type == NODE_ASSIGNMENT) return node->sym;
+    return unary_target(node);
+}
+
+/* Is the node a DECLARATION or the REPEAT that binds the variable? */
+int declares_var(ASTNode *node, Symbol *sym) {
+    return (node->type == NODE_DECLARATION || node->type == NODE_REPEAT) && node->sym == sym;
+}
+
+/* Does the subtree modify or declare the variable? */
+int writes_var(ASTNode *node, Symbol *sym) {
+    if (!node) return 0;
+    if (declares_var(node, sym)) return 1;
+    if (written_var(node) == sym) return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (writes_var(node->children[i], sym)) return 1;
+    }
+    return 0;
+}
+
+/* Does the subtree modify any variable? */
+int writes_any_var(ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == NODE_ASSIGNMENT) return 1;
+    if ((node->type == NODE_UNARY_EXPR || node->type == NODE_BINARY_EXPR) &&
+        !operator_info(node->op)->pure)
         return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (writes_any_var(node->children[i])) return 1;
     }
-    
-    ASTNode *root = parse_ast(f);
-    fclose(f);
-    if (!root) {
-        fprintf(stderr, "Failed to parse AST\n");
+    return 0;
+}
+
+/* Does the block declare variables directly in its own scope? */
+int declares_in_block(ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == NODE_DECLARATION) return 1;
+    if (node->type != NODE_SEQUENCE) return 0;
+    for (int i = 0; i < node->child_count; i++) {
+        if (declares_in_block(node->children[i])) return 1;
+    }
+    return 0;
+}
+
+/* Is the variable declared directly in the block's own scope? */
+int block_declares_var(ASTNode *node, Symbol *sym) {
+    if (!node) return 0;
+    if (node->type == NODE_DECLARATION) return node->sym == sym;
+    if (node->type != NODE_SEQUENCE) return 0;
+    for (int i = 0; i < node->child_count; i++) {
+        if (block_declares_var(node->children[i], sym)) return 1;
+    }
+    return 0;
+}
+
+/* Rebind every use and declaration of one variable to another, under
+   the other's name */
+void rename_symbol(ASTNode *node, Symbol *from, Symbol *to) {
+    if (!node) return;
+    if (((node->type == NODE_VAR || node->type == NODE_ASSIGNMENT) && node->sym == from) ||
+        declares_var(node, from)) {
+        node->sym = to;
+        free(node->name);
+        node->name = strdup(to->name);
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        rename_symbol(node->children[i], from, to);
+    }
+}
+
+/* Folding of pure int -> int library calls on a constant argument, as
+   in ops.h: returns 0 when the result is undefined. Character functions
+   follow the "C" locale. */
+int fold_abs(int a, int *res) {
+    if (a == INT_MIN) return 0;
+    *res = a < 0 ? -a : a;
+    return 1;
+}
+
+int fold_toupper(int a, int *res) {
+    if (a < -1 || a > UCHAR_MAX) return 0;
+    *res = a >= 'a' && a <= 'z' ? a - 'a' + 'A' : a;
+    return 1;
+}
+
+int fold_tolower(int a, int *res) {
+    if (a < -1 || a > UCHAR_MAX) return 0;
+    *res = a >= 'A' && a <= 'Z' ? a - 'A' + 'a' : a;
+    return 1;
+}
+
+/* Library calls with known behaviour. Unknown calls are assumed to have
+   side effects. */
+typedef struct {
+    const char *name;
+    int has_side_effects;
+    int (*fold)(int a, int *res);   /* NULL if not folded */
+} CallInfo;
+
+static const CallInfo known_calls[] = {
+    { "printf", 1, NULL }, { "puts", 1, NULL }, { "putchar", 1, NULL }, { "fputs", 1, NULL },
+    { "fwrite", 1, NULL }, { "write", 1, NULL }, { "scanf", 1, NULL }, { "getchar", 1, NULL },
+    { "exit", 1, NULL }, { "abort", 1, NULL }, { "malloc", 1, NULL }, { "free", 1, NULL },
+    { "rand", 1, NULL }, { "srand", 1, NULL }, { "time", 1, NULL },
+    { "abs", 0, fold_abs }, { "labs", 0, NULL }, { "isdigit", 0, NULL }, { "isalpha", 0, NULL },
+    { "toupper", 0, fold_toupper }, { "tolower", 0, fold_tolower },
+};
+
+const CallInfo *find_call(const char *name) {
+    if (!name) return NULL;
+    for (size_t i = 0; i < sizeof(known_calls) / sizeof(known_calls[0]); i++) {
+        if (strcmp(known_calls[i].name, name) == 0) return &known_calls[i];
+    }
+    return NULL;
+}
+
+/* Is a call to this function free of observable effects? */
+int call_is_pure(const char *name) {
+    const CallInfo *info = find_call(name);
+    return info && !info->has_side_effects;
+}
+
+/* Does evaluating the subtree call anything with side effects or leave
+   the function early? */
+int has_side_effects(ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == NODE_RETURN_STMT) return 1;
+    if (node->type == NODE_FUNCTION_CALL && !call_is_pure(node->name)) return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (has_side_effects(node->children[i])) return 1;
+    }
+    return 0;
+}
+
+/* Induction variable of a loop shaped "for (int i = ...; i < ...; i++)"
+   whose body never writes i, or NULL */
+Symbol *counted_loop_var(ASTNode *node) {
+    if (node->type != NODE_FOR_STMT || node->child_count != 4) return NULL;
+    ASTNode *init = node->children[0];
+    ASTNode *cond = node->children[1];
+    ASTNode *update = node->children[2];
+    if (init->type != NODE_DECLARATION || init->child_count != 1 || !init->sym) return NULL;
+    if (cond->type != NODE_BINARY_EXPR || cond->op != OP_LT || cond->child_count != 2 ||
+        cond->children[0]->type != NODE_VAR || cond->children[0]->sym != init->sym)
+        return NULL;
+    if (update->op != OP_INC || unary_target(update) != init->sym) return NULL;
+    if (writes_var(node->children[3], init->sym)) return NULL;
+    return init->sym;
+}
+
+/* Constant start and end of a counted loop; trip count is max(end - start, 0) */
+int constant_loop_bounds(ASTNode *node, int *start, int *end) {
+    if (!counted_loop_var(node)) return 0;
+    ASTNode *init_value = node->children[0]->children[0];
+    ASTNode *bound = node->children[1]->children[1];
+    if (init_value->type != NODE_INT || bound->type != NODE_INT) return 0;
+    *start = init_value->int_value;
+    *end = bound->int_value;
+    return 1;
+}
+
+/* Replace every use of a variable with an integer constant */
+void substitute_var(ASTNode *node, Symbol *sym, int value) {
+    if (node->type == NODE_VAR && node->sym == sym) {
+        replace_with_int(node, value);
+        return;
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        substitute_var(node->children[i], sym, value);
+    }
+}
+
+/* Loop Unrolling for simple for-loops, guarded by the cost model */
+int unroll_loop(ASTNode *node) {
+    if (node->type != NODE_FOR_STMT || node->child_count != 4) return 0;
+    ASTNode *body = node->children[3];
+    /* Loop ids only label remarks, which are never parallel */
+    int id = cost_config.remarks ? ++loop_counter : 0;
+
+    int start, end;
+    Symbol *var = counted_loop_var(node);
+    if (!var || !constant_loop_bounds(node, &start, &end)) {
+        remark("loop %d not unrolled: not a constant-bound counted loop", id);
+        return 0;
+    }
+    if (declares_in_block(body)) {
+        remark("loop %d not unrolled: body declares locals", id);
+        return 0;
+    }
+    if (node->heat == PROFILE_COLD) {
+        remark("loop %d not unrolled: never entered in the profile", id);
+        return 0;
+    }
+
+    long trip = (long)end - start;
+    if (trip < 0) trip = 0;
+    if (trip > UNROLL_MAX_TRIP) {
+        remark("loop %d not unrolled: trip count %ld exceeds %d", id, trip, UNROLL_MAX_TRIP);
+        return 0;
+    }
+    int body_cost = estimate_cost(body);
+    int growth = (int)trip * body_cost - (body_cost + LOOP_OVERHEAD_COST);
+    const char *exceeded = check_growth_budget(growth, scaled_budget(cost_config.loop_budget, node->heat));
+    const char *hot = node->heat == PROFILE_HOT ? " (hot in profile)" : "";
+    if (exceeded) {
+        remark("loop %d not unrolled: trip count %ld, body cost %d, growth %+d exceeds %s budget%s",
+               id, trip, body_cost, growth, exceeded, hot);
+        return 0;
+    }
+    charge_growth(growth);
+    remark("loop %d unrolled: trip count %ld, body cost %d, growth %+d, saves %ld loop overhead%s",
+           id, trip, body_cost, growth, trip * LOOP_OVERHEAD_COST, hot);
+
+    /* A body that reads the induction variable is copied once per
+       iteration with the variable replaced by its value, so the next round
+       folds each replica and removes or unrolls its inner loops */
+    body = detach_child(node, 3);
+    replace_with_empty(node);
+    if (mentions_var(body, var)) {
+        for (int i = start; i < end; i++) {
+            ASTNode *replica = copy_ast(body);
+            substitute_var(replica, var, i);
+            append_child(node, replica);
+        }
+        free_ast(body);
         return 1;
     }
-    
-    optimize_ast(root);
-    
-    FILE *out = fopen("newOutput.txt", "w");
-    if (!out) {
-        perror("Failed to open output file newOutput.txt");
-        free_ast(root);
+
+    /* Otherwise the replicas are identical: keep one body, and ast_to_c
+       emits it count times */
+    node->type = NODE_REPEAT;
+    node->name = strdup(var->name);
+    node->sym = var;
+    var->decl = node;
+    ASTNode *first = new_node(NODE_INT);
+    first->int_value = start;
+    ASTNode *count = new_node(NODE_INT);
+    count->int_value = (int)trip;
+    append_child(node, first);
+    append_child(node, count);
+    append_child(node, body);
+    return 1;
+}
+
+/* Structural equality of two subtrees, treating variable a_sym in a as
+   the same variable as b_sym in b (pass NULLs for plain equality) */
+int ast_equal_renamed(ASTNode *a, ASTNode *b, Symbol *a_sym, Symbol *b_sym) {
+    if (a == b) return 1;
+    if (!a || !b) return 0;
+    if (a->type != b->type || a->int_value != b->int_value ||
+        a->child_count != b->child_count || a->op != b->op)
+        return 0;
+    int renamed = a_sym && a->sym == a_sym && b->sym == b_sym;
+    if (a->sym != b->sym && !renamed)
+        return 0;
+    /* The renamed pair may be spelled differently */
+    if (!renamed && (a->name || b->name) &&
+        (!a->name || !b->name || strcmp(a->name, b->name) != 0))
+        return 0;
+    if ((a->string_value || b->string_value) &&
+        (!a->string_value || !b->string_value || strcmp(a->string_value, b->string_value) != 0))
+        return 0;
+    for (int i = 0; i < a->child_count; i++) {
+        if (!ast_equal_renamed(a->children[i], b->children[i], a_sym, b_sym)) return 0;
+    }
+    return 1;
+}
+
+int ast_equal(ASTNode *a, ASTNode *b) {
+    return ast_equal_renamed(a, b, NULL, NULL);
+}
+
+/* Interval an expression is known to lie in: a literal, or the range that
+   propagate_ranges proved for it */
+int known_interval(ASTNode *expr, long *lo, long *hi) {
+    if (expr->type == NODE_INT) {
+        *lo = *hi = expr->int_value;
         return 1;
     }
-    
-    print_ast_to_file(root, 0, out);
-    fclose(out);
+    if (!expr->has_range) return 0;
+    *lo = expr->range_lo;
+    *hi = expr->range_hi;
+    return 1;
+}
+
+/* Is the expression known never to evaluate to zero? */
+int is_nonzero(ASTNode *expr) {
+    if (expr->type == NODE_INT) return expr->int_value != 0;
+    return expr->has_range && (expr->range_lo > 0 || expr->range_hi < 0);
+}
+
+/* Can evaluating the expression never overflow or trap? Range analysis
+   records a range on an operation or call only when every result it can
+   produce is a well-defined int. */
+int cannot_trap(ASTNode *expr) {
+    if ((expr->type == NODE_BINARY_EXPR || expr->type == NODE_FUNCTION_CALL) && !expr->has_range)
+        return 0;
+    for (int i = 0; i < expr->child_count; i++) {
+        if (!cannot_trap(expr->children[i])) return 0;
+    }
+    return 1;
+}
+
+/* Is the expression pure, non-trapping and unchanged by every iteration of the loop? */
+int is_loop_invariant(ASTNode *expr, ASTNode *loop) {
+    switch (expr->type) {
+        case NODE_INT:
+            return 1;
+        case NODE_VAR:
+            /* Calls in the loop may change variables visible outside the function */
+            if (expr->sym->escapes && has_side_effects(loop)) return 0;
+            return !writes_var(loop, expr->sym);
+        case NODE_BINARY_EXPR:
+            if (expr->child_count != 2) return 0;
+            /* Hoisting must not introduce a division by zero on a path that never ran it */
+            if (expr->op == OP_DIV && !is_nonzero(expr->children[1]))
+                return 0;
+            return is_loop_invariant(expr->children[0], loop) &&
+                   is_loop_invariant(expr->children[1], loop);
+        case NODE_FUNCTION_CALL:
+            return call_is_pure(expr->name) &&
+                   (expr->child_count == 0 || is_loop_invariant(expr->children[0], loop));
+        case NODE_EXPR_LIST:
+            for (int i = 0; i < expr->child_count; i++) {
+                if (!is_loop_invariant(expr->children[i], loop)) return 0;
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Does the counted loop run at least once? Every possible start must be
+   below every possible bound. */
+int loop_runs(ASTNode *node) {
+    long start_lo, start_hi, bound_lo, bound_hi;
+    if (!counted_loop_var(node)) return 0;
+    return known_interval(node->children[0]->children[0], &start_lo, &start_hi) &&
+           known_interval(node->children[1]->children[1], &bound_lo, &bound_hi) &&
+           start_hi < bound_lo;
+}
+
+/* Does child i run whenever the node does? If bodies, and the update
+   and body of a loop that may not run, are conditional. */
+int child_always_runs(ASTNode *node, int i) {
+    switch (node->type) {
+        case NODE_IF_STMT: return i == 0;
+        case NODE_FOR_STMT: return i < 2 || loop_runs(node);
+        case NODE_REPEAT: return i < 2 || node->children[1]->int_value > 0;
+        default: return 1;
+    }
+}
+
+/* Replace maximal invariant binary expressions and pure calls under the
+   node with temporaries. Each new temporary is appended to hoisted as a
+   DECLARATION node; an expression equal to one already hoisted reuses its
+   temporary. Only operands are hoisted: an invariant expression used as a
+   statement computes nothing that is kept. always says whether the node
+   runs on every iteration; where it may not, only expressions that cannot
+   overflow or trap are hoisted, since the hoisted copy always runs. */
+void hoist_invariants_in(ASTNode *node, ASTNode *loop, ASTNode *hoisted, int always) {
+    for (int i = 0; i < node->child_count; i++) {
+        ASTNode *child = node->children[i];
+        int child_always = always && child_always_runs(node, i);
+        /* A statement with side effects may leave the block (return, exit) */
+        if (node->type == NODE_SEQUENCE && has_side_effects(child)) always = 0;
+        if ((child->type == NODE_BINARY_EXPR || child->type == NODE_FUNCTION_CALL) &&
+            !is_statement_child(node, i) && is_loop_invariant(child, loop) &&
+            (child_always || cannot_trap(child))) {
+            ASTNode *decl = NULL;
+            for (int j = 0; j < hoisted->child_count; j++) {
+                if (ast_equal(hoisted->children[j]->children[0], child)) {
+                    decl = hoisted->children[j];
+                    break;
+                }
+            }
+            if (decl) {
+                free_ast(child);
+            } else {
+                char tmp_name[32];
+                decl = new_node(NODE_DECLARATION);
+                pthread_mutex_lock(&symtab_lock);
+                snprintf(tmp_name, sizeof(tmp_name), "licm_tmp%d", licm_counter++);
+                decl->sym = symbol_create(&symtab, tmp_name, decl);
+                pthread_mutex_unlock(&symtab_lock);
+                decl->sym->temporary = 1;
+                decl->name = strdup(tmp_name);
+                append_child(decl, child);
+                append_child(hoisted, decl);
+            }
+            ASTNode *use = new_node(NODE_VAR);
+            use->name = strdup(decl->name);
+            use->sym = decl->sym;
+            node->children[i] = use;
+        } else {
+            hoist_invariants_in(child, loop, hoisted, child_always);
+        }
+    }
+}
+
+/* Loop-invariant code motion: move invariant expressions of the condition
+   and body into temporaries declared just before the loop. The condition
+   is always evaluated; the body runs on every iteration only when the loop
+   is known to run, and otherwise gives up only expressions that cannot
+   overflow or trap. The FOR_STMT node becomes
+   SEQUENCE(declarations..., FOR_STMT). */
+int hoist_loop_invariants(ASTNode *node) {
+    if (node->type != NODE_FOR_STMT || node->child_count != 4) return 0;
+
+    ASTNode *hoisted = new_node(NODE_SEQUENCE);
+    /* children: 0 init, 1 cond, 2 update, 3 body; init and update are not repeated work */
+    if (node->children[1]->type == NODE_BINARY_EXPR)
+        hoist_invariants_in(node->children[1], node, hoisted, 1);
+    hoist_invariants_in(node->children[3], node, hoisted, loop_runs(node));
+    if (hoisted->child_count == 0) {
+        free_ast(hoisted);
+        return 0;
+    }
+    remark("hoisted %d loop-invariant expression(s) out of a loop", hoisted->child_count);
+
+    ASTNode *loop = new_node(NODE_FOR_STMT);
+    *loop = *node;
+    memset(node, 0, sizeof(ASTNode));
+    *node = *hoisted;
+    free(hoisted);
+    append_child(node, loop);
+    return 1;
+}
+
+/* Does the subtree write a variable that outlives one loop iteration?
+   Variables declared directly in the body block are iteration-local;
+   anything else is treated as outer. */
+int writes_outer_var(ASTNode *node, ASTNode *scope) {
+    if (!node) return 0;
+    Symbol *target = written_var(node);
+    if (target && !block_declares_var(scope, target)) return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (writes_outer_var(node->children[i], scope)) return 1;
+    }
+    return 0;
+}
+
+/* Zero-trip and effect-free loop elimination. A constant-bound loop that
+   never runs is removed. A counted loop whose condition, update and body
+   have no side effects and write only iteration-local variables is removed
+   too: its induction variable is declared by the loop, so its final value
+   cannot be observed afterwards. The node becomes an empty SEQUENCE. */
+int eliminate_dead_loop(ASTNode *node) {
+    Symbol *var = counted_loop_var(node);
+    if (!var) return 0;
+    ASTNode *cond = node->children[1];
+    ASTNode *body = node->children[3];
+    int start, end;
+    int zero_trip = constant_loop_bounds(node, &start, &end) && end <= start;
+    if (!zero_trip) {
+        if (!is_loop_invariant(cond->children[1], node)) return 0;
+        if (has_side_effects(node->children[0]) || has_side_effects(body)) return 0;
+        if (writes_outer_var(body, body)) return 0;
+    }
+    remark("removed %s loop over '%s'", zero_trip ? "zero-trip" : "effect-free", var->name);
+    replace_with_empty(node);
+    return 1;
+}
+
+/* Closed-form evaluation of accumulator loops. In a counted loop whose
+   body only updates accumulators, one statement each, of the forms
+
+       acc = acc + step;   acc = step + acc;   acc = acc - step;
+       acc++;              acc--;
+
+   the step is either the induction variable, making acc an arithmetic
+   series, or invariant, making it an affine recurrence. The loop then
+   adds (bound - start) * step or the sum of start..bound-1 to acc, which
+   is computed directly. */
+typedef struct {
+    Symbol *acc;
+    Operator op;        /* OP_ADD or OP_SUB */
+    int series;         /* the step is the induction variable */
+    ASTNode **step;     /* slot of an invariant step; NULL for ++/-- and series */
+} Recurrence;
+
+/* Match one accumulator update of the loop over var */
+int match_recurrence(ASTNode *stmt, Symbol *var, Recurrence *r) {
+    memset(r, 0, sizeof(*r));
+    if (stmt->type == NODE_UNARY_EXPR && unary_target(stmt)) {
+        r->acc = unary_target(stmt);
+        r->op = stmt->op == OP_DEC ? OP_SUB : OP_ADD;
+        return r->acc != var;
+    }
+    if (stmt->type != NODE_ASSIGNMENT || stmt->child_count != 1) return 0;
+    ASTNode *value = stmt->children[0];
+    if (value->type != NODE_BINARY_EXPR || value->child_count != 2 ||
+        (value->op != OP_ADD && value->op != OP_SUB))
+        return 0;
+    r->acc = stmt->sym;
+    r->op = value->op;
+    if (value->children[0]->type == NODE_VAR && value->children[0]->sym == r->acc) {
+        r->step = &value->children[1];
+    } else if (value->op == OP_ADD && value->children[1]->type == NODE_VAR &&
+               value->children[1]->sym == r->acc) {
+        r->step = &value->children[0];
+    } else {
+        return 0;
+    }
+    if ((*r->step)->type == NODE_VAR && (*r->step)->sym == var) {
+        r->series = 1;
+        r->step = NULL;
+    }
+    return r->acc && r->acc != var;
+}
+
+/* Largest absolute value in an interval */
+long interval_magnitude(long lo, long hi) {
+    return labs(lo) > labs(hi) ? labs(lo) : labs(hi);
+}
+
+ASTNode *make_binary(Operator op, ASTNode *a, ASTNode *b) {
+    ASTNode *node = new_node(NODE_BINARY_EXPR);
+    node->op = op;
+    append_child(node, a);
+    append_child(node, b);
+    return node;
+}
+
+ASTNode *make_int(int value) {
+    ASTNode *node = new_node(NODE_INT);
+    node->int_value = value;
+    return node;
+}
+
+/* The statement acc = acc op total */
+ASTNode *make_accumulate(Symbol *acc, Operator op, ASTNode *total) {
+    ASTNode *use = new_node(NODE_VAR);
+    use->name = strdup(acc->name);
+    use->sym = acc;
+    ASTNode *stmt = new_node(NODE_ASSIGNMENT);
+    stmt->name = strdup(acc->name);
+    stmt->sym = acc;
+    append_child(stmt, make_binary(op, use, total));
+    return stmt;
+}
+
+/* Can a counted loop of accumulator updates be replaced by their closed
+   forms? The start and bound must be invariant and pure, with known
+   intervals under which neither the trip count nor any total can overflow
+   int. On success recs holds one recurrence per body statement, for the
+   caller to free. On failure reason says why, for a remark, or is NULL
+   when the loop does not have the shape or never runs. */
+int plan_closed_form(ASTNode *node, Recurrence **recs_out, int *count_out, const char **reason_out) {
+    *reason_out = NULL;
+    Symbol *var = counted_loop_var(node);
+    if (!var) return 0;
+    ASTNode *body = node->children[3];
+    int count = body->type == NODE_SEQUENCE ? body->child_count : 1;
+    if (count == 0) return 0;
+    Recurrence *recs = malloc(count * sizeof(Recurrence));
+    for (int i = 0; i < count; i++) {
+        ASTNode *stmt = body->type == NODE_SEQUENCE ? body->children[i] : body;
+        if (!match_recurrence(stmt, var, &recs[i])) {
+            free(recs);
+            return 0;
+        }
+        for (int j = 0; j < i; j++) {
+            if (recs[j].acc == recs[i].acc) {
+                /* Partial sums of several updates could overflow where
+                   the loop's interleaved values did not */
+                free(recs);
+                return 0;
+            }
+        }
+        if (recs[i].step && (!is_loop_invariant(*recs[i].step, node) ||
+                             has_side_effects(*recs[i].step) || writes_any_var(*recs[i].step))) {
+            free(recs);
+            return 0;
+        }
+    }
+
+    ASTNode **start = &node->children[0]->children[0];
+    ASTNode **bound = &node->children[1]->children[1];
+    const char *reason = NULL;
+    long start_lo, start_hi, bound_lo, bound_hi, trip_max = 0;
+    if (!is_loop_invariant(*start, node) || !is_loop_invariant(*bound, node) ||
+        has_side_effects(*start) || has_side_effects(*bound) ||
+        writes_any_var(*start) || writes_any_var(*bound)) {
+        reason = "bounds are not invariant";
+    } else if (!known_interval(*start, &start_lo, &start_hi) ||
+               !known_interval(*bound, &bound_lo, &bound_hi)) {
+        reason = "bounds have unknown ranges";
+    } else {
+        trip_max = bound_hi - start_lo;
+        if (trip_max > INT_MAX) reason = "trip count may overflow";
+    }
+    if (!reason && trip_max <= 0) {
+        /* Never runs; eliminate_dead_loop removes what it can prove */
+        free(recs);
+        return 0;
+    }
+    for (int i = 0; i < count && !reason; i++) {
+        long lo = 1, hi = 1;
+        if (recs[i].series) {
+            /* total = (bound - start) * (start + bound - 1) / 2 */
+            lo = start_lo + bound_lo - 1;
+            hi = start_hi + bound_hi - 1;
+            if (lo < INT_MIN || hi >= INT_MAX) {
+                reason = "series may overflow";
+                break;
+            }
+        } else if (recs[i].step && !known_interval(*recs[i].step, &lo, &hi)) {
+            reason = "step has an unknown range";
+            break;
+        }
+        if (trip_max * interval_magnitude(lo, hi) > INT_MAX)
+            reason = recs[i].series ? "series may overflow" : "total may overflow";
+    }
+    if (reason) {
+        *reason_out = reason;
+        free(recs);
+        return 0;
+    }
+    *recs_out = recs;
+    *count_out = count;
+    return 1;
+}
+
+/* Does the closed form apply to the loop? */
+int closes_to_closed_form(ASTNode *node) {
+    Recurrence *recs;
+    int count;
+    const char *reason;
+    if (!plan_closed_form(node, &recs, &count, &reason)) return 0;
+    free(recs);
+    return 1;
+}
+
+/* Replace a counted loop of accumulator updates by their closed forms.
+   With constant bounds the totals are folded and the loop becomes a list
+   of updates; otherwise the updates run under IF_STMT (start < bound),
+   since a loop that never runs adds nothing. */
+int close_accumulator_loop(ASTNode *node) {
+    Recurrence *recs;
+    int count;
+    const char *reason;
+    if (!plan_closed_form(node, &recs, &count, &reason)) {
+        if (reason) remark("loop over '%s' not closed: %s", counted_loop_var(node)->name, reason);
+        return 0;
+    }
+    Symbol *var = counted_loop_var(node);
+    ASTNode **start = &node->children[0]->children[0];
+    ASTNode **bound = &node->children[1]->children[1];
+    int constant = (*start)->type == NODE_INT && (*bound)->type == NODE_INT;
+    long trip = constant ? (long)(*bound)->int_value - (*start)->int_value : 0;
+    ASTNode *updates = new_node(NODE_SEQUENCE);
+    for (int i = 0; i < count; i++) {
+        ASTNode *step = recs[i].step ? *recs[i].step : NULL;
+        ASTNode *total;
+        int value = 1;
+        if (recs[i].series && constant) {
+            total = make_int((int)(trip * ((long)(*start)->int_value + (*bound)->int_value - 1) / 2));
+        } else if (recs[i].series) {
+            ASTNode *trips = make_binary(OP_SUB, copy_ast(*bound), copy_ast(*start));
+            ASTNode *ends = make_binary(OP_SUB, make_binary(OP_ADD, copy_ast(*start), copy_ast(*bound)),
+                                        make_int(1));
+            total = make_binary(OP_DIV, make_binary(OP_MUL, trips, ends), make_int(2));
+        } else if (constant && (!step || constant_int_arg(step, &value))) {
+            total = make_int((int)(trip * value));
+        } else {
+            total = constant ? make_int((int)trip) : make_binary(OP_SUB, copy_ast(*bound), copy_ast(*start));
+            if (step) total = make_binary(OP_MUL, total, copy_ast(step));
+        }
+        if (total->type == NODE_INT && total->int_value == 0) {
+            free_ast(total);
+            continue;
+        }
+        append_child(updates, make_accumulate(recs[i].acc, recs[i].op, total));
+    }
+    remark("loop over '%s' replaced by the closed form of %d accumulator(s)", var->name, count);
+
+    ASTNode *guard = constant ? NULL : make_binary(OP_LT, copy_ast(*start), copy_ast(*bound));
+    replace_with_empty(node);
+    if (guard) {
+        node->type = NODE_IF_STMT;
+        append_child(node, guard);
+    }
+    append_child(node, updates);
+    free(recs);
+    return 1;
+}
+
+/* Does the subtree read, assign or declare the variable? */
+int mentions_var(ASTNode *node, Symbol *sym) {
+    if (!node) return 0;
+    if (((node->type == NODE_VAR || node->type == NODE_ASSIGNMENT) && node->sym == sym) ||
+        declares_var(node, sym))
+        return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (mentions_var(node->children[i], sym)) return 1;
+    }
+    return 0;
+}
+
+/* Does the subtree use the name, whatever it resolves to? */
+int mentions_name(ASTNode *node, const char *name) {
+    if (!node) return 0;
+    if ((node->type == NODE_VAR || node->type == NODE_DECLARATION || node->type == NODE_REPEAT ||
+         node->type == NODE_ASSIGNMENT) &&
+        node->name && strcmp(node->name, name) == 0)
+        return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (mentions_name(node->children[i], name)) return 1;
+    }
+    return 0;
+}
+
+/* Does anything written in writer get read or written in other? A
+   declaration conflicts with any use of its name in other, since placing
+   both in one block would capture or redeclare that name. */
+int writes_conflict(ASTNode *writer, ASTNode *other) {
+    if (!writer) return 0;
+    if (writer->type == NODE_DECLARATION && writer->name && mentions_name(other, writer->name))
+        return 1;
+    Symbol *target = written_var(writer);
+    if (target && mentions_var(other, target)) return 1;
+    for (int i = 0; i < writer->child_count; i++) {
+        if (writes_conflict(writer->children[i], other)) return 1;
+    }
+    return 0;
+}
+
+/* Does the expression read a variable that the subtree writes? */
+int reads_var_written_by(ASTNode *expr, ASTNode *writer) {
+    if (!expr) return 0;
+    if (expr->type == NODE_VAR && writes_var(writer, expr->sym)) return 1;
+    for (int i = 0; i < expr->child_count; i++) {
+        if (reads_var_written_by(expr->children[i], writer)) return 1;
+    }
+    return 0;
+}
+
+/* Two loops can be fused when they declare an induction variable, under
+   any name, with identical init, condition and update, neither body
+   changes the iteration space, and the bodies touch disjoint variables.
+   The fused loop evaluates one header: the headers must have no side
+   effects, and the first loop must not change what the second header
+   computes. Side-effecting calls keep their relative order only if at
+   most one body makes them: two loops that both print would interleave
+   their output. Accumulator loops are left to the closed form, which a
+   loop fused with other work would no longer match. */
+int can_fuse_loops(ASTNode *first, ASTNode *second) {
+    if (!first || !second) return 0;
+    if (first->type != NODE_FOR_STMT || second->type != NODE_FOR_STMT) return 0;
+    if (first->child_count != 4 || second->child_count != 4) return 0;
+    ASTNode *init = first->children[0];
+    ASTNode *cond = first->children[1];
+    ASTNode *body1 = first->children[3];
+    ASTNode *body2 = second->children[3];
+    if (init->type != NODE_DECLARATION || !init->sym) return 0;
+    if (second->children[0]->type != NODE_DECLARATION) return 0;
+    if (closes_to_closed_form(first) || closes_to_closed_form(second)) return 0;
+    /* Each loop declares its own induction variable; compare them as one */
+    for (int i = 0; i < 3; i++) {
+        if (!ast_equal_renamed(first->children[i], second->children[i], init->sym, second->children[0]->sym))
+            return 0;
+    }
+    if (writes_var(body1, init->sym) || writes_var(body2, second->children[0]->sym)) return 0;
+    /* The second body is renamed to the first induction variable, which
+       must not capture a name it already uses */
+    if (strcmp(init->name, second->children[0]->name) != 0 && mentions_name(body2, init->name))
+        return 0;
+    /* Only the first header is evaluated, once per fused iteration */
+    for (int i = 0; i < 3; i++) {
+        if (has_side_effects(first->children[i]) || has_side_effects(second->children[i])) return 0;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (writes_any_var(first->children[i]) || writes_any_var(second->children[i])) return 0;
+        if (reads_var_written_by(second->children[i], body1) ||
+            reads_var_written_by(second->children[i], first->children[2]))
+            return 0;
+    }
+    if (reads_var_written_by(cond, body1) || reads_var_written_by(cond, body2)) return 0;
+    if (writes_conflict(body1, body2) || writes_conflict(body2, body1)) return 0;
+    if (has_side_effects(body1) && has_side_effects(body2)) return 0;
+    return 1;
+}
+
+/* Last statement of a block, looking through nested and empty sequences */
+ASTNode *last_statement(ASTNode *node) {
+    if (!node || node->type != NODE_SEQUENCE) return node;
+    for (int i = node->child_count - 1; i >= 0; i--) {
+        ASTNode *last = last_statement(node->children[i]);
+        if (last) return last;
+    }
+    return NULL;
+}
+
+/* Loop fusion: merge each FOR_STMT in a sequence into the loop that
+   immediately precedes it when both iterate over the same space. Runs
+   before the children are optimized so the fused body is unrolled once. */
+int fuse_adjacent_loops(ASTNode *node) {
+    if (node->type != NODE_SEQUENCE) return 0;
+    int fused = 0;
+    for (int i = 1; i < node->child_count; i++) {
+        ASTNode *second = node->children[i];
+        ASTNode *first = last_statement(node->children[i - 1]);
+        if (!can_fuse_loops(first, second)) continue;
+
+        ASTNode *merged = new_node(NODE_SEQUENCE);
+        rename_symbol(second->children[3], second->children[0]->sym, first->children[0]->sym);
+        append_child(merged, first->children[3]);
+        append_child(merged, detach_child(second, 3));
+        first->children[3] = merged;
+        free_ast(detach_child(node, i));
+        i--;
+        fused++;
+        remark("fused two adjacent loops over '%s'", first->children[0]->name);
+    }
+    return fused;
+}
+
+/* Structural simplification of a block: splice nested sequences flat,
+   drop self-assignments and statements after a return, and replace a
+   single-statement sequence by that statement. Empty sequences disappear
+   when their parent block is flattened. */
+int simplify_sequence(ASTNode *node) {
+    if (node->type != NODE_SEQUENCE) return 0;
+    int changed = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        ASTNode *stmt = node->children[i];
+        if (stmt->type == NODE_SEQUENCE) {
+            /* Revisit position i: it now holds the first spliced statement */
+            splice_child(node, i--);
+            changed = 1;
+        } else if (stmt->type == NODE_ASSIGNMENT && stmt->child_count == 1 && stmt->sym &&
+                   stmt->children[0]->type == NODE_VAR && stmt->children[0]->sym == stmt->sym) {
+            free_ast(detach_child(node, i--));
+            changed = 1;
+        } else if (stmt->type == NODE_RETURN_STMT) {
+            while (node->child_count > i + 1) {
+                free_ast(detach_child(node, i + 1));
+                changed = 1;
+            }
+        }
+    }
+    if (node->child_count == 1) {
+        replace_with_child(node, 0);
+        changed = 1;
+    }
+    return changed;
+}
+
+/* Output merging. The text a statement prints, when it always prints the
+   same bytes and does nothing else, is collected decoded; size is the
+   length of the string literal that spells it (see output_literal). */
+typedef struct {
+    char *bytes;
+    int length, capacity;
+    int size;
+    int limit;      /* largest size allowed */
+} OutputText;
+
+/* Characters a byte takes inside a literal written by output_literal.
+   ')' is escaped because the dump loaders end a node's text at the first
+   one. */
+int literal_char_size(int c) {
+    if (c == '\n' || c == '\t') return 2;
+    if (c >= ' ' && c < 127 && c != '"' && c != '\\' && c != ')') return 1;
+    return 4;
+}
+
+/* Append one byte; returns 0 if the literal would exceed the limit */
+int output_append(OutputText *text, int c) {
+    if (text->size + literal_char_size(c) > text->limit) return 0;
+    if (text->length == text->capacity) {
+        text->capacity = text->capacity ? text->capacity * 2 : 64;
+        text->bytes = realloc(text->bytes, text->capacity);
+        if (!text->bytes) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+    }
+    text->bytes[text->length++] = (char)c;
+    text->size += literal_char_size(c);
+    return 1;
+}
+
+/* Append the bytes a string literal stands for. As a printf format, "%%"
+   prints one '%' and any other conversion makes the output not static;
+   so do escapes this does not decode, NUL bytes and a literal the loader
+   cut short. */
+int output_append_literal(OutputText *text, const char *s, int is_format) {
+    size_t len = strlen(s);
+    if (len < 2 || s[0] != '"' || s[len - 1] != '"') return 0;
+    s++;
+    len -= 2;
+    const char *end = s + len;
+    while (s < end) {
+        int c = (unsigned char)*s++;
+        if (c == '\\') {
+            if (s == end) return 0;
+            c = (unsigned char)*s++;
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'a': c = '\a'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                case '\\': case '"': case '\'': case '?': break;
+                default:
+                    if (c < '0' || c > '7') return 0;
+                    c -= '0';
+                    for (int k = 0; k < 2 && s < end && *s >= '0' && *s <= '7'; k++) c = c * 8 + (*s++ - '0');
+                    if (c == 0 || c > 255) return 0;
+                    break;
+            }
+        } else if (c == '%' && is_format) {
+            if (s == end || *s != '%') return 0;
+            s++;
+        }
+        if (!output_append(text, c)) return 0;
+    }
+    return 1;
+}
+
+/* Append the output of a statement that always prints the same text and
+   has no other effect: printf of a literal without conversions, puts,
+   fputs to stdout, putchar of a constant, and blocks and unrolled loops
+   of those. Returns 0 if the statement is not one or the text does not
+   fit the limit; *calls counts the output calls it makes. */
+int static_output(ASTNode *stmt, OutputText *text, long *calls) {
+    switch (stmt->type) {
+        case NODE_SEQUENCE:
+            for (int i = 0; i < stmt->child_count; i++) {
+                if (!static_output(stmt->children[i], text, calls)) return 0;
+            }
+            return 1;
+        case NODE_REPEAT: {
+            if (stmt->child_count != 3 || stmt->children[1]->type != NODE_INT) return 0;
+            int count = stmt->children[1]->int_value;
+            int start = text->length, start_size = text->size;
+            long body_calls = 0;
+            if (!static_output(stmt->children[2], text, &body_calls)) return 0;
+            if (count <= 0) {
+                text->length = start;
+                text->size = start_size;
+                return 1;
+            }
+            int body_length = text->length - start;
+            for (int k = 1; k < count; k++) {
+                for (int j = 0; j < body_length; j++) {
+                    if (!output_append(text, (unsigned char)text->bytes[start + j])) return 0;
+                }
+            }
+            *calls += body_calls * count;
+            return 1;
+        }
+        case NODE_FUNCTION_CALL: {
+            if (!stmt->name || stmt->child_count != 1 || stmt->children[0]->type != NODE_EXPR_LIST) return 0;
+            ASTNode *args = stmt->children[0];
+            if (args->child_count < 1) return 0;
+            ASTNode *arg = args->children[0];
+            int ok;
+            if (strcmp(stmt->name, "printf") == 0 && args->child_count == 1 && arg->type == NODE_STRING) {
+                ok = output_append_literal(text, arg->string_value, 1);
+            } else if (strcmp(stmt->name, "puts") == 0 && args->child_count == 1 && arg->type == NODE_STRING) {
+                ok = output_append_literal(text, arg->string_value, 0) && output_append(text, '\n');
+            } else if (strcmp(stmt->name, "fputs") == 0 && args->child_count == 2 && arg->type == NODE_STRING &&
+                       args->children[1]->type == NODE_VAR && args->children[1]->sym &&
+                       !args->children[1]->sym->decl && strcmp(args->children[1]->name, "stdout") == 0) {
+                ok = output_append_literal(text, arg->string_value, 0);
+            } else if (strcmp(stmt->name, "putchar") == 0 && args->child_count == 1 && arg->type == NODE_INT &&
+                       (arg->int_value & 0xff) != 0) {
+                ok = output_append(text, arg->int_value & 0xff);
+            } else {
+                return 0;
+            }
+            if (!ok) return 0;
+            (*calls)++;
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+/* The quoted literal for the text, octal-escaping everything that is not
+   plain printable ASCII */
+char *output_literal(OutputText *text) {
+    char *literal = malloc(text->size + 3);
+    if (!literal) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    char *p = literal;
+    *p++ = '"';
+    for (int i = 0; i < text->length; i++) {
+        int c = (unsigned char)text->bytes[i];
+        if (c == '\n') {
+            *p++ = '\\';
+            *p++ = 'n';
+        } else if (c == '\t') {
+            *p++ = '\\';
+            *p++ = 't';
+        } else if (literal_char_size(c) == 1) {
+            *p++ = (char)c;
+        } else {
+            *p++ = '\\';
+            *p++ = (char)('0' + (c >> 6));
+            *p++ = (char)('0' + ((c >> 3) & 7));
+            *p++ = (char)('0' + (c & 7));
+        }
+    }
+    *p++ = '"';
+    *p = 0;
+    return literal;
+}
+
+/* The undeclared symbol stdout, created if the function never names it */
+Symbol *stdout_symbol(void) {
+    Symbol *sym = NULL;
+    pthread_mutex_lock(&symtab_lock);
+    for (int i = 0; i < symtab.count && !sym; i++) {
+        if (!symtab.symbols[i]->decl && strcmp(symtab.symbols[i]->name, "stdout") == 0)
+            sym = symtab.symbols[i];
+    }
+    if (!sym) sym = symbol_create(&symtab, "stdout", NULL);
+    pthread_mutex_unlock(&symtab_lock);
+    return sym;
+}
+
+/* Replace statements [first, end) of a block by fputs(text, stdout) */
+void replace_output_run(ASTNode *node, int first, int end, OutputText *text) {
+    ASTNode *call = new_node(NODE_FUNCTION_CALL);
+    call->name = strdup("fputs");
+    ASTNode *args = new_node(NODE_EXPR_LIST);
+    ASTNode *literal = new_node(NODE_STRING);
+    literal->string_value = output_literal(text);
+    ASTNode *stream = new_node(NODE_VAR);
+    stream->name = strdup("stdout");
+    stream->sym = stdout_symbol();
+    append_child(args, literal);
+    append_child(args, stream);
+    append_child(call, args);
+    for (int i = end - 1; i > first; i--) {
+        free_ast(detach_child(node, i));
+    }
+    replace_child(node, first, call);
+}
+
+/* Merge each run of statements in a block that print fixed text with at
+   least two output calls between them into a single fputs of the
+   concatenated text: one call and one stdio lock instead of many. A run
+   is cut where the literal would exceed the budget. */
+int merge_output_calls(ASTNode *node) {
+    if (node->type != NODE_SEQUENCE || cost_config.output_budget <= 0) return 0;
+    OutputText text = { NULL, 0, 0, 0, cost_config.output_budget };
+    int merged = 0;
+    int i = 0;
+    while (i < node->child_count) {
+        int end = i;
+        long calls = 0;
+        text.length = text.size = 0;
+        while (end < node->child_count) {
+            int length = text.length, size = text.size;
+            long stmt_calls = 0;
+            if (!static_output(node->children[end], &text, &stmt_calls)) {
+                text.length = length;
+                text.size = size;
+                break;
+            }
+            calls += stmt_calls;
+            end++;
+        }
+        if (calls < 2) {
+            i = end > i ? end : i + 1;
+            continue;
+        }
+        replace_output_run(node, i, end, &text);
+        remark("merged %ld output calls into one fputs of %d bytes", calls, text.length);
+        merged++;
+        i++;
+    }
+    free(text.bytes);
+    return merged;
+}
+
+/* Library call specialization. The value of an argument is known when it
+   is a literal or range analysis proved it constant. */
+int constant_int_arg(ASTNode *arg, int *value) {
+    if (arg->type == NODE_INT) {
+        *value = arg->int_value;
+        return 1;
+    }
+    if (!arg->has_range || arg->range_lo != arg->range_hi) return 0;
+    if (has_side_effects(arg) || writes_any_var(arg)) return 0;
+    *value = (int)arg->range_lo;
+    return 1;
+}
+
+/* The NUL-terminated bytes a string literal stands for, or NULL */
+char *decode_literal(const char *s) {
+    OutputText text = { NULL, 0, 0, 0, INT_MAX };
+    if (!output_append_literal(&text, s, 0)) {
+        free(text.bytes);
+        return NULL;
+    }
+    output_append(&text, 0);
+    return text.bytes;
+}
+
+/* A value known at compile time: an int, a string literal (the STRING
+   node), or a value the C library leaves unspecified, such as what puts
+   returns */
+typedef enum {
+    VALUE_INT,
+    VALUE_STRING,
+    VALUE_UNKNOWN
+} ValueKind;
+
+typedef struct {
+    ValueKind kind;
+    int i;
+    ASTNode *string;
+} Value;
+
+/* Append what printf(format, args...) prints, format being decoded.
+   Supports flags, width and precision on d, i, u, o, x, X, c and s, and
+   "%%"; anything else, a '*', an argument of the wrong kind or count, or
+   a NUL byte in the output fails. */
+int format_printf(OutputText *text, const char *format, const Value *args, int argc) {
+    int next = 0;
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            if (!output_append(text, (unsigned char)*p)) return 0;
+            continue;
+        }
+        if (p[1] == '%') {
+            if (!output_append(text, '%')) return 0;
+            p++;
+            continue;
+        }
+        char spec[32];
+        size_t len = strspn(p + 1, "-+ #0123456789.") + 1;
+        char conv = p[len];
+        if (len + 1 >= sizeof(spec) || !conv || !strchr("diuoxXcs", conv) || next >= argc) return 0;
+        memcpy(spec, p, len + 1);
+        spec[len + 1] = 0;
+        p += len;
+        const Value *arg = &args[next++];
+        char buf[OUTPUT_LITERAL_MAX + 1];
+        int n;
+        if (conv == 's') {
+            char *str = arg->kind == VALUE_STRING ? decode_literal(arg->string->string_value) : NULL;
+            if (!str) return 0;
+            n = snprintf(buf, sizeof(buf), spec, str);
+            free(str);
+        } else if (arg->kind == VALUE_INT) {
+            if (conv == 'c' && (unsigned char)arg->i == 0) return 0;
+            n = conv == 'd' || conv == 'i' || conv == 'c' ? snprintf(buf, sizeof(buf), spec, arg->i)
+                                                          : snprintf(buf, sizeof(buf), spec, (unsigned)arg->i);
+        } else {
+            return 0;
+        }
+        if (n < 0 || n >= (int)sizeof(buf)) return 0;
+        for (int i = 0; i < n; i++) {
+            if (!output_append(text, (unsigned char)buf[i])) return 0;
+        }
+    }
+    return next == argc;
+}
+
+/* Evaluate printf(format, args...) when the format and every argument are
+   constant, appending what it prints */
+int evaluate_printf(ASTNode *args, OutputText *text) {
+    char *format = decode_literal(args->children[0]->string_value);
+    if (!format) return 0;
+    int argc = args->child_count - 1, ok = 1;
+    Value *values = calloc(argc ? argc : 1, sizeof(Value));
+    for (int i = 0; i < argc && ok; i++) {
+        ASTNode *arg = args->children[i + 1];
+        if (arg->type == NODE_STRING) {
+            values[i].kind = VALUE_STRING;
+            values[i].string = arg;
+        } else {
+            ok = constant_int_arg(arg, &values[i].i);
+        }
+    }
+    ok = ok && format_printf(text, format, values, argc);
+    free(values);
+    free(format);
+    return ok;
+}
+
+/* The call that prints the text: puts when it ends in a newline, else
+   fputs to stdout */
+ASTNode *output_call(OutputText *text) {
+    int is_puts = text->length > 0 && text->bytes[text->length - 1] == '\n';
+    if (is_puts) text->length--;
+    ASTNode *call = new_node(NODE_FUNCTION_CALL);
+    call->name = strdup(is_puts ? "puts" : "fputs");
+    ASTNode *args = new_node(NODE_EXPR_LIST);
+    ASTNode *literal = new_node(NODE_STRING);
+    literal->string_value = output_literal(text);
+    append_child(args, literal);
+    if (!is_puts) {
+        ASTNode *stream = new_node(NODE_VAR);
+        stream->name = strdup("stdout");
+        stream->sym = stdout_symbol();
+        append_child(args, stream);
+    }
+    append_child(call, args);
+    return call;
+}
+
+/* Is child i of the node a statement, whose value is discarded? */
+int is_statement_child(ASTNode *node, int i) {
+    switch (node->type) {
+        case NODE_SEQUENCE:
+        case NODE_FUNCTION_DEF: return 1;
+        case NODE_IF_STMT: return i >= 1;
+        case NODE_FOR_STMT: return i == 3;
+        case NODE_REPEAT: return i == 2;
+        default: return 0;
+    }
+}
+
+/* Rewrite a call statement: a printf whose output is known becomes puts or
+   fputs of that text (the format is then never parsed at run time), and
+   a pure call, the constant it folded to, or a printf that prints nothing
+   is removed. Returns the replacement, an empty SEQUENCE to remove it, or
+   NULL to keep it. */
+ASTNode *specialize_call_statement(ASTNode *stmt) {
+    if (stmt->type == NODE_INT) return new_node(NODE_SEQUENCE);
+    if (stmt->type != NODE_FUNCTION_CALL || !stmt->name) return NULL;
+    ASTNode *args = stmt->child_count == 1 && stmt->children[0]->type == NODE_EXPR_LIST
+                        ? stmt->children[0] : NULL;
+    if (call_is_pure(stmt->name) && !has_side_effects(args) && !writes_any_var(args)) {
+        remark("removed unused call to pure function %s", stmt->name);
+        return new_node(NODE_SEQUENCE);
+    }
+    if (strcmp(stmt->name, "printf") != 0 || !args || args->child_count < 1 ||
+        args->children[0]->type != NODE_STRING)
+        return NULL;
+    OutputText text = { NULL, 0, 0, 0, OUTPUT_LITERAL_MAX };
+    if (!evaluate_printf(args, &text)) {
+        free(text.bytes);
+        return NULL;
+    }
+    ASTNode *call = text.length > 0 ? output_call(&text) : new_node(NODE_SEQUENCE);
+    remark("printf evaluated at compile time: %s", call->name ? call->name : "prints nothing");
+    free(text.bytes);
+    return call;
+}
+
+/* Specialize library calls: fold a pure call on constant arguments to its
+   value, and specialize the call statements of the node */
+int specialize_library_calls(ASTNode *node) {
+    if (node->type == NODE_FUNCTION_CALL) {
+        const CallInfo *info = find_call(node->name);
+        if (!info || !info->fold || node->child_count != 1 || node->children[0]->type != NODE_EXPR_LIST ||
+            node->children[0]->child_count != 1)
+            return 0;
+        int a, res;
+        if (!constant_int_arg(node->children[0]->children[0], &a) || !info->fold(a, &res)) return 0;
+        replace_with_int(node, res);
+        return 1;
+    }
+    int changed = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        if (!is_statement_child(node, i)) continue;
+        ASTNode *replacement = specialize_call_statement(node->children[i]);
+        if (!replacement) continue;
+        if (node->type == NODE_SEQUENCE && replacement->type == NODE_SEQUENCE) {
+            free_ast(replacement);
+            free_ast(detach_child(node, i--));
+        } else {
+            replace_child(node, i, replacement);
+        }
+        changed = 1;
+    }
+    return changed;
+}
+
+/* An if-statement with an empty body and a side-effect-free condition does nothing */
+int eliminate_empty_if(ASTNode *node) {
+    if (node->type != NODE_IF_STMT || node->child_count < 2) return 0;
+    ASTNode *body = node->children[1];
+    ASTNode *cond = node->children[0];
+    if (body->type != NODE_SEQUENCE || body->child_count != 0) return 0;
+    if (has_side_effects(cond) || writes_any_var(cond)) return 0;
+    replace_with_empty(node);
+    return 1;
+}
+
+/* Integer range analysis. Every variable maps to an interval [lo, hi]
+   of the values it may hold at the current program point, indexed by
+   symbol id; an unknown value is [INT_MIN, INT_MAX]. */
+typedef struct {
+    long lo, hi;
+} RangeEntry;
+
+typedef struct {
+    RangeEntry *entries;
+    int count;
+} RangeEnv;
+
+RangeEntry *range_lookup(RangeEnv *env, Symbol *sym) {
+    if (!sym || sym->id >= env->count) return NULL;
+    return &env->entries[sym->id];
+}
+
+void range_forget(RangeEnv *env, Symbol *sym) {
+    RangeEntry *e = range_lookup(env, sym);
+    if (e) {
+        e->lo = INT_MIN;
+        e->hi = INT_MAX;
+    }
+}
+
+/* Clamp an interval to int; anything that may overflow becomes unknown */
+void range_normalize(long *lo, long *hi) {
+    if (*lo < INT_MIN || *hi > INT_MAX || *lo > *hi) {
+        *lo = INT_MIN;
+        *hi = INT_MAX;
+    }
+}
+
+/* Range of a call to a library function the optimizer can fold, found by
+   folding every value of an argument with at most 256 possible values */
+void call_range(ASTNode *node, long *lo, long *hi) {
+    const CallInfo *info = find_call(node->name);
+    if (!info || !info->fold || node->child_count != 1 || node->children[0]->type != NODE_EXPR_LIST ||
+        node->children[0]->child_count != 1)
+        return;
+    ASTNode *arg = node->children[0]->children[0];
+    if (!arg->has_range || arg->range_hi - arg->range_lo >= 256) return;
+    long res_lo = INT_MAX, res_hi = INT_MIN;
+    for (long a = arg->range_lo; a <= arg->range_hi; a++) {
+        int res;
+        if (!info->fold((int)a, &res)) return;
+        if (res < res_lo) res_lo = res;
+        if (res > res_hi) res_hi = res;
+    }
+    *lo = res_lo;
+    *hi = res_hi;
+}
+
+/* Range of an expression at the current point. Comparisons with a
+   determined outcome are folded to INT 0 or 1 in place, and assignments
+   and ++/-- update the environment. The result is recorded on the node
+   for later passes; a node whose recorded range changed is marked
+   modified, so the next round revisits it. */
+void expr_range(ASTNode *node, RangeEnv *env, long *lo, long *hi) {
+    *lo = INT_MIN;
+    *hi = INT_MAX;
+    if (!node) return;
+    switch (node->type) {
+        case NODE_INT:
+            *lo = *hi = node->int_value;
+            break;
+        case NODE_VAR: {
+            RangeEntry *e = range_lookup(env, node->sym);
+            if (e) {
+                *lo = e->lo;
+                *hi = e->hi;
+            }
+            break;
+        }
+        case NODE_UNARY_EXPR:
+            if (unary_target(node)) {
+                RangeEntry *e = range_lookup(env, unary_target(node));
+                if (!e) break;
+                *lo = e->lo;
+                *hi = e->hi;
+                long delta = node->op == OP_DEC ? -1 : 1;
+                long new_lo = e->lo + delta, new_hi = e->hi + delta;
+                range_normalize(&new_lo, &new_hi);
+                e->lo = new_lo;
+                e->hi = new_hi;
+            }
+            break;
+        case NODE_ASSIGNMENT: {
+            if (node->child_count == 1) expr_range(node->children[0], env, lo, hi);
+            RangeEntry *e = range_lookup(env, node->sym);
+            if (e) {
+                e->lo = *lo;
+                e->hi = *hi;
+            }
+            break;
+        }
+        case NODE_FUNCTION_CALL:
+            for (int i = 0; i < node->child_count; i++) {
+                long ignore_lo, ignore_hi;
+                expr_range(node->children[i], env, &ignore_lo, &ignore_hi);
+            }
+            call_range(node, lo, hi);
+            break;
+        case NODE_BINARY_EXPR: {
+            if (node->child_count != 2) break;
+            long a_lo, a_hi, b_lo, b_hi;
+            expr_range(node->children[0], env, &a_lo, &a_hi);
+            expr_range(node->children[1], env, &b_lo, &b_hi);
+            if (node->op == OP_ADD) {
+                *lo = a_lo + b_lo;
+                *hi = a_hi + b_hi;
+            } else if (node->op == OP_SUB) {
+                *lo = a_lo - b_hi;
+                *hi = a_hi - b_lo;
+            } else if (node->op == OP_MUL || node->op == OP_DIV) {
+                int is_div = node->op == OP_DIV;
+                if (is_div && b_lo <= 0 && b_hi >= 0) break;
+                long c[4];
+                c[0] = is_div ? a_lo / b_lo : a_lo * b_lo;
+                c[1] = is_div ? a_lo / b_hi : a_lo * b_hi;
+                c[2] = is_div ? a_hi / b_lo : a_hi * b_lo;
+                c[3] = is_div ? a_hi / b_hi : a_hi * b_hi;
+                *lo = *hi = c[0];
+                for (int i = 1; i < 4; i++) {
+                    if (c[i] < *lo) *lo = c[i];
+                    if (c[i] > *hi) *hi = c[i];
+                }
+            } else if (node->op == OP_LT) {
+                *lo = 0;
+                *hi = 1;
+                if (a_hi < b_lo) *lo = 1;
+                else if (a_lo >= b_hi) *hi = 0;
+                if (*lo == *hi && !has_side_effects(node) && !writes_any_var(node)) {
+                    replace_with_int(node, (int)*lo);
+                    node->modified = 1;
+                }
+            }
+            range_normalize(lo, hi);
+            break;
+        }
+        default:
+            for (int i = 0; i < node->child_count; i++) {
+                long ignore_lo, ignore_hi;
+                expr_range(node->children[i], env, &ignore_lo, &ignore_hi);
+            }
+            return;
+    }
+    int has_range = !(*lo == INT_MIN && *hi == INT_MAX);
+    if (has_range != node->has_range ||
+        (has_range && (*lo != node->range_lo || *hi != node->range_hi)))
+        node->modified = 1;
+    node->has_range = has_range;
+    node->range_lo = *lo;
+    node->range_hi = *hi;
+}
+
+/* Forget what is known about every variable the subtree writes */
+void range_widen_written(RangeEnv *env, ASTNode *node) {
+    if (!node) return;
+    if (node->type == NODE_DECLARATION || node->type == NODE_REPEAT) range_forget(env, node->sym);
+    if (written_var(node)) range_forget(env, written_var(node));
+    for (int i = 0; i < node->child_count; i++) {
+        range_widen_written(env, node->children[i]);
+    }
+}
+
+/* Analyze statements in order, folding comparisons whose outcome the
+   current ranges determine */
+void range_statement(ASTNode *node, RangeEnv *env) {
+    if (!node) return;
+    long lo, hi;
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+        case NODE_SEQUENCE:
+            for (int i = 0; i < node->child_count; i++) {
+                range_statement(node->children[i], env);
+            }
+            break;
+        case NODE_DECLARATION: {
+            lo = INT_MIN;
+            hi = INT_MAX;
+            if (node->child_count == 1) expr_range(node->children[0], env, &lo, &hi);
+            RangeEntry *e = range_lookup(env, node->sym);
+            if (e) {
+                e->lo = lo;
+                e->hi = hi;
+            }
+            break;
+        }
+        case NODE_IF_STMT: {
+            if (node->child_count < 2) break;
+            expr_range(node->children[0], env, &lo, &hi);
+            ASTNode *cond = node->children[0];
+            if (cond->type == NODE_INT && cond->int_value == 0) break;
+            int always = cond->type == NODE_INT;
+            int count = env->count;
+            RangeEntry *before = malloc((count ? count : 1) * sizeof(RangeEntry));
+            memcpy(before, env->entries, count * sizeof(RangeEntry));
+            range_statement(node->children[1], env);
+            if (!always) {
+                /* The body may or may not have run: join both outcomes */
+                for (int i = 0; i < count; i++) {
+                    if (before[i].lo < env->entries[i].lo) env->entries[i].lo = before[i].lo;
+                    if (before[i].hi > env->entries[i].hi) env->entries[i].hi = before[i].hi;
+                }
+            }
+            free(before);
+            break;
+        }
+        case NODE_FOR_STMT: {
+            if (node->child_count != 4) break;
+            ASTNode *cond = node->children[1];
+            Symbol *ivar = counted_loop_var(node);
+            long start_lo = INT_MIN, bound_lo = INT_MIN, bound_hi = INT_MAX;
+            range_statement(node->children[0], env);
+            if (ivar) {
+                RangeEntry *e = range_lookup(env, ivar);
+                if (e) start_lo = e->lo;
+                ASTNode *bound = cond->children[1];
+                if (is_loop_invariant(bound, node)) {
+                    expr_range(bound, env, &bound_lo, &bound_hi);
+                    /* A bound with a single possible value lets later passes count trips */
+                    if (bound_lo == bound_hi && bound->type != NODE_INT && !has_side_effects(bound)) {
+                        bound = new_node(NODE_INT);
+                        bound->int_value = (int)bound_lo;
+                        replace_child(cond, 1, bound);
+                    }
+                } else {
+                    ivar = NULL;
+                }
+            }
+            range_widen_written(env, node);
+            expr_range(cond, env, &lo, &hi);
+            if (ivar) {
+                /* Inside the body start <= i < bound */
+                RangeEntry *e = range_lookup(env, ivar);
+                if (e && bound_hi != INT_MAX && start_lo != INT_MIN && start_lo <= bound_hi - 1) {
+                    e->lo = start_lo;
+                    e->hi = bound_hi - 1;
+                }
+            }
+            range_statement(node->children[3], env);
+            expr_range(node->children[2], env, &lo, &hi);
+            range_widen_written(env, node);
+            break;
+        }
+        case NODE_REPEAT: {
+            /* children: 0 first value, 1 count, 2 body run with first <= i < first + count */
+            if (node->child_count != 3) break;
+            long first = node->children[0]->int_value, count = node->children[1]->int_value;
+            if (count <= 0) break;
+            range_widen_written(env, node);
+            RangeEntry *e = range_lookup(env, node->sym);
+            if (e) {
+                e->lo = first;
+                e->hi = first + count - 1;
+            }
+            range_statement(node->children[2], env);
+            range_widen_written(env, node);
+            break;
+        }
+        default:
+            expr_range(node, env, &lo, &hi);
+            break;
+    }
+}
+
+/* Mark every ancestor of a modified node. Returns whether the node is
+   now marked. */
+int mark_modified_ancestors(ASTNode *node) {
+    for (int i = 0; i < node->child_count; i++) {
+        if (mark_modified_ancestors(node->children[i])) node->modified = 1;
+    }
+    return node->modified;
+}
+
+/* Run range analysis over every function. It runs before each round, so
+   ranges follow the rewrites of the previous round; the subtrees whose
+   ranges changed are marked for the next round. */
+void propagate_ranges(ASTNode *root) {
+    RangeEnv env;
+    env.count = symtab.count;
+    env.entries = malloc((env.count ? env.count : 1) * sizeof(RangeEntry));
+    for (int i = 0; i < env.count; i++) {
+        env.entries[i].lo = INT_MIN;
+        env.entries[i].hi = INT_MAX;
+    }
+    range_statement(root, &env);
+    free(env.entries);
+    mark_modified_ancestors(root);
+}
+
+/* Run one pass on a node and count the visit */
+int run_pass(PassId id, int (*pass)(ASTNode *), ASTNode *node) {
+    pass_visits[id]++;
+    int changed = pass(node);
+    if (changed) pass_changes[id]++;
+    return changed;
+}
+
+/* Add this thread's pass counts to the totals */
+void flush_pass_stats(void) {
+    pthread_mutex_lock(&pool_lock);
+    for (int i = 0; i < PASS_COUNT; i++) {
+        pass_stats[i].visits += pass_visits[i];
+        pass_stats[i].changes += pass_changes[i];
+        pass_visits[i] = pass_changes[i] = 0;
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+int optimize_ast(ASTNode *node);
+
+/* Run task i of a region on the calling thread */
+void run_task(Region *region, int i) {
+    TaskContext context = { region, i };
+    current_task = &context;
+    region->changed[i] = optimize_ast(region->tasks[i]);
+    current_task = NULL;
+    flush_pass_stats();
+    pthread_mutex_lock(&pool_lock);
+    region->done[i] = 1;
+    while (region->done_prefix < region->count && region->done[region->done_prefix])
+        region->done_prefix++;
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/* Next task of a region in child order, or -1. Called with pool_lock held. */
+int take_task(Region *region) {
+    return region->next < region->count ? region->next++ : -1;
+}
+
+void *worker_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&pool_lock);
+    while (!pool_shutdown) {
+        int i = active_region ? take_task(active_region) : -1;
+        if (i < 0) {
+            pthread_cond_wait(&pool_cond, &pool_lock);
+            continue;
+        }
+        Region *region = active_region;
+        pthread_mutex_unlock(&pool_lock);
+        run_task(region, i);
+        pthread_mutex_lock(&pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+void start_workers(void) {
+    workers = malloc((jobs - 1) * sizeof(pthread_t));
+    for (int i = 0; i < jobs - 1; i++) {
+        if (pthread_create(&workers[i], NULL, worker_main, NULL) != 0) {
+            fprintf(stderr, "Cannot start worker thread\n");
+            exit(1);
+        }
+    }
+}
+
+void stop_workers(void) {
+    pthread_mutex_lock(&pool_lock);
+    pool_shutdown = 1;
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+    for (int i = 0; i < jobs - 1; i++) pthread_join(workers[i], NULL);
+    free(workers);
+}
+
+/* Does the subtree have at least *n nodes? Stops counting once it does. */
+int has_nodes(ASTNode *node, long *n) {
+    if (--*n <= 0) return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (has_nodes(node->children[i], n)) return 1;
+    }
+    return 0;
+}
+
+/* Are the children of this block worth optimizing in parallel? Only
+   statement lists qualify, whose children are independent statements,
+   and regions are not nested. */
+int worth_parallel(ASTNode *node) {
+    if (jobs < 2 || current_task || node->type != NODE_SEQUENCE) return 0;
+    int large = 0;
+    for (int i = 0; i < node->child_count && large < 2; i++) {
+        long n = PARALLEL_MIN_NODES;
+        if (node->children[i]->modified && has_nodes(node->children[i], &n)) large++;
+    }
+    return large >= 2;
+}
+
+/* Optimize the modified children of a block as parallel tasks, the
+   calling thread taking part, and join. Same result as the sequential
+   loop in optimize_ast. */
+int optimize_children_parallel(ASTNode *node) {
+    Region region = { 0 };
+    region.tasks = malloc(node->child_count * sizeof(ASTNode *));
+    region.changed = calloc(node->child_count, sizeof(int));
+    region.done = calloc(node->child_count, 1);
+    for (int i = 0; i < node->child_count; i++) {
+        if (node->children[i]->modified)
+            region.tasks[region.count++] = node->children[i];
+    }
+    pthread_mutex_lock(&pool_lock);
+    active_region = &region;
+    pthread_cond_broadcast(&pool_cond);
+    int i;
+    while ((i = take_task(&region)) >= 0) {
+        pthread_mutex_unlock(&pool_lock);
+        run_task(&region, i);
+        pthread_mutex_lock(&pool_lock);
+    }
+    while (region.done_prefix < region.count)
+        pthread_cond_wait(&pool_cond, &pool_lock);
+    active_region = NULL;
+    pthread_mutex_unlock(&pool_lock);
+    int changed = 0;
+    for (i = 0; i < region.count; i++) changed |= region.changed[i];
+    free(region.tasks);
+    free(region.changed);
+    free(region.done);
+    return changed;
+}
+
+/* One bottom-up round of the pass pipeline. Subtrees not modified since
+   the previous round are skipped. Returns whether anything changed; the
+   changed nodes and their ancestors stay marked for the next round. */
+int optimize_ast(ASTNode *node) {
+    if (!node || !node->modified) return 0;
+    node->modified = 0;
+
+    /* Each function gets its own code-size growth budget, once */
+    if (node->type == NODE_FUNCTION_DEF && !node->analyzed) {
+        function_growth = 0;
+        function_budget = scaled_budget(cost_config.function_budget, node->heat);
+    }
+
+    /* Fuse sibling loops before their bodies are unrolled */
+    int changed = run_pass(PASS_FUSE, fuse_adjacent_loops, node);
+
+    /* Recursively optimize children first; passes rewrite them in place.
+       Passes below need the whole block, so parallel tasks join first. */
+    if (worth_parallel(node)) {
+        changed |= optimize_children_parallel(node);
+    } else {
+        for (int i = 0; i < node->child_count; i++) {
+            if (!node->children[i]->modified) continue;
+            changed |= optimize_ast(node->children[i]);
+        }
+    }
+
+    changed |= run_pass(PASS_FOLD, fold_operator_expr, node);
+    changed |= run_pass(PASS_LIBCALLS, specialize_library_calls, node);
+    changed |= run_pass(PASS_DEAD_IF, eliminate_dead_if, node);
+    if (run_pass(PASS_DEAD_LOOP, eliminate_dead_loop, node) ||
+        run_pass(PASS_CLOSED_FORM, close_accumulator_loop, node) ||
+        run_pass(PASS_UNROLL, unroll_loop, node))
+        changed = 1;
+    else
+        changed |= run_pass(PASS_LICM, hoist_loop_invariants, node);
+    changed |= run_pass(PASS_EMPTY_IF, eliminate_empty_if, node);
+    changed |= run_pass(PASS_SIMPLIFY, simplify_sequence, node);
+    changed |= run_pass(PASS_MERGE_OUTPUT, merge_output_calls, node);
+
+    node->analyzed = 1;
+    if (changed) node->modified = 1;
+    return changed;
+}
+
+/* Count the nodes of a tree */
+long count_nodes(ASTNode *node) {
+    if (!node) return 0;
+    long count = 1;
+    for (int i = 0; i < node->child_count; i++) {
+        count += count_nodes(node->children[i]);
+    }
+    return count;
+}
+
+/* Give LICM temporaries consecutive names in program order, so the
+   output does not depend on the order in which loops were optimized */
+void number_temporaries(ASTNode *node, int *next) {
+    if (node->type == NODE_DECLARATION && node->sym && node->sym->temporary) {
+        char name[32];
+        snprintf(name, sizeof(name), "licm_tmp%d", (*next)++);
+        free(node->sym->name);
+        node->sym->name = strdup(name);
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        number_temporaries(node->children[i], next);
+    }
+}
+
+void apply_temporary_names(ASTNode *node) {
+    if ((node->type == NODE_DECLARATION || node->type == NODE_VAR) &&
+        node->sym && node->sym->temporary && strcmp(node->name, node->sym->name) != 0) {
+        free(node->name);
+        node->name = strdup(node->sym->name);
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        apply_temporary_names(node->children[i]);
+    }
+}
+
+void name_temporaries(ASTNode *root) {
+    int next = 0;
+    number_temporaries(root, &next);
+    apply_temporary_names(root);
+}
+
+/* Repeat optimize_ast until a round changes nothing. With --stats, report
+   per-pass visit counts against what full-tree rounds would have cost. */
+void optimize_to_fixed_point(ASTNode *root) {
+    int rounds = 0;
+    long full_visits = 0;
+    if (jobs > 1) start_workers();
+    while (root->modified && rounds < MAX_OPTIMIZE_ROUNDS) {
+        propagate_ranges(root);
+        if (show_stats) full_visits += count_nodes(root);
+        optimize_ast(root);
+        rounds++;
+    }
+    if (jobs > 1) stop_workers();
+    name_temporaries(root);
+    flush_pass_stats();
+    if (!show_stats) return;
+    long visits = 0;
+    fprintf(stderr, "stats: %d round(s), %ld nodes after optimization\n", rounds, count_nodes(root));
+    for (int i = 0; i < PASS_COUNT; i++) {
+        fprintf(stderr, "stats: %-18s %8ld visits %6ld changes\n",
+                pass_stats[i].name, pass_stats[i].visits, pass_stats[i].changes);
+        visits += pass_stats[i].visits;
+    }
+    fprintf(stderr, "stats: %ld pass visits, %ld for full-tree rounds\n", visits, full_visits * PASS_COUNT);
+}
+
+/* Recursively print the AST to a file */
+void print_ast_to_file(ASTNode *node, int indent, Emitter *out) {
+    if (!node) return;
+    emit_indent(out, indent);
+    switch (node->type) {
+        case NODE_FUNCTION_DEF: emit_str(out, "FUNCTION_DEF ("); emit_str(out, node->name ? node->name : ""); emit_str(out, ")\n"); break;
+        case NODE_SEQUENCE: emit_str(out, "SEQUENCE\n"); break;
+        case NODE_DECLARATION: emit_str(out, "DECLARATION ("); emit_str(out, node->name ? node->name : ""); emit_str(out, ")\n"); break;
+        case NODE_ASSIGNMENT: emit_str(out, "ASSIGNMENT ("); emit_str(out, node->name ? node->name : ""); emit_str(out, ")\n"); break;
+        case NODE_INT: emit_str(out, "INT ("); emit_int(out, node->int_value); emit_str(out, ")\n"); break;
+        case NODE_BINARY_EXPR: emit_str(out, "BINARY_EXPR ("); emit_str(out, operator_info(node->op)->spelling); emit_str(out, ")\n"); break;
+        case NODE_VAR: emit_str(out, "VAR ("); emit_str(out, node->name ? node->name : ""); emit_str(out, ")\n"); break;
+        case NODE_IF_STMT:
+            emit_str(out, node->expect > 0 ? "IF_STMT (likely)\n" : node->expect < 0 ? "IF_STMT (unlikely)\n" : "IF_STMT\n");
+            break;
+        case NODE_FUNCTION_CALL: emit_str(out, "FUNCTION_CALL ("); emit_str(out, node->name ? node->name : ""); emit_str(out, ")\n"); break;
+        case NODE_EXPR_LIST: emit_str(out, "EXPR_LIST\n"); break;
+        case NODE_FOR_STMT: emit_str(out, "FOR_STMT\n"); break;
+        case NODE_UNARY_EXPR: emit_str(out, "UNARY_EXPR ("); emit_str(out, operator_info(node->op)->spelling); emit_str(out, ")\n"); break;
+        case NODE_RETURN_STMT: emit_str(out, "RETURN_STMT\n"); break;
+        case NODE_STRING: emit_str(out, "STRING (\""); emit_str(out, node->string_value ? node->string_value : ""); emit_str(out, "\")\n"); break;
+        case NODE_REPEAT: emit_str(out, "REPEAT ("); emit_str(out, node->name ? node->name : ""); emit_str(out, ")\n"); break;
+        default: emit_str(out, "UNKNOWN\n"); break;
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        print_ast_to_file(node->children[i], indent + 2, out);
+    }
+}
+
+/* Hash of a node's own fields; merkle_step then adds each child's hash.
+   ast_to_c hashes its nodes the same way, so both tools agree on the
+   profile key of a subtree. */
+uint64_t merkle_seed(ASTNode *node) {
+    uint64_t h = cache_hash_int(CACHE_HASH_SEED, node->type);
+    h = cache_hash_string(h, node->name);
+    h = cache_hash_literal(h, node->string_value);
+    h = cache_hash_int(h, node->int_value);
+    h = cache_hash_int(h, node->op);
+    h = cache_hash_int(h, node->expect);
+    return cache_hash_int(h, node->child_count);
+}
+
+uint64_t merkle_step(uint64_t h, uint64_t child) {
+    return cache_hash_bytes(h, &child, sizeof(child));
+}
+
+/* Hash of a subtree's contents, the same in every run */
+uint64_t merkle_hash(ASTNode *node) {
+    uint64_t h = merkle_seed(node);
+    for (int i = 0; i < node->child_count; i++) {
+        h = merkle_step(h, merkle_hash(node->children[i]));
+    }
+    return h;
+}
+
+/* A site of the input found in the profile */
+typedef struct {
+    ASTNode *node;
+    ProfileEntry *entry;
+} ProfiledSite;
+
+typedef struct {
+    ProfiledSite *sites;
+    int count, capacity;
+    SiteCounter keys;
+} SiteList;
+
+/* Look up every FUNCTION_DEF, IF_STMT and FOR_STMT in the profile,
+   hashing the tree bottom-up in one walk. Returns the subtree's hash. */
+uint64_t find_profiled_sites(ASTNode *node, SiteList *list) {
+    uint64_t h = merkle_seed(node);
+    for (int i = 0; i < node->child_count; i++) {
+        h = merkle_step(h, find_profiled_sites(node->children[i], list));
+    }
+    if (node->type != NODE_FUNCTION_DEF && node->type != NODE_IF_STMT &&
+        node->type != NODE_FOR_STMT)
+        return h;
+    ProfileEntry *entry = profile_find(&profile, profile_site_key(&list->keys, h));
+    if (!entry) return h;
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        ProfiledSite *grown = realloc(list->sites, list->capacity * sizeof(ProfiledSite));
+        if (!grown) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        list->sites = grown;
+    }
+    list->sites[list->count].node = node;
+    list->sites[list->count].entry = entry;
+    list->count++;
+    return h;
+}
+
+/* Heat of a count relative to the hottest of its kind */
+int classify_heat(unsigned long count, unsigned long hottest) {
+    if (count == 0) return PROFILE_COLD;
+    if (count * PROFILE_HOT_RATIO >= hottest) return PROFILE_HOT;
+    return 0;
+}
+
+/* Annotate the input with the profile: branch hints on biased ifs and
+   heat on loops (by iterations) and functions (by calls) */
+void apply_profile(ASTNode *root) {
+    SiteList list = { NULL, 0, 0, { NULL, NULL, 0, 0 } };
+    unsigned long hottest_loop = 0, hottest_function = 0;
+    find_profiled_sites(root, &list);
+    for (int i = 0; i < list.count; i++) {
+        ProfiledSite *site = &list.sites[i];
+        if (site->node->type == NODE_FOR_STMT && site->entry->hits > hottest_loop)
+            hottest_loop = site->entry->hits;
+        if (site->node->type == NODE_FUNCTION_DEF && site->entry->runs > hottest_function)
+            hottest_function = site->entry->runs;
+    }
+    for (int i = 0; i < list.count; i++) {
+        ASTNode *node = list.sites[i].node;
+        ProfileEntry *entry = list.sites[i].entry;
+        if (node->type == NODE_FUNCTION_DEF) {
+            node->heat = classify_heat(entry->runs, hottest_function);
+        } else if (node->type == NODE_FOR_STMT) {
+            node->heat = entry->runs == 0 ? PROFILE_COLD : classify_heat(entry->hits, hottest_loop);
+        } else if (entry->runs > 0) {
+            unsigned long percent = entry->hits * 100 / entry->runs;
+            if (percent >= PROFILE_BIAS_PERCENT) node->expect = 1;
+            else if (percent <= 100 - PROFILE_BIAS_PERCENT) node->expect = -1;
+        }
+    }
+    profiled_sites = list.count;
+    free(list.sites);
+    site_counter_free(&list.keys);
+}
+
+/* Whole-program evaluation (--evaluate). A program that reads no input
+   always prints the same text and returns the same code, so main is run
+   here, on the resolved tree, and replaced by a program that prints that
+   text with write and returns that code. Evaluation gives up, leaving the
+   program to the optimizer, on any call it does not know to be free of
+   other effects, on undefined behaviour (division by zero, signed
+   overflow, reading an uninitialized variable) and when the step or output
+   budget runs out. */
+typedef struct {
+    Value *vars;            /* by symbol id */
+    long steps;
+    OutputText out;
+    const char *failure;    /* why evaluation stopped, or NULL */
+    char failure_buf[96];
+    int returned;
+    Value result;
+} Evaluator;
+
+/* Record why evaluation stopped; returns 0 */
+int eval_fail(Evaluator *ev, const char *fmt, ...) {
+    if (!ev->failure) {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(ev->failure_buf, sizeof(ev->failure_buf), fmt, args);
+        va_end(args);
+        ev->failure = ev->failure_buf;
+    }
+    return 0;
+}
+
+int eval_step(Evaluator *ev) {
+    if (++ev->steps <= evaluate_steps) return 1;
+    return eval_fail(ev, "exceeded the step budget of %d", evaluate_steps);
+}
+
+int eval_int(Evaluator *ev, Value *v, int *out) {
+    if (v->kind != VALUE_INT) return eval_fail(ev, "uses a value that is not a known int");
+    *out = v->i;
+    return 1;
+}
+
+int eval_expr(Evaluator *ev, ASTNode *node, Value *v);
+
+/* Apply an operator to known ints. Signed overflow is undefined behaviour,
+   so it stops evaluation instead of wrapping as folding does. */
+int eval_operator(Evaluator *ev, Operator op, int x, int y, int *res) {
+    const OperatorInfo *info = operator_info(op);
+    long long wide;
+    switch (op) {
+        case OP_ADD: wide = (long long)x + y; break;
+        case OP_SUB: wide = (long long)x - y; break;
+        case OP_MUL: wide = (long long)x * y; break;
+        case OP_INC: wide = (long long)x + 1; break;
+        case OP_DEC: wide = (long long)x - 1; break;
+        default:
+            if (!info->fold || !info->fold(x, y, res))
+                return eval_fail(ev, "has undefined behaviour in %s", info->spelling);
+            return 1;
+    }
+    if (wide < INT_MIN || wide > INT_MAX) return eval_fail(ev, "overflows int in %s", info->spelling);
+    *res = (int)wide;
+    return 1;
+}
+
+/* The calls evaluation can perform: output to stdout and folded pure calls */
+int eval_call(Evaluator *ev, ASTNode *node, Value *v) {
+    ASTNode *args = node->child_count == 1 && node->children[0]->type == NODE_EXPR_LIST ? node->children[0] : NULL;
+    int argc = args ? args->child_count : 0;
+    const char *name = node->name ? node->name : "";
+    int is_fputs = strcmp(name, "fputs") == 0;
+    if (is_fputs) {
+        ASTNode *stream = argc == 2 ? args->children[1] : NULL;
+        if (!stream || stream->type != NODE_VAR || !stream->sym || stream->sym->decl ||
+            strcmp(stream->name, "stdout") != 0)
+            return eval_fail(ev, "calls fputs on a stream other than stdout");
+        argc = 1;
+    }
+    Value *values = calloc(argc ? argc : 1, sizeof(Value));
+    int ok = 1;
+    for (int i = 0; i < argc && ok; i++) ok = eval_expr(ev, args->children[i], &values[i]);
+    const CallInfo *info = find_call(name);
+    v->kind = VALUE_INT;
+    v->i = 0;
+    if (!ok) {
+        /* already failed */
+    } else if (strcmp(name, "printf") == 0 && argc >= 1 && values[0].kind == VALUE_STRING) {
+        char *format = decode_literal(values[0].string->string_value);
+        int before = ev->out.length;
+        ok = format && format_printf(&ev->out, format, values + 1, argc - 1);
+        free(format);
+        if (!ok) eval_fail(ev, "calls printf with a format that cannot be evaluated");
+        v->i = ev->out.length - before;
+    } else if ((strcmp(name, "puts") == 0 || is_fputs) && argc == 1 && values[0].kind == VALUE_STRING) {
+        ok = output_append_literal(&ev->out, values[0].string->string_value, 0) &&
+             (is_fputs || output_append(&ev->out, '\n'));
+        if (!ok) eval_fail(ev, "prints more than the output budget or a NUL byte");
+        v->kind = VALUE_UNKNOWN;
+    } else if (strcmp(name, "putchar") == 0 && argc == 1 && values[0].kind == VALUE_INT &&
+               (unsigned char)values[0].i != 0) {
+        ok = output_append(&ev->out, (unsigned char)values[0].i);
+        if (!ok) eval_fail(ev, "prints more than the output budget");
+        v->i = (unsigned char)values[0].i;
+    } else if (info && info->fold && argc == 1 && values[0].kind == VALUE_INT) {
+        ok = info->fold(values[0].i, &v->i);
+        if (!ok) eval_fail(ev, "calls %s with an argument it is undefined for", name);
+    } else {
+        ok = eval_fail(ev, "calls %s", name);
+    }
+    free(values);
+    return ok;
+}
+
+int eval_expr(Evaluator *ev, ASTNode *node, Value *v) {
+    if (!eval_step(ev)) return 0;
+    switch (node->type) {
+        case NODE_INT:
+            v->kind = VALUE_INT;
+            v->i = node->int_value;
+            return 1;
+        case NODE_STRING:
+            v->kind = VALUE_STRING;
+            v->string = node;
+            return 1;
+        case NODE_VAR:
+            if (!node->sym || !node->sym->decl) return eval_fail(ev, "reads the global %s", node->name);
+            *v = ev->vars[node->sym->id];
+            if (v->kind == VALUE_UNKNOWN) return eval_fail(ev, "reads %s, whose value is not known", node->name);
+            return 1;
+        case NODE_UNARY_EXPR: {
+            Symbol *sym = unary_target(node);
+            int old = 0, res = 0;
+            if (!sym) return eval_fail(ev, "applies %s to something other than a variable", operator_info(node->op)->spelling);
+            if (!eval_int(ev, &ev->vars[sym->id], &old)) return 0;
+            if (!eval_operator(ev, node->op, old, 0, &res)) return 0;
+            ev->vars[sym->id].i = res;
+            v->kind = VALUE_INT;
+            v->i = old;
+            return 1;
+        }
+        case NODE_BINARY_EXPR: {
+            const OperatorInfo *info = operator_info(node->op);
+            Value a, b;
+            int x = 0, y = 0;
+            if (!info->fold || node->child_count != 2) return eval_fail(ev, "uses operator %s", info->spelling);
+            if (!eval_expr(ev, node->children[0], &a) || !eval_expr(ev, node->children[1], &b)) return 0;
+            if (!eval_int(ev, &a, &x) || !eval_int(ev, &b, &y)) return 0;
+            v->kind = VALUE_INT;
+            return eval_operator(ev, node->op, x, y, &v->i);
+        }
+        case NODE_FUNCTION_CALL:
+            return eval_call(ev, node, v);
+        default:
+            return eval_fail(ev, "uses an unsupported expression");
+    }
+}
+
+/* Run a statement; returns 0 when evaluation gives up. A return sets
+   ev->returned, which stops every enclosing statement. */
+int eval_statement(Evaluator *ev, ASTNode *node) {
+    if (!eval_step(ev)) return 0;
+    Value v;
+    int cond = 0;
+    switch (node->type) {
+        case NODE_SEQUENCE:
+            for (int i = 0; i < node->child_count && !ev->returned; i++) {
+                if (!eval_statement(ev, node->children[i])) return 0;
+            }
+            return 1;
+        case NODE_DECLARATION:
+            v.kind = VALUE_UNKNOWN;
+            if (node->child_count == 1 && !eval_expr(ev, node->children[0], &v)) return 0;
+            ev->vars[node->sym->id] = v;
+            return 1;
+        case NODE_ASSIGNMENT:
+            if (!node->sym->decl) return eval_fail(ev, "writes the global %s", node->name);
+            if (node->child_count != 1) return eval_fail(ev, "uses an unsupported assignment");
+            if (!eval_expr(ev, node->children[0], &v)) return 0;
+            ev->vars[node->sym->id] = v;
+            return 1;
+        case NODE_IF_STMT:
+            if (node->child_count != 2) return eval_fail(ev, "uses an unsupported if statement");
+            if (!eval_expr(ev, node->children[0], &v) || !eval_int(ev, &v, &cond)) return 0;
+            return !cond || eval_statement(ev, node->children[1]);
+        case NODE_FOR_STMT:
+            if (node->child_count != 4) return eval_fail(ev, "uses an unsupported for statement");
+            if (!eval_statement(ev, node->children[0])) return 0;
+            for (;;) {
+                if (!eval_expr(ev, node->children[1], &v) || !eval_int(ev, &v, &cond)) return 0;
+                if (!cond) return 1;
+                if (!eval_statement(ev, node->children[3])) return 0;
+                if (ev->returned) return 1;
+                if (!eval_expr(ev, node->children[2], &v)) return 0;
+            }
+        case NODE_REPEAT: {
+            int first, count;
+            if (node->child_count != 3 || !constant_int_arg(node->children[0], &first) ||
+                !constant_int_arg(node->children[1], &count))
+                return eval_fail(ev, "uses an unsupported unrolled loop");
+            for (int k = 0; k < count && !ev->returned; k++) {
+                ev->vars[node->sym->id].kind = VALUE_INT;
+                ev->vars[node->sym->id].i = (int)((unsigned)first + (unsigned)k);
+                if (!eval_statement(ev, node->children[2])) return 0;
+            }
+            return 1;
+        }
+        case NODE_RETURN_STMT:
+            if (node->child_count != 1) return eval_fail(ev, "returns without a value");
+            if (!eval_expr(ev, node->children[0], &ev->result)) return 0;
+            if (ev->result.kind != VALUE_INT) return eval_fail(ev, "returns a value that is not a known int");
+            ev->returned = 1;
+            return 1;
+        default:
+            return eval_expr(ev, node, &v);
+    }
+}
+
+/* The program that prints the text and returns the code: one write per
+   OUTPUT_LITERAL_MAX characters of literal, so a single one for all but
+   long outputs */
+ASTNode *build_output_program(const char *name, OutputText *text, int code) {
+    ASTNode *function = new_node(NODE_FUNCTION_DEF);
+    function->name = strdup(name);
+    ASTNode *body = new_node(NODE_SEQUENCE);
+    OutputText chunk = { NULL, 0, 0, 0, OUTPUT_LITERAL_MAX };
+    for (int i = 0; i <= text->length; i++) {
+        if (i < text->length && output_append(&chunk, (unsigned char)text->bytes[i])) continue;
+        if (chunk.length > 0) {
+            ASTNode *call = new_node(NODE_FUNCTION_CALL);
+            call->name = strdup("write");
+            ASTNode *args = new_node(NODE_EXPR_LIST);
+            ASTNode *fd = new_node(NODE_INT);
+            fd->int_value = 1;
+            ASTNode *literal = new_node(NODE_STRING);
+            literal->string_value = output_literal(&chunk);
+            ASTNode *length = new_node(NODE_INT);
+            length->int_value = chunk.length;
+            append_child(args, fd);
+            append_child(args, literal);
+            append_child(args, length);
+            append_child(call, args);
+            append_child(body, call);
+        }
+        chunk.length = chunk.size = 0;
+        /* Start the next chunk with the byte that did not fit */
+        if (i < text->length) output_append(&chunk, (unsigned char)text->bytes[i]);
+    }
+    free(chunk.bytes);
+    ASTNode *ret = new_node(NODE_RETURN_STMT);
+    ASTNode *value = new_node(NODE_INT);
+    value->int_value = code;
+    append_child(ret, value);
+    append_child(body, ret);
+    append_child(function, body);
+    return function;
+}
+
+/* Run main; returns the program that replaces it, or NULL if evaluation
+   gave up. Reports the outcome on stderr. */
+ASTNode *evaluate_main(ASTNode *root) {
+    if (root->type != NODE_FUNCTION_DEF || !root->name || strcmp(root->name, "main") != 0) {
+        fprintf(stderr, "evaluate: no main function, optimizing normally\n");
+        return NULL;
+    }
+    Evaluator ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.vars = calloc(symtab.count ? symtab.count : 1, sizeof(Value));
+    ev.out.limit = EVALUATE_OUTPUT_MAX;
+    for (int i = 0; i < symtab.count; i++) ev.vars[i].kind = VALUE_UNKNOWN;
+    ASTNode *program = NULL;
+    int ok = 1;
+    for (int i = 0; i < root->child_count && ok && !ev.returned; i++) ok = eval_statement(&ev, root->children[i]);
+    if (ok) {
+        /* Falling off the end of main returns 0 */
+        int code = ev.returned ? ev.result.i : 0;
+        program = build_output_program(root->name, &ev.out, code);
+        fprintf(stderr, "evaluate: main finished in %ld steps, printing %d bytes and returning %d\n",
+                ev.steps, ev.out.length, code);
+    } else {
+        fprintf(stderr, "evaluate: gave up after %ld steps: main %s; optimizing normally\n", ev.steps, ev.failure);
+    }
+    free(ev.out.bytes);
+    free(ev.vars);
+    return program;
+}
+
+/* Everything besides the input that shapes the output, as a string that
+   is both hashed into the cache key and stored with the entry */
+void optimize_cache_settings(char *buf, size_t size) {
+    snprintf(buf, size, "ast_optimize %d %d %d %d %d %d %016llx", CACHE_FORMAT_VERSION,
+             cost_config.loop_budget, cost_config.function_budget, cost_config.output_budget,
+             evaluate_program ? evaluate_steps : -1, MAX_OPTIMIZE_ROUNDS,
+             profile_path ? (unsigned long long)profile.digest : 0ULL);
+}
+
+/* Cache key: the settings and the input function */
+uint64_t optimize_cache_key(const char *settings, ASTNode *root) {
+    uint64_t h = cache_hash_string(CACHE_HASH_SEED, settings);
+    uint64_t tree = merkle_hash(root);
+    return cache_hash_bytes(h, &tree, sizeof(tree));
+}
+
+/* Report the cache hit rate under --stats */
+void report_cache(Cache *cache, int hit) {
+    long hits, misses;
+    if (!show_stats || !cache->enabled) return;
+    fprintf(stderr, "stats: cache %s", hit ? "hit" : "miss");
+    if (cache_read_stats(cache, &hits, &misses) && hits + misses > 0)
+        fprintf(stderr, ", %ld/%ld lookups hit (%.1f%%)", hits, hits + misses,
+                100.0 * hits / (hits + misses));
+    fprintf(stderr, "\n");
+}
+
+/* Parse "--name=value" style integer options */
+int parse_int_option(const char *arg, const char *name, int *out) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') return 0;
+    *out = atoi(arg + len + 1);
+    return 1;
+}
+
+/* Entry point */
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--remarks") == 0)
+            cost_config.remarks = 1;
+        else if (strcmp(argv[i], "--stats") == 0)
+            show_stats = 1;
+        else if (strcmp(argv[i], "--evaluate") == 0)
+            evaluate_program = 1;
+        else if (strncmp(argv[i], "--profile=", 10) == 0)
+            profile_path = argv[i] + 10;
+        else if (!parse_int_option(argv[i], "--jobs", &jobs) &&
+                 !parse_int_option(argv[i], "--unroll-loop-budget", &cost_config.loop_budget) &&
+                 !parse_int_option(argv[i], "--unroll-function-budget", &cost_config.function_budget) &&
+                 !parse_int_option(argv[i], "--merge-output-budget", &cost_config.output_budget) &&
+                 !parse_int_option(argv[i], "--evaluate-steps", &evaluate_steps)) {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [--remarks] [--stats] [--profile=FILE] [--jobs=N] [--unroll-loop-budget=N] [--unroll-function-budget=N] [--merge-output-budget=N] [--evaluate] [--evaluate-steps=N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (cost_config.output_budget > OUTPUT_LITERAL_MAX) cost_config.output_budget = OUTPUT_LITERAL_MAX;
+    /* Remarks report decisions in sequential order */
+    if (jobs < 1 || cost_config.remarks) jobs = 1;
+    if (profile_path && !profile_load(&profile, profile_path)) {
+        fprintf(stderr, "Cannot read profile %s\n", profile_path);
+        return 1;
+    }
+
+    FILE *f = fopen("output.txt", "r");
+    if (!f) {
+        perror("Failed to open input file output.txt");
+        return 1;
+    }
+    
+    ASTNode *root = parse_ast(f);
+    fclose(f);
+    if (!root) {
+        fprintf(stderr, "Failed to parse AST\n");
+        return 1;
+    }
+
+    /* An identical function optimized under the same settings before is
+       copied from the cache without running any pass */
+    Cache cache;
+    CacheMaterial material = { NULL, 0 };
+    uint64_t key = 0;
+    cache_open(&cache);
+    if (cache.enabled) {
+        char settings[128];
+        optimize_cache_settings(settings, sizeof(settings));
+        key = optimize_cache_key(settings, root);
+        cache_material(&material, settings, "output.txt");
+    }
+    if (cache_fetch(&cache, key, &material, "newOutput.txt")) {
+        report_cache(&cache, 1);
+        cache_material_free(&material);
+        free_ast(root);
+        profile_free(&profile);
+        return 0;
+    }
+    
+    if (profile_path) {
+        apply_profile(root);
+        if (show_stats)
+            fprintf(stderr, "stats: %d site(s) found in profile %s\n", profiled_sites, profile_path);
+    }
+    resolve_symbols(root);
+    ASTNode *evaluated = evaluate_program ? evaluate_main(root) : NULL;
+    if (evaluated) {
+        free_ast(root);
+        root = evaluated;
+    } else {
+        optimize_to_fixed_point(root);
+    }
+    
+    Emitter out;
+    if (emit_open(&out, "newOutput.txt") != 0) {
+        perror("Failed to open output file newOutput.txt");
+        cache_material_free(&material);
+        free_ast(root);
+        return 1;
+    }
+    
+    print_ast_to_file(root, 0, &out);
+    if (emit_close(&out) != 0) {
+        perror("Failed to write newOutput.txt");
+        cache_material_free(&material);
+        free_ast(root);
+        return 1;
+    }
+    cache_store(&cache, key, &material, "newOutput.txt");
+    report_cache(&cache, 0);
+    cache_material_free(&material);
     free_ast(root);
+    free_symbols(&symtab);
+    profile_free(&profile);
     return 0;
 }
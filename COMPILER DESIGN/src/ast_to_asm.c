@@ -0,0 +1,1187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ops.h"
+#include "emit.h"
+
+/*
+    Compiles the optimized AST (newOutput.txt) straight to x86-64 assembly
+    in GAS syntax (optimizedCode.s) for the System V ABI, as an alternative
+    to going through optimizedCode.c and a C compiler:
+
+        gcc optimizedCode.s -o program
+
+    The function is lowered to a linear list of instructions over virtual
+    registers, with REPEAT replicas expanded and their induction variable
+    folded as a constant. Dead definitions are dropped, and a linear-scan
+    allocator (Poletto and Sarkar) maps each virtual register's live
+    interval to a callee-saved register or, under pressure, a stack slot.
+    The caller-saved registers are left for argument passing and as scratch
+    inside single instructions, so nothing needs saving around calls.
+*/
+
+#define MAX_LINE_LEN 256
+
+typedef enum {
+    NODE_FUNCTION_DEF,
+    NODE_SEQUENCE,
+    NODE_DECLARATION,
+    NODE_ASSIGNMENT,
+    NODE_INT,
+    NODE_BINARY_EXPR,
+    NODE_VAR,
+    NODE_IF_STMT,
+    NODE_FUNCTION_CALL,
+    NODE_EXPR_LIST,
+    NODE_FOR_STMT,
+    NODE_UNARY_EXPR,
+    NODE_RETURN_STMT,
+    NODE_STRING,
+    NODE_REPEAT,
+    NODE_UNKNOWN
+} NodeType;
+
+typedef struct ASTNode {
+    NodeType type;
+    char *name;
+    int int_value;
+    char *string_value;
+    Operator op;
+    struct ASTNode **children;
+    int child_count;
+    int child_capacity;
+} ASTNode;
+
+/* Forward declarations */
+ASTNode *parse_ast(FILE *f);
+void free_ast(ASTNode *node);
+void append_child(ASTNode *parent, ASTNode *child);
+
+/* Helper function to skip spaces */
+void skip_spaces(const char **str) {
+    while (**str == ' ' || **str == '\t') (*str)++;
+}
+
+/* Helper to count the leading spaces */
+int count_leading_spaces(const char *line) {
+    int count = 0;
+    while (*line == ' ') {
+        count++;
+        line++;
+    }
+    return count;
+}
+
+/* Convert string to NodeType */
+NodeType node_type_from_string(const char *str) {
+    if (strcmp(str, "FUNCTION_DEF") == 0) return NODE_FUNCTION_DEF;
+    if (strcmp(str, "SEQUENCE") == 0) return NODE_SEQUENCE;
+    if (strcmp(str, "DECLARATION") == 0) return NODE_DECLARATION;
+    if (strcmp(str, "ASSIGNMENT") == 0) return NODE_ASSIGNMENT;
+    if (strcmp(str, "INT") == 0) return NODE_INT;
+    if (strcmp(str, "BINARY_EXPR") == 0) return NODE_BINARY_EXPR;
+    if (strcmp(str, "VAR") == 0) return NODE_VAR;
+    if (strcmp(str, "IF_STMT") == 0) return NODE_IF_STMT;
+    if (strcmp(str, "FUNCTION_CALL") == 0) return NODE_FUNCTION_CALL;
+    if (strcmp(str, "EXPR_LIST") == 0) return NODE_EXPR_LIST;
+    if (strcmp(str, "FOR_STMT") == 0) return NODE_FOR_STMT;
+    if (strcmp(str, "UNARY_EXPR") == 0) return NODE_UNARY_EXPR;
+    if (strcmp(str, "RETURN_STMT") == 0) return NODE_RETURN_STMT;
+    if (strcmp(str, "STRING") == 0) return NODE_STRING;
+    if (strcmp(str, "REPEAT") == 0) return NODE_REPEAT;
+    return NODE_UNKNOWN;
+}
+
+/* Parse a line in the AST text and (optionally) extract an argument */
+NodeType parse_line(const char *line, char **arg) {
+    *arg = NULL;
+    const char *p = line;
+
+    char type_buf[64];
+    int i = 0;
+    while (*p && *p != ' ' && *p != '(' && *p != '\n' && i < 63) {
+        type_buf[i++] = *p++;
+    }
+    type_buf[i] = 0;
+    NodeType t = node_type_from_string(type_buf);
+    if (t == NODE_UNKNOWN) return NODE_UNKNOWN;
+
+    skip_spaces(&p);
+    if (*p == '(') {
+        p++;
+        const char *start = p;
+        while (*p && *p != ')') p++;
+        if (*p != ')') return NODE_UNKNOWN;
+        int len = (int)(p - start);
+        *arg = malloc(len + 1);
+        strncpy(*arg, start, len);
+        (*arg)[len] = 0;
+    }
+    return t;
+}
+
+/* Remove the quote characters the AST printers wrap around string literals */
+void strip_outer_quotes(char *s) {
+    int len = (int)strlen(s);
+    int start = 0, end = len - 1;
+    while (start < len && s[start] == '"') start++;
+    while (end >= start && s[end] == '"') end--;
+    int new_len = end - start + 1;
+    memmove(s, s + start, new_len);
+    s[new_len] = 0;
+}
+
+/* Recursively parse the AST from a file */
+ASTNode *parse_ast_recursive(FILE *f, int current_indent) {
+    char line[MAX_LINE_LEN];
+    long last_pos = ftell(f);
+    if (!fgets(line, MAX_LINE_LEN, f)) return NULL;
+
+    int indent = count_leading_spaces(line);
+    if (indent < current_indent) {
+        fseek(f, last_pos, SEEK_SET);
+        return NULL;
+    }
+    if (indent > current_indent) {
+        fprintf(stderr, "Unexpected indentation\n");
+        return NULL;
+    }
+
+    char *arg = NULL;
+    char *trim_line = line + indent;
+    NodeType t = parse_line(trim_line, &arg);
+    if (t == NODE_UNKNOWN) {
+        fprintf(stderr, "Unknown node type in line: %s\n", trim_line);
+        if (arg) free(arg);
+        return NULL;
+    }
+
+    ASTNode *node = calloc(1, sizeof(ASTNode));
+    node->type = t;
+
+    if (arg) {
+        switch (t) {
+            case NODE_FUNCTION_DEF:
+            case NODE_DECLARATION:
+            case NODE_ASSIGNMENT:
+            case NODE_VAR:
+            case NODE_FUNCTION_CALL:
+            case NODE_REPEAT:
+                node->name = arg;
+                break;
+            case NODE_BINARY_EXPR:
+            case NODE_UNARY_EXPR:
+                node->op = operator_from_spelling(arg);
+                free(arg);
+                break;
+            case NODE_INT:
+                node->int_value = atoi(arg);
+                free(arg);
+                break;
+            case NODE_STRING:
+                node->string_value = arg;
+                strip_outer_quotes(node->string_value);
+                break;
+            default:
+                free(arg);
+                break;
+        }
+    }
+
+    while (1) {
+        long pos_before = ftell(f);
+        ASTNode *child = parse_ast_recursive(f, current_indent + 2);
+        if (!child) {
+            fseek(f, pos_before, SEEK_SET);
+            break;
+        }
+        append_child(node, child);
+    }
+
+    return node;
+}
+
+/* Wrapper to parse AST from file */
+ASTNode *parse_ast(FILE *f) {
+    return parse_ast_recursive(f, 0);
+}
+
+/* Append a child, growing the child array as needed */
+void append_child(ASTNode *parent, ASTNode *child) {
+    if (parent->child_count == parent->child_capacity) {
+        int cap = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        ASTNode **grown = realloc(parent->children, cap * sizeof(ASTNode *));
+        if (!grown) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        parent->children = grown;
+        parent->child_capacity = cap;
+    }
+    parent->children[parent->child_count++] = child;
+}
+
+/* Free the AST recursively */
+void free_ast(ASTNode *node) {
+    if (!node) return;
+    if (node->name) free(node->name);
+    if (node->string_value) free(node->string_value);
+    for (int i = 0; i < node->child_count; i++) {
+        free_ast(node->children[i]);
+    }
+    free(node->children);
+    free(node);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Linear IR over virtual registers                                        */
+/* ---------------------------------------------------------------------- */
+
+typedef enum {
+    OPND_NONE,
+    OPND_VREG,  /* value: virtual register */
+    OPND_IMM    /* value: 32-bit constant */
+} OperandKind;
+
+typedef struct {
+    OperandKind kind;
+    int value;
+} Operand;
+
+typedef enum {
+    LIR_MOV,        /* dest = a */
+    LIR_STRING,     /* dest = address of string literal number imm */
+    LIR_SYMBOL,     /* dest = value of the global variable text (e.g. stdout) */
+    LIR_BINARY,     /* dest = a binop b */
+    LIR_CALL,       /* dest = text(args...), dest may be -1 */
+    LIR_JUMP,       /* goto label */
+    LIR_JUMP_LT,    /* if ((a < b) != negate) goto label */
+    LIR_JUMP_ZERO,  /* if ((a == 0) != negate) goto label */
+    LIR_LABEL,
+    LIR_RET         /* return a */
+} LirOp;
+
+typedef struct {
+    LirOp op;
+    int dest;                   /* virtual register, or -1 */
+    Operand a, b;
+    Operator binop;
+    int imm;
+    int label;
+    int negate;
+    const char *text;
+    int arg_start, arg_count;   /* slice of Program.args */
+    int dead;
+} Lir;
+
+typedef struct {
+    Lir *code;
+    int count, capacity;
+    Operand *args;
+    int arg_count, arg_capacity;
+    char *wide;                 /* per virtual register: holds a pointer */
+    int vreg_count, vreg_capacity;
+    const char **strings;
+    int string_count, string_capacity;
+    int label_count;
+} Program;
+
+/* Grow a dense array so that it can hold at least needed elements */
+void *grow_array(void *data, int *capacity, int needed, size_t elem_size) {
+    if (needed <= *capacity) return data;
+    int cap = *capacity ? *capacity : 8;
+    while (cap < needed) cap *= 2;
+    data = realloc(data, cap * elem_size);
+    if (!data) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    *capacity = cap;
+    return data;
+}
+
+Operand vreg_operand(int vreg) {
+    Operand o = { OPND_VREG, vreg };
+    return o;
+}
+
+Operand imm_operand(int value) {
+    Operand o = { OPND_IMM, value };
+    return o;
+}
+
+int new_vreg(Program *prog, int wide) {
+    prog->wide = grow_array(prog->wide, &prog->vreg_capacity, prog->vreg_count + 1, sizeof(char));
+    prog->wide[prog->vreg_count] = (char)wide;
+    return prog->vreg_count++;
+}
+
+int new_label(Program *prog) {
+    return prog->label_count++;
+}
+
+Lir *emit_lir(Program *prog, LirOp op) {
+    prog->code = grow_array(prog->code, &prog->capacity, prog->count + 1, sizeof(Lir));
+    Lir *in = &prog->code[prog->count++];
+    memset(in, 0, sizeof(Lir));
+    in->op = op;
+    in->dest = -1;
+    in->label = -1;
+    return in;
+}
+
+void emit_label(Program *prog, int label) {
+    emit_lir(prog, LIR_LABEL)->label = label;
+}
+
+void emit_jump(Program *prog, int label) {
+    emit_lir(prog, LIR_JUMP)->label = label;
+}
+
+void emit_mov(Program *prog, int dest, Operand a) {
+    Lir *in = emit_lir(prog, LIR_MOV);
+    in->dest = dest;
+    in->a = a;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Lowering AST -> linear IR                                               */
+/* ---------------------------------------------------------------------- */
+
+/* Lexical scope: source names bound to a virtual register, or to a
+   constant for the induction variable of a REPEAT replica */
+typedef struct {
+    const char *name;
+    Operand value;
+} Binding;
+
+typedef struct {
+    Binding *bindings;
+    int count, capacity;
+} Scope;
+
+void scope_bind(Scope *s, const char *name, Operand value) {
+    s->bindings = grow_array(s->bindings, &s->capacity, s->count + 1, sizeof(Binding));
+    s->bindings[s->count].name = name;
+    s->bindings[s->count].value = value;
+    s->count++;
+}
+
+Binding *scope_lookup(Scope *s, const char *name) {
+    for (int i = s->count - 1; i >= 0; i--) {
+        if (strcmp(s->bindings[i].name, name) == 0) return &s->bindings[i];
+    }
+    return NULL;
+}
+
+Operand lower_expr(Program *prog, Scope *scope, ASTNode *node, int want_result);
+void lower_stmt(Program *prog, Scope *scope, ASTNode *node);
+
+/* Virtual register of a variable that is about to be written: the VAR
+   of a ++/--, or the target of an ASSIGNMENT */
+int lvalue_vreg(Scope *scope, ASTNode *var) {
+    Binding *b = var->type == NODE_VAR || var->type == NODE_ASSIGNMENT ? scope_lookup(scope, var->name) : NULL;
+    if (!b || b->value.kind != OPND_VREG) {
+        fprintf(stderr, "Cannot assign to %s\n", var->name ? var->name : "expression");
+        exit(1);
+    }
+    return b->value.value;
+}
+
+Operand lower_binary(Program *prog, Operator op, Operand a, Operand b) {
+    int folded;
+    const OperatorInfo *info = operator_info(op);
+    if (a.kind == OPND_IMM && b.kind == OPND_IMM && info->fold && info->fold(a.value, b.value, &folded))
+        return imm_operand(folded);
+    Lir *in = emit_lir(prog, LIR_BINARY);
+    in->binop = op;
+    in->a = a;
+    in->b = b;
+    in->dest = new_vreg(prog, 0);
+    return vreg_operand(in->dest);
+}
+
+Operand lower_expr(Program *prog, Scope *scope, ASTNode *node, int want_result) {
+    Lir *in;
+    switch (node->type) {
+        case NODE_INT:
+            return imm_operand(node->int_value);
+        case NODE_STRING:
+            prog->strings = grow_array(prog->strings, &prog->string_capacity, prog->string_count + 1, sizeof(char *));
+            prog->strings[prog->string_count] = node->string_value;
+            in = emit_lir(prog, LIR_STRING);
+            in->imm = prog->string_count++;
+            in->dest = new_vreg(prog, 1);
+            return vreg_operand(in->dest);
+        case NODE_VAR: {
+            Binding *b = scope_lookup(scope, node->name);
+            if (b) return b->value;
+            in = emit_lir(prog, LIR_SYMBOL);
+            in->text = node->name;
+            in->dest = new_vreg(prog, 1);
+            return vreg_operand(in->dest);
+        }
+        case NODE_BINARY_EXPR: {
+            if (operator_info(node->op)->arity != 2 || node->child_count != 2) {
+                fprintf(stderr, "Unsupported binary operator\n");
+                exit(1);
+            }
+            Operand a = lower_expr(prog, scope, node->children[0], 1);
+            Operand b = lower_expr(prog, scope, node->children[1], 1);
+            return lower_binary(prog, node->op, a, b);
+        }
+        case NODE_UNARY_EXPR: {
+            /* Postfix: yields the old value, then writes old +/- 1 */
+            int var = lvalue_vreg(scope, node->children[0]);
+            Operand old = vreg_operand(var);
+            if (want_result) {
+                old = vreg_operand(new_vreg(prog, 0));
+                emit_mov(prog, old.value, vreg_operand(var));
+            }
+            in = emit_lir(prog, LIR_BINARY);
+            in->binop = node->op == OP_DEC ? OP_SUB : OP_ADD;
+            in->a = vreg_operand(var);
+            in->b = imm_operand(1);
+            in->dest = var;
+            return old;
+        }
+        case NODE_FUNCTION_CALL: {
+            ASTNode *args = node->child_count == 1 ? node->children[0] : NULL;
+            int argc = args ? args->child_count : 0;
+            Operand *values = malloc((argc ? argc : 1) * sizeof(Operand));
+            for (int i = 0; i < argc; i++) {
+                values[i] = lower_expr(prog, scope, args->children[i], 1);
+            }
+            prog->args = grow_array(prog->args, &prog->arg_capacity, prog->arg_count + argc, sizeof(Operand));
+            if (argc > 0)
+                memcpy(&prog->args[prog->arg_count], values, argc * sizeof(Operand));
+            free(values);
+            in = emit_lir(prog, LIR_CALL);
+            in->text = node->name;
+            in->arg_start = prog->arg_count;
+            in->arg_count = argc;
+            prog->arg_count += argc;
+            if (!want_result) return imm_operand(0);
+            in->dest = new_vreg(prog, 0);
+            return vreg_operand(in->dest);
+        }
+        default:
+            fprintf(stderr, "Unsupported expression node %d\n", node->type);
+            exit(1);
+    }
+}
+
+/* Jump to label when the condition's truth equals jump_if; constant
+   conditions jump unconditionally or not at all */
+void lower_cond(Program *prog, Scope *scope, ASTNode *node, int jump_if, int label) {
+    if (node->type == NODE_BINARY_EXPR && node->op == OP_LT && node->child_count == 2) {
+        Operand a = lower_expr(prog, scope, node->children[0], 1);
+        Operand b = lower_expr(prog, scope, node->children[1], 1);
+        if (a.kind == OPND_IMM && b.kind == OPND_IMM) {
+            if ((a.value < b.value) == jump_if) emit_jump(prog, label);
+            return;
+        }
+        Lir *in = emit_lir(prog, LIR_JUMP_LT);
+        in->a = a;
+        in->b = b;
+        in->negate = !jump_if;
+        in->label = label;
+        return;
+    }
+    Operand value = lower_expr(prog, scope, node, 1);
+    if (value.kind == OPND_IMM) {
+        if ((value.value != 0) == jump_if) emit_jump(prog, label);
+        return;
+    }
+    Lir *in = emit_lir(prog, LIR_JUMP_ZERO);
+    in->a = value;
+    in->negate = jump_if;
+    in->label = label;
+}
+
+void lower_stmt(Program *prog, Scope *scope, ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+        case NODE_SEQUENCE: {
+            int mark = scope->count;
+            for (int i = 0; i < node->child_count; i++) {
+                lower_stmt(prog, scope, node->children[i]);
+            }
+            if (node->type == NODE_FUNCTION_DEF) scope->count = mark;
+            break;
+        }
+        case NODE_DECLARATION: {
+            int first_new = prog->vreg_count;
+            int var;
+            if (node->child_count == 1) {
+                Operand value = lower_expr(prog, scope, node->children[0], 1);
+                if (value.kind == OPND_VREG && value.value >= first_new) {
+                    /* A fresh temporary has no other readers: it becomes the variable */
+                    var = value.value;
+                } else {
+                    var = new_vreg(prog, value.kind == OPND_VREG && prog->wide[value.value]);
+                    emit_mov(prog, var, value);
+                }
+            } else {
+                var = new_vreg(prog, 0);
+            }
+            scope_bind(scope, node->name, vreg_operand(var));
+            break;
+        }
+        case NODE_ASSIGNMENT: {
+            Operand value = lower_expr(prog, scope, node->children[0], 1);
+            emit_mov(prog, lvalue_vreg(scope, node), value);
+            break;
+        }
+        case NODE_IF_STMT: {
+            int join = new_label(prog);
+            lower_cond(prog, scope, node->children[0], 0, join);
+            int mark = scope->count;
+            lower_stmt(prog, scope, node->children[1]);
+            scope->count = mark;
+            emit_label(prog, join);
+            break;
+        }
+        case NODE_FOR_STMT: {
+            /* children: init, condition, update, body. The test sits at
+               the bottom, so an iteration takes a single branch. */
+            int mark = scope->count;
+            lower_stmt(prog, scope, node->children[0]);
+            int body = new_label(prog);
+            int test = new_label(prog);
+            emit_jump(prog, test);
+            emit_label(prog, body);
+            int body_mark = scope->count;
+            lower_stmt(prog, scope, node->children[3]);
+            scope->count = body_mark;
+            lower_expr(prog, scope, node->children[2], 0);
+            emit_label(prog, test);
+            lower_cond(prog, scope, node->children[1], 1, body);
+            scope->count = mark;
+            break;
+        }
+        case NODE_REPEAT: {
+            /* children: first value, count, body. The replicas are laid
+               out in straight line with the induction variable constant. */
+            int first = node->children[0]->int_value;
+            int count = node->children[1]->int_value;
+            for (int k = 0; k < count; k++) {
+                int mark = scope->count;
+                scope_bind(scope, node->name, imm_operand(first + k));
+                lower_stmt(prog, scope, node->children[2]);
+                scope->count = mark;
+            }
+            break;
+        }
+        case NODE_RETURN_STMT: {
+            Operand value = node->child_count == 1 ? lower_expr(prog, scope, node->children[0], 1) : imm_operand(0);
+            emit_lir(prog, LIR_RET)->a = value;
+            break;
+        }
+        default:
+            lower_expr(prog, scope, node, 0);
+            break;
+    }
+}
+
+/* Operands read by an instruction, call arguments included */
+int lir_operands(Program *prog, Lir *in, Operand **ops, Operand *fixed) {
+    if (in->op == LIR_CALL) {
+        *ops = &prog->args[in->arg_start];
+        return in->arg_count;
+    }
+    fixed[0] = in->a;
+    fixed[1] = in->b;
+    *ops = fixed;
+    return 2;
+}
+
+/* Drop definitions nobody reads, until none are left. Calls stay for
+   their side effects. */
+void remove_dead_code(Program *prog) {
+    int *uses = malloc((prog->vreg_count ? prog->vreg_count : 1) * sizeof(int));
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        memset(uses, 0, (prog->vreg_count ? prog->vreg_count : 1) * sizeof(int));
+        for (int i = 0; i < prog->count; i++) {
+            Lir *in = &prog->code[i];
+            Operand *ops, fixed[2];
+            if (in->dead) continue;
+            int n = lir_operands(prog, in, &ops, fixed);
+            for (int k = 0; k < n; k++) {
+                if (ops[k].kind == OPND_VREG) uses[ops[k].value]++;
+            }
+        }
+        for (int i = 0; i < prog->count; i++) {
+            Lir *in = &prog->code[i];
+            if (in->dead || in->dest < 0 || uses[in->dest] > 0) continue;
+            if (in->op == LIR_CALL) {
+                in->dest = -1;
+            } else {
+                in->dead = 1;
+                changed = 1;
+            }
+        }
+    }
+    free(uses);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Linear-scan register allocation                                         */
+/* ---------------------------------------------------------------------- */
+
+typedef enum {
+    RAX, RBX, RCX, RDX, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15, REG_COUNT
+} Reg;
+
+static const char *reg64[REG_COUNT] = {
+    "%rax", "%rbx", "%rcx", "%rdx", "%rsi", "%rdi", "%r8", "%r9",
+    "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+};
+static const char *reg32[REG_COUNT] = {
+    "%eax", "%ebx", "%ecx", "%edx", "%esi", "%edi", "%r8d", "%r9d",
+    "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d"
+};
+
+/* Callee-saved, so values stay put across calls */
+static const Reg allocatable[] = { RBX, R12, R13, R14, R15 };
+#define ALLOCATABLE_COUNT ((int)(sizeof(allocatable) / sizeof(allocatable[0])))
+
+static const Reg arg_regs[] = { RDI, RSI, RDX, RCX, R8, R9 };
+#define ARG_REG_COUNT 6
+
+/* Live interval of a virtual register over instruction positions, and
+   where it ended up: a register, or a stack slot when reg < 0 */
+typedef struct {
+    int vreg;
+    int start, end;
+    int reg;
+    int slot;
+} Interval;
+
+typedef struct {
+    Interval *intervals;        /* indexed by virtual register */
+    int slot_count;
+    int used[REG_COUNT];        /* callee-saved registers to preserve */
+    int spilled;
+} Allocation;
+
+void extend_interval(Interval *iv, int pos) {
+    if (iv->start < 0 || pos < iv->start) iv->start = pos;
+    if (pos > iv->end) iv->end = pos;
+}
+
+/* Intervals from first to last mention, stretched over every loop a
+   value is live around: a value defined before a loop and read inside it
+   must survive until the back edge. */
+void compute_intervals(Program *prog, Allocation *alloc) {
+    int *label_pos = malloc((prog->label_count ? prog->label_count : 1) * sizeof(int));
+    alloc->intervals = malloc((prog->vreg_count ? prog->vreg_count : 1) * sizeof(Interval));
+    for (int v = 0; v < prog->vreg_count; v++) {
+        alloc->intervals[v].vreg = v;
+        alloc->intervals[v].start = alloc->intervals[v].end = -1;
+        alloc->intervals[v].reg = alloc->intervals[v].slot = -1;
+    }
+    for (int i = 0; i < prog->count; i++) {
+        Lir *in = &prog->code[i];
+        Operand *ops, fixed[2];
+        if (in->op == LIR_LABEL) label_pos[in->label] = i;
+        if (in->dead) continue;
+        int n = lir_operands(prog, in, &ops, fixed);
+        for (int k = 0; k < n; k++) {
+            if (ops[k].kind == OPND_VREG) extend_interval(&alloc->intervals[ops[k].value], i);
+        }
+        if (in->dest >= 0) extend_interval(&alloc->intervals[in->dest], i);
+    }
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < prog->count; i++) {
+            Lir *in = &prog->code[i];
+            if (in->dead || in->label < 0 || in->op == LIR_LABEL || label_pos[in->label] > i) continue;
+            int head = label_pos[in->label];
+            for (int v = 0; v < prog->vreg_count; v++) {
+                Interval *iv = &alloc->intervals[v];
+                if (iv->start >= 0 && iv->start < head && iv->end >= head && iv->end < i) {
+                    iv->end = i;
+                    changed = 1;
+                }
+            }
+        }
+    }
+    free(label_pos);
+}
+
+int compare_interval_start(const void *a, const void *b) {
+    const Interval *x = *(Interval *const *)a, *y = *(Interval *const *)b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    return x->vreg - y->vreg;
+}
+
+void assign_slot(Allocation *alloc, Interval *iv) {
+    iv->reg = -1;
+    iv->slot = alloc->slot_count++;
+    alloc->spilled++;
+}
+
+void allocate_registers(Program *prog, Allocation *alloc) {
+    memset(alloc, 0, sizeof(*alloc));
+    compute_intervals(prog, alloc);
+
+    Interval **order = malloc((prog->vreg_count ? prog->vreg_count : 1) * sizeof(Interval *));
+    int count = 0;
+    for (int v = 0; v < prog->vreg_count; v++) {
+        if (alloc->intervals[v].start >= 0) order[count++] = &alloc->intervals[v];
+    }
+    qsort(order, count, sizeof(Interval *), compare_interval_start);
+
+    /* active: intervals holding a register, sorted by increasing end */
+    Interval *active[ALLOCATABLE_COUNT];
+    int active_count = 0;
+    int free_regs[ALLOCATABLE_COUNT];
+    int free_count = 0;
+    for (int r = ALLOCATABLE_COUNT - 1; r >= 0; r--) free_regs[free_count++] = allocatable[r];
+
+    for (int i = 0; i < count; i++) {
+        Interval *iv = order[i];
+        /* An interval ending where this one starts can hand over its
+           register: every instruction reads its operands before it
+           writes its result */
+        int expired = 0;
+        while (expired < active_count && active[expired]->end <= iv->start) {
+            free_regs[free_count++] = active[expired]->reg;
+            expired++;
+        }
+        memmove(active, active + expired, (active_count - expired) * sizeof(Interval *));
+        active_count -= expired;
+
+        if (free_count == 0) {
+            /* Spill whichever of the candidates lives longest */
+            Interval *last = active[active_count - 1];
+            if (last->end > iv->end) {
+                iv->reg = last->reg;
+                assign_slot(alloc, last);
+                active_count--;
+            } else {
+                assign_slot(alloc, iv);
+                continue;
+            }
+        } else {
+            iv->reg = free_regs[--free_count];
+        }
+        alloc->used[iv->reg] = 1;
+        int pos = active_count;
+        while (pos > 0 && active[pos - 1]->end > iv->end) pos--;
+        memmove(active + pos + 1, active + pos, (active_count - pos) * sizeof(Interval *));
+        active[pos] = iv;
+        active_count++;
+    }
+    free(order);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Assembly output                                                         */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    Program *prog;
+    Allocation *alloc;
+    Emitter *out;
+    int saved_count;            /* callee-saved registers pushed */
+} Codegen;
+
+/* Where an operand lives: a register (reg >= 0), a stack slot, or an
+   immediate */
+typedef struct {
+    int is_imm;
+    int imm;
+    int reg;
+    int offset;                 /* from %rbp, for stack slots */
+} Location;
+
+Location locate(Codegen *cg, Operand o) {
+    Location loc = { 0, 0, -1, 0 };
+    if (o.kind == OPND_IMM) {
+        loc.is_imm = 1;
+        loc.imm = o.value;
+        return loc;
+    }
+    Interval *iv = &cg->alloc->intervals[o.value];
+    if (iv->reg >= 0) {
+        loc.reg = iv->reg;
+    } else {
+        loc.offset = -8 * (cg->saved_count + iv->slot + 1);
+    }
+    return loc;
+}
+
+Location reg_location(Reg reg) {
+    Location loc = { 0, 0, reg, 0 };
+    return loc;
+}
+
+int same_location(Location a, Location b) {
+    if (a.is_imm || b.is_imm) return 0;
+    return a.reg == b.reg && (a.reg >= 0 || a.offset == b.offset);
+}
+
+int in_memory(Location loc) {
+    return !loc.is_imm && loc.reg < 0;
+}
+
+void emit_location(Emitter *out, Location loc, int wide) {
+    if (loc.is_imm) {
+        emit_char(out, '$');
+        emit_int(out, loc.imm);
+    } else if (loc.reg >= 0) {
+        emit_str(out, wide ? reg64[loc.reg] : reg32[loc.reg]);
+    } else {
+        emit_int(out, loc.offset);
+        emit_str(out, "(%rbp)");
+    }
+}
+
+/* One two-operand instruction, e.g. "    movl %ebx, -8(%rbp)" */
+void emit_insn(Emitter *out, const char *mnemonic, Location src, Location dst, int wide) {
+    emit_str(out, "    ");
+    emit_str(out, mnemonic);
+    emit_char(out, ' ');
+    emit_location(out, src, wide);
+    emit_str(out, ", ");
+    emit_location(out, dst, wide);
+    emit_char(out, '\n');
+}
+
+void emit_line(Emitter *out, const char *text) {
+    emit_str(out, "    ");
+    emit_str(out, text);
+    emit_char(out, '\n');
+}
+
+/* Copy between any two locations, through %r10 when both are in memory */
+void emit_move(Emitter *out, Location src, Location dst, int wide) {
+    if (same_location(src, dst)) return;
+    const char *mov = wide ? "movq" : "movl";
+    if (in_memory(src) && in_memory(dst)) {
+        emit_insn(out, mov, src, reg_location(R10), wide);
+        src = reg_location(R10);
+    }
+    emit_insn(out, mov, src, dst, wide);
+}
+
+/* The operand in a register: its own, or scratch loaded from elsewhere */
+Location in_register(Emitter *out, Location loc, Reg scratch) {
+    if (loc.reg >= 0) return loc;
+    emit_insn(out, "movl", loc, reg_location(scratch), 0);
+    return reg_location(scratch);
+}
+
+void emit_local_label(Emitter *out, int label) {
+    emit_str(out, ".L");
+    emit_int(out, label);
+}
+
+void emit_branch(Emitter *out, const char *mnemonic, int label) {
+    emit_str(out, "    ");
+    emit_str(out, mnemonic);
+    emit_char(out, ' ');
+    emit_local_label(out, label);
+    emit_char(out, '\n');
+}
+
+void emit_binary(Codegen *cg, Lir *in) {
+    Emitter *out = cg->out;
+    Location a = locate(cg, in->a), b = locate(cg, in->b), dst = locate(cg, vreg_operand(in->dest));
+    switch (in->binop) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL: {
+            const char *mnemonic = in->binop == OP_ADD ? "addl" : in->binop == OP_SUB ? "subl" : "imull";
+            /* Compute in the destination when that does not clobber b;
+               imul needs a register destination */
+            Location work = dst;
+            if (same_location(dst, b) || (in->binop == OP_MUL && dst.reg < 0) ||
+                (in_memory(dst) && in_memory(b)))
+                work = reg_location(R10);
+            emit_move(out, a, work, 0);
+            emit_insn(out, mnemonic, b, work, 0);
+            emit_move(out, work, dst, 0);
+            break;
+        }
+        case OP_DIV:
+            emit_move(out, a, reg_location(RAX), 0);
+            emit_line(out, "cltd");
+            if (b.is_imm) b = in_register(out, b, R10);
+            emit_str(out, "    idivl ");
+            emit_location(out, b, 0);
+            emit_char(out, '\n');
+            emit_move(out, reg_location(RAX), dst, 0);
+            break;
+        case OP_LT:
+            a = in_register(out, a, R10);
+            emit_insn(out, "cmpl", b, a, 0);
+            emit_line(out, "setl %al");
+            emit_line(out, "movzbl %al, %eax");
+            emit_move(out, reg_location(RAX), dst, 0);
+            break;
+        default:
+            fprintf(stderr, "Unsupported binary operator %s\n", operator_info(in->binop)->spelling);
+            exit(1);
+    }
+}
+
+void emit_call(Codegen *cg, Lir *in) {
+    Emitter *out = cg->out;
+    Operand *args = &cg->prog->args[in->arg_start];
+    int stack_args = in->arg_count > ARG_REG_COUNT ? in->arg_count - ARG_REG_COUNT : 0;
+    /* Keep %rsp 16-byte aligned at the call */
+    int pad = stack_args % 2 ? 8 : 0;
+    if (pad) emit_line(out, "subq $8, %rsp");
+    for (int i = in->arg_count - 1; i >= ARG_REG_COUNT; i--) {
+        emit_str(out, "    pushq ");
+        emit_location(out, locate(cg, args[i]), 1);
+        emit_char(out, '\n');
+    }
+    for (int i = 0; i < in->arg_count && i < ARG_REG_COUNT; i++) {
+        int wide = args[i].kind == OPND_VREG && cg->prog->wide[args[i].value];
+        emit_move(out, locate(cg, args[i]), reg_location(arg_regs[i]), wide);
+    }
+    /* Variadic callees read the number of vector registers used from %al */
+    emit_line(out, "xorl %eax, %eax");
+    emit_str(out, "    call ");
+    emit_str(out, in->text);
+    emit_str(out, "@PLT\n");
+    if (stack_args + pad / 8 > 0) {
+        emit_str(out, "    addq $");
+        emit_int(out, 8 * stack_args + pad);
+        emit_str(out, ", %rsp\n");
+    }
+    if (in->dest >= 0) emit_move(out, reg_location(RAX), locate(cg, vreg_operand(in->dest)), 0);
+}
+
+/* A string literal for .string: C escapes are decoded and everything that
+   is not plain printable ASCII is written back as an octal escape */
+void emit_string_literal(Emitter *out, const char *s) {
+    emit_str(out, "    .string \"");
+    while (*s) {
+        int c = (unsigned char)*s++;
+        if (c == '\\' && *s) {
+            c = (unsigned char)*s++;
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'a': c = '\a'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                case 'x': {
+                    int value = 0;
+                    while ((*s >= '0' && *s <= '9') || (*s >= 'a' && *s <= 'f') || (*s >= 'A' && *s <= 'F')) {
+                        int digit = *s <= '9' ? *s - '0' : (*s | 0x20) - 'a' + 10;
+                        value = value * 16 + digit;
+                        s++;
+                    }
+                    c = value & 0xff;
+                    break;
+                }
+                default:
+                    if (c >= '0' && c <= '7') {
+                        int value = c - '0';
+                        for (int k = 0; k < 2 && *s >= '0' && *s <= '7'; k++) value = value * 8 + (*s++ - '0');
+                        c = value & 0xff;
+                    }
+                    break;
+            }
+        }
+        if (c >= ' ' && c < 127 && c != '"' && c != '\\') {
+            emit_char(out, (char)c);
+        } else {
+            char octal[5] = { '\\', (char)('0' + (c >> 6)), (char)('0' + ((c >> 3) & 7)), (char)('0' + (c & 7)), 0 };
+            emit_str(out, octal);
+        }
+    }
+    emit_str(out, "\"\n");
+}
+
+void emit_function(Codegen *cg, const char *name) {
+    Program *prog = cg->prog;
+    Emitter *out = cg->out;
+
+    if (prog->string_count > 0) {
+        emit_str(out, "    .section .rodata\n");
+        for (int i = 0; i < prog->string_count; i++) {
+            emit_str(out, ".LC");
+            emit_int(out, i);
+            emit_str(out, ":\n");
+            emit_string_literal(out, prog->strings[i]);
+        }
+    }
+    emit_str(out, "    .text\n    .globl ");
+    emit_str(out, name);
+    emit_str(out, "\n    .type ");
+    emit_str(out, name);
+    emit_str(out, ", @function\n");
+    emit_str(out, name);
+    emit_str(out, ":\n");
+    emit_line(out, "pushq %rbp");
+    emit_line(out, "movq %rsp, %rbp");
+    for (int r = 0; r < REG_COUNT; r++) {
+        if (!cg->alloc->used[r]) continue;
+        emit_str(out, "    pushq ");
+        emit_str(out, reg64[r]);
+        emit_char(out, '\n');
+        cg->saved_count++;
+    }
+    /* Spill slots below the saved registers, keeping %rsp 16-byte aligned */
+    int frame = 8 * cg->alloc->slot_count;
+    if ((8 * cg->saved_count + frame) % 16) frame += 8;
+    if (frame > 0) {
+        emit_str(out, "    subq $");
+        emit_int(out, frame);
+        emit_str(out, ", %rsp\n");
+    }
+
+    for (int i = 0; i < prog->count; i++) {
+        Lir *in = &prog->code[i];
+        if (in->dead) continue;
+        switch (in->op) {
+            case LIR_MOV:
+                emit_move(out, locate(cg, in->a), locate(cg, vreg_operand(in->dest)), prog->wide[in->dest]);
+                break;
+            case LIR_STRING: {
+                Location dst = locate(cg, vreg_operand(in->dest));
+                Location work = dst.reg >= 0 ? dst : reg_location(R10);
+                emit_str(out, "    leaq .LC");
+                emit_int(out, in->imm);
+                emit_str(out, "(%rip), ");
+                emit_str(out, reg64[work.reg]);
+                emit_char(out, '\n');
+                emit_move(out, work, dst, 1);
+                break;
+            }
+            case LIR_SYMBOL: {
+                /* Through the GOT, so the result links as a PIE */
+                Location dst = locate(cg, vreg_operand(in->dest));
+                Location work = dst.reg >= 0 ? dst : reg_location(R10);
+                emit_str(out, "    movq ");
+                emit_str(out, in->text);
+                emit_str(out, "@GOTPCREL(%rip), ");
+                emit_str(out, reg64[work.reg]);
+                emit_str(out, "\n    movq (");
+                emit_str(out, reg64[work.reg]);
+                emit_str(out, "), ");
+                emit_str(out, reg64[work.reg]);
+                emit_char(out, '\n');
+                emit_move(out, work, dst, 1);
+                break;
+            }
+            case LIR_BINARY:
+                emit_binary(cg, in);
+                break;
+            case LIR_CALL:
+                emit_call(cg, in);
+                break;
+            case LIR_JUMP:
+                emit_branch(out, "jmp", in->label);
+                break;
+            case LIR_JUMP_LT: {
+                Location a = locate(cg, in->a), b = locate(cg, in->b);
+                if (a.is_imm || (in_memory(a) && in_memory(b))) a = in_register(out, a, R10);
+                emit_insn(out, "cmpl", b, a, 0);
+                emit_branch(out, in->negate ? "jge" : "jl", in->label);
+                break;
+            }
+            case LIR_JUMP_ZERO: {
+                Location imm0 = { 1, 0, -1, 0 };
+                emit_insn(out, "cmpl", imm0, locate(cg, in->a), 0);
+                emit_branch(out, in->negate ? "jne" : "je", in->label);
+                break;
+            }
+            case LIR_LABEL:
+                emit_local_label(out, in->label);
+                emit_str(out, ":\n");
+                break;
+            case LIR_RET:
+                emit_move(out, locate(cg, in->a), reg_location(RAX), 0);
+                emit_line(out, "jmp .Lreturn");
+                break;
+        }
+    }
+
+    /* Falling off the end returns 0 */
+    emit_line(out, "xorl %eax, %eax");
+    emit_str(out, ".Lreturn:\n");
+    if (cg->saved_count > 0 || frame > 0) {
+        emit_str(out, "    leaq ");
+        emit_int(out, -8 * cg->saved_count);
+        emit_str(out, "(%rbp), %rsp\n");
+    }
+    for (int r = REG_COUNT - 1; r >= 0; r--) {
+        if (!cg->alloc->used[r]) continue;
+        emit_str(out, "    popq ");
+        emit_str(out, reg64[r]);
+        emit_char(out, '\n');
+    }
+    emit_line(out, "popq %rbp");
+    emit_line(out, "ret");
+    emit_str(out, "    .size ");
+    emit_str(out, name);
+    emit_str(out, ", .-");
+    emit_str(out, name);
+    emit_str(out, "\n    .section .note.GNU-stack,\"\",@progbits\n");
+}
+
+void free_program(Program *prog) {
+    free(prog->code);
+    free(prog->args);
+    free(prog->wide);
+    free(prog->strings);
+}
+
+int main() {
+    FILE *in = fopen("newOutput.txt", "r");
+    if (!in) {
+        perror("Failed to open input file newOutput.txt");
+        return 1;
+    }
+    ASTNode *root = parse_ast(in);
+    fclose(in);
+    if (!root || root->type != NODE_FUNCTION_DEF) {
+        fprintf(stderr, "Failed to parse AST\n");
+        free_ast(root);
+        return 1;
+    }
+
+    Program prog;
+    memset(&prog, 0, sizeof(prog));
+    Scope scope;
+    memset(&scope, 0, sizeof(scope));
+    lower_stmt(&prog, &scope, root);
+    remove_dead_code(&prog);
+
+    Allocation alloc;
+    allocate_registers(&prog, &alloc);
+
+    Emitter out;
+    if (emit_open(&out, "optimizedCode.s") != 0) {
+        perror("Failed to open output file optimizedCode.s");
+        return 1;
+    }
+    Codegen cg = { &prog, &alloc, &out, 0 };
+    emit_function(&cg, root->name);
+    if (emit_close(&out) != 0) {
+        perror("Failed to write optimizedCode.s");
+        return 1;
+    }
+
+    printf("x86-64 assembly saved to optimizedCode.s (%d virtual registers, %d spilled)\n",
+           prog.vreg_count, alloc.spilled);
+    free(alloc.intervals);
+    free(scope.bindings);
+    free_program(&prog);
+    free_ast(root);
+    return 0;
+}
@@ -1,8 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "ops.h"
+#include "cache.h"
+#include "emit.h"
+#include "profile.h"
 
-#define MAX_CHILDREN 10
 #define MAX_LINE_LEN 256
 
 typedef enum
@@ -10,6 +13,7 @@ typedef enum
     NODE_FUNCTION_DEF,
     NODE_SEQUENCE,
     NODE_DECLARATION,
+    NODE_ASSIGNMENT,
     NODE_INT,
     NODE_BINARY_EXPR,
     NODE_VAR,
@@ -20,6 +24,7 @@ typedef enum
     NODE_UNARY_EXPR,
     NODE_RETURN_STMT,
     NODE_STRING,
+    NODE_REPEAT,
     NODE_UNKNOWN
 } NodeType;
 
@@ -28,16 +33,45 @@ typedef struct ASTNode
     NodeType type;
     char *name;         // e.g. function name, variable name, function call name
     int int_value;      // for INT nodes
-    char op[4];         // operator for binary/unary expr
+    Operator op;        // operator for binary/unary expr
     char *string_value; // for STRING nodes
-    struct ASTNode *children[MAX_CHILDREN];
+    struct ASTNode **children; // growable array, unrolled loops can be wide
     int child_count;
+    int child_capacity;
+    int expect;         // IF_STMT branch hint from the profile: 1 likely, -1 unlikely
+    int site;           // with --instrument, 1 + index of the node's profile counters
 } ASTNode;
 
+// Induction variables of the REPEAT nodes being expanded, innermost last.
+// A declaration of the same name inside a replica pushes an unbound entry
+// that hides the outer binding until its block ends.
+#define MAX_BINDINGS 256
+
+typedef struct
+{
+    const char *name;
+    int bound;
+    int value;
+} Binding;
+
+static Binding bindings[MAX_BINDINGS];
+static int binding_count = 0;
+
+// With --instrument, every FUNCTION_DEF, IF_STMT and FOR_STMT is a profile
+// site counted under the Merkle hash of its subtree and its order among
+// identical subtrees (see profile.h)
+static int instrument = 0;
+static const char *profile_path = PROFILE_DEFAULT_PATH;
+static uint64_t *site_keys;
+static SiteCounter site_counter;
+static int site_count = 0;
+static int site_capacity = 0;
+
 // Forward declarations
 ASTNode *parse_ast_recursive(FILE *f, int indent);
 void free_ast(ASTNode *node);
-void generate_c_code(ASTNode *node, int indent, FILE *out);
+void generate_c_code(ASTNode *node, int indent, Emitter *out);
+void append_child(ASTNode *parent, ASTNode *child);
 
 // Helper functions from previous example
 void skip_spaces(const char **str)
@@ -65,6 +99,8 @@ NodeType node_type_from_string(const char *str)
         return NODE_SEQUENCE;
     if (strcmp(str, "DECLARATION") == 0)
         return NODE_DECLARATION;
+    if (strcmp(str, "ASSIGNMENT") == 0)
+        return NODE_ASSIGNMENT;
     if (strcmp(str, "INT") == 0)
         return NODE_INT;
     if (strcmp(str, "BINARY_EXPR") == 0)
@@ -85,6 +121,8 @@ NodeType node_type_from_string(const char *str)
         return NODE_RETURN_STMT;
     if (strcmp(str, "STRING") == 0)
         return NODE_STRING;
+    if (strcmp(str, "REPEAT") == 0)
+        return NODE_REPEAT;
     return NODE_UNKNOWN;
 }
 
@@ -183,14 +221,15 @@ ASTNode *parse_ast_recursive(FILE *f, int current_indent)
         {
         case NODE_FUNCTION_DEF:
         case NODE_DECLARATION:
+        case NODE_ASSIGNMENT:
         case NODE_VAR:
         case NODE_FUNCTION_CALL:
+        case NODE_REPEAT:
             node->name = arg;
             break;
         case NODE_BINARY_EXPR:
         case NODE_UNARY_EXPR:
-            strncpy(node->op, arg, 3);
-            node->op[3] = 0;
+            node->op = operator_from_spelling(arg);
             free(arg);
             break;
         case NODE_INT:
@@ -201,6 +240,13 @@ ASTNode *parse_ast_recursive(FILE *f, int current_indent)
             node->string_value = arg;
             strip_outer_quotes(node->string_value);
             break;
+        case NODE_IF_STMT:
+            if (strcmp(arg, "likely") == 0)
+                node->expect = 1;
+            else if (strcmp(arg, "unlikely") == 0)
+                node->expect = -1;
+            free(arg);
+            break;
         default:
             free(arg);
             break;
@@ -216,16 +262,7 @@ ASTNode *parse_ast_recursive(FILE *f, int current_indent)
             fseek(f, pos_before, SEEK_SET);
             break;
         }
-        if (node->child_count < MAX_CHILDREN)
-        {
-            node->children[node->child_count++] = child;
-        }
-        else
-        {
-            fprintf(stderr, "Too many children\n");
-            free_ast(child);
-            break;
-        }
+        append_child(node, child);
     }
 
     return node;
@@ -236,6 +273,23 @@ ASTNode *parse_ast(FILE *f)
     return parse_ast_recursive(f, 0);
 }
 
+void append_child(ASTNode *parent, ASTNode *child)
+{
+    if (parent->child_count == parent->child_capacity)
+    {
+        int cap = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        ASTNode **grown = realloc(parent->children, cap * sizeof(ASTNode *));
+        if (!grown)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        parent->children = grown;
+        parent->child_capacity = cap;
+    }
+    parent->children[parent->child_count++] = child;
+}
+
 void free_ast(ASTNode *node)
 {
     if (!node)
@@ -248,19 +302,116 @@ void free_ast(ASTNode *node)
     {
         free_ast(node->children[i]);
     }
+    free(node->children);
     free(node);
 }
 
-void print_indent(FILE *out, int indent)
+void print_indent(Emitter *out, int indent)
 {
-    for (int i = 0; i < indent; i++)
-        fputc(' ', out);
+    emit_indent(out, indent);
 }
 
 // Forward declaration for expressions printing
-void print_expression(ASTNode *node, FILE *out);
+void print_expression(ASTNode *node, Emitter *out);
+
+void push_binding(const char *name, int bound, int value)
+{
+    if (binding_count == MAX_BINDINGS)
+    {
+        fprintf(stderr, "REPEAT nesting too deep\n");
+        exit(1);
+    }
+    bindings[binding_count].name = name;
+    bindings[binding_count].bound = bound;
+    bindings[binding_count].value = value;
+    binding_count++;
+}
+
+// Innermost binding of a name, or NULL
+Binding *find_binding(const char *name)
+{
+    for (int i = binding_count - 1; i >= 0; i--)
+    {
+        if (strcmp(bindings[i].name, name) == 0)
+            return &bindings[i];
+    }
+    return NULL;
+}
+
+// Value of an expression made of constants and bound induction variables
+int constant_value(ASTNode *node, int *value)
+{
+    if (node->type == NODE_INT)
+    {
+        *value = node->int_value;
+        return 1;
+    }
+    if (node->type == NODE_VAR)
+    {
+        Binding *b = find_binding(node->name);
+        if (!b || !b->bound)
+            return 0;
+        *value = b->value;
+        return 1;
+    }
+    if (node->type == NODE_BINARY_EXPR && node->child_count == 2)
+    {
+        const OperatorInfo *info = operator_info(node->op);
+        int a, b;
+        return info->fold && constant_value(node->children[0], &a) &&
+               constant_value(node->children[1], &b) && info->fold(a, b, value);
+    }
+    return 0;
+}
+
+// Does the block declare variables directly in its own scope?
+int declares_in_block(ASTNode *node)
+{
+    if (node->type == NODE_DECLARATION)
+        return 1;
+    if (node->type != NODE_SEQUENCE)
+        return 0;
+    for (int i = 0; i < node->child_count; i++)
+    {
+        if (declares_in_block(node->children[i]))
+            return 1;
+    }
+    return 0;
+}
+
+// Does the tree call the named function?
+int calls_function(ASTNode *node, const char *name)
+{
+    if (node->type == NODE_FUNCTION_CALL && node->name && strcmp(node->name, name) == 0)
+        return 1;
+    for (int i = 0; i < node->child_count; i++)
+    {
+        if (calls_function(node->children[i], name))
+            return 1;
+    }
+    return 0;
+}
 
-void generate_c_code(ASTNode *node, int indent, FILE *out)
+// Headers for the library calls of the program; write comes from unistd.h
+// (emitted by ast_optimize --evaluate)
+void emit_includes(ASTNode *root, Emitter *out)
+{
+    emit_str(out, "#include <stdio.h>\n");
+    if (calls_function(root, "write"))
+        emit_str(out, "#include <unistd.h>\n");
+    emit_str(out, "\n");
+}
+
+// Increment counter 0 (runs) or 1 (hits) of an instrumented site
+void emit_counter(Emitter *out, int indent, int site, int which)
+{
+    print_indent(out, indent);
+    emit_str(out, "ast_prof_counts[");
+    emit_int(out, site - 1);
+    emit_str(out, which ? "][1]++;\n" : "][0]++;\n");
+}
+
+void generate_c_code(ASTNode *node, int indent, Emitter *out)
 {
     if (!node)
         return;
@@ -270,10 +421,14 @@ void generate_c_code(ASTNode *node, int indent, FILE *out)
     case NODE_FUNCTION_DEF:
         if (node->name)
         {
-            fprintf(out, "int %s() {\n", node->name);
+            emit_str(out, "int ");
+            emit_str(out, node->name);
+            emit_str(out, "() {\n");
+            if (node->site)
+                emit_counter(out, indent + 4, node->site, 0);
             for (int i = 0; i < node->child_count; i++)
                 generate_c_code(node->children[i], indent + 4, out);
-            fprintf(out, "}\n");
+            emit_str(out, "}\n");
         }
         break;
 
@@ -286,77 +441,124 @@ void generate_c_code(ASTNode *node, int indent, FILE *out)
         print_indent(out, indent);
         if (node->child_count == 1 && node->children[0]->type == NODE_INT)
         {
-            fprintf(out, "int %s = %d;\n", node->name, node->children[0]->int_value);
+            emit_str(out, "int ");
+            emit_str(out, node->name);
+            emit_str(out, " = ");
+            emit_int(out, node->children[0]->int_value);
+            emit_str(out, ";\n");
         }
         else if (node->child_count == 1)
         {
             // e.g. int d = a + 8;
-            fprintf(out, "int %s = ", node->name);
+            emit_str(out, "int ");
+            emit_str(out, node->name);
+            emit_str(out, " = ");
             print_expression(node->children[0], out);
-            fprintf(out, ";\n");
+            emit_str(out, ";\n");
         }
         else
         {
-            fprintf(out, "int %s;\n", node->name);
+            emit_str(out, "int ");
+            emit_str(out, node->name);
+            emit_str(out, ";\n");
+        }
+        if (binding_count > 0)
+            push_binding(node->name, 0, 0);
+        break;
+
+    case NODE_ASSIGNMENT:
+        print_indent(out, indent);
+        emit_str(out, node->name);
+        emit_str(out, " = ");
+        if (node->child_count == 1)
+            print_expression(node->children[0], out);
+        emit_str(out, ";\n");
+        break;
+
+    case NODE_REPEAT:
+        // children: first value, count, body. One replica per value.
+        if (node->child_count == 3)
+        {
+            int first = node->children[0]->int_value;
+            int count = node->children[1]->int_value;
+            for (int k = 0; k < count; k++)
+            {
+                int mark = binding_count;
+                push_binding(node->name, 1, first + k);
+                generate_c_code(node->children[2], indent, out);
+                binding_count = mark;
+            }
         }
         break;
 
     case NODE_RETURN_STMT:
         print_indent(out, indent);
-        fprintf(out, "return ");
+        emit_str(out, "return ");
         if (node->child_count == 1 && node->children[0]->type == NODE_INT)
         {
-            fprintf(out, "%d", node->children[0]->int_value);
+            emit_int(out, node->children[0]->int_value);
         }
         else if (node->child_count == 1)
         {
             print_expression(node->children[0], out);
         }
-        fprintf(out, ";\n");
+        emit_str(out, ";\n");
         break;
 
     case NODE_FOR_STMT:
         if (node->child_count == 4)
         {
             // Format: declaration, condition, unary_expr (increment), body
+            if (node->site)
+                emit_counter(out, indent, node->site, 0);
             print_indent(out, indent);
-            fprintf(out, "for (");
+            emit_str(out, "for (");
 
             // Declaration (int i = 0)
             ASTNode *decl = node->children[0];
-            if (decl->type == NODE_DECLARATION && decl->child_count == 1 && decl->children[0]->type == NODE_INT)
+            int mark = binding_count;
+            if (decl->type == NODE_DECLARATION && decl->child_count == 1)
             {
-                fprintf(out, "int %s = %d; ", decl->name, decl->children[0]->int_value);
+                emit_str(out, "int ");
+                emit_str(out, decl->name);
+                emit_str(out, " = ");
+                print_expression(decl->children[0], out);
+                emit_str(out, "; ");
+                if (binding_count > 0)
+                    push_binding(decl->name, 0, 0);
             }
             else
             {
-                fprintf(out, "; "); // fallback
+                emit_str(out, "; "); // fallback
             }
 
             // Condition
             ASTNode *cond = node->children[1];
             print_expression(cond, out);
-            fprintf(out, "; ");
+            emit_str(out, "; ");
 
             // Increment (UNARY_EXPR)
             ASTNode *inc = node->children[2];
             if (inc->type == NODE_UNARY_EXPR && inc->child_count == 1 && inc->children[0]->type == NODE_VAR)
             {
-                fprintf(out, "%s%s", inc->children[0]->name, inc->op);
+                print_expression(inc, out);
             }
             else
             {
                 // fallback
-                fprintf(out, ";");
+                emit_char(out, ';');
             }
 
-            fprintf(out, ") {\n");
+            emit_str(out, ") {\n");
+            if (node->site)
+                emit_counter(out, indent + 4, node->site, 1);
 
             // Body (usually FUNCTION_CALL)
             generate_c_code(node->children[3], indent + 4, out);
+            binding_count = mark;
 
             print_indent(out, indent);
-            fprintf(out, "}\n");
+            emit_str(out, "}\n");
         }
         break;
 
@@ -364,18 +566,21 @@ void generate_c_code(ASTNode *node, int indent, FILE *out)
         print_indent(out, indent);
         if (node->name)
         {
-            fprintf(out, "%s(", node->name);
+            emit_str(out, node->name);
+            emit_char(out, '(');
             if (node->child_count == 1 && node->children[0]->type == NODE_EXPR_LIST)
             {
                 ASTNode *expr_list = node->children[0];
                 for (int i = 0; i < expr_list->child_count; i++)
                 {
                     if (i > 0)
-                        fprintf(out, ", ");
+                        emit_str(out, ", ");
                     ASTNode *expr = expr_list->children[i];
                     if (expr->type == NODE_STRING)
                     {
-                        fprintf(out, "\"%s\"", expr->string_value);
+                        emit_char(out, '"');
+                        emit_str(out, expr->string_value);
+                        emit_char(out, '"');
                     }
                     else
                     {
@@ -383,20 +588,56 @@ void generate_c_code(ASTNode *node, int indent, FILE *out)
                     }
                 }
             }
-            fprintf(out, ");\n");
+            emit_str(out, ");\n");
         }
         break;
 
+    case NODE_UNARY_EXPR:
+        // Expression statement such as "i++;"
+        print_indent(out, indent);
+        print_expression(node, out);
+        emit_str(out, ";\n");
+        break;
+
     case NODE_IF_STMT:
         if (node->child_count >= 2)
         {
+            int mark = binding_count;
+            int cond;
+            // Inside a replica the condition may now be constant
+            if (binding_count > 0 && constant_value(node->children[0], &cond) &&
+                (!cond || !declares_in_block(node->children[1])))
+            {
+                if (cond)
+                    generate_c_code(node->children[1], indent, out);
+                break;
+            }
             print_indent(out, indent);
-            fprintf(out, "if (");
-            print_expression(node->children[0], out);
-            fprintf(out, ") {\n");
+            emit_str(out, "if (");
+            if (node->site)
+            {
+                // Counts evaluations and taken branches, evaluating the condition once
+                emit_str(out, "ast_prof_branch(");
+                emit_int(out, node->site - 1);
+                emit_str(out, ", ");
+                print_expression(node->children[0], out);
+                emit_char(out, ')');
+            }
+            else if (node->expect)
+            {
+                emit_str(out, "__builtin_expect(!!(");
+                print_expression(node->children[0], out);
+                emit_str(out, node->expect > 0 ? "), 1)" : "), 0)");
+            }
+            else
+            {
+                print_expression(node->children[0], out);
+            }
+            emit_str(out, ") {\n");
             generate_c_code(node->children[1], indent + 4, out);
+            binding_count = mark;
             print_indent(out, indent);
-            fprintf(out, "}\n");
+            emit_str(out, "}\n");
         }
         break;
 
@@ -408,71 +649,225 @@ void generate_c_code(ASTNode *node, int indent, FILE *out)
     }
 }
 
+// Print an operand of a binary operator, parenthesized only when the
+// operator table says precedence or associativity requires it
+void print_operand(ASTNode *node, const OperatorInfo *parent, int is_right, Emitter *out)
+{
+    int parens = 0;
+    if (node->type == NODE_BINARY_EXPR)
+    {
+        const OperatorInfo *info = operator_info(node->op);
+        if (info->precedence < parent->precedence)
+            parens = 1;
+        else if (info->precedence == parent->precedence)
+            parens = parent->left_assoc ? is_right : !is_right;
+    }
+    if (parens)
+        emit_char(out, '(');
+    print_expression(node, out);
+    if (parens)
+        emit_char(out, ')');
+}
+
 // Print expressions (used in declarations, conditions, etc.)
-void print_expression(ASTNode *node, FILE *out)
+void print_expression(ASTNode *node, Emitter *out)
 {
+    int value;
     if (!node)
         return;
     switch (node->type)
     {
     case NODE_INT:
-        fprintf(out, "%d", node->int_value);
+        emit_int(out, node->int_value);
         break;
 
     case NODE_VAR:
-        fprintf(out, "%s", node->name);
+    {
+        Binding *b = find_binding(node->name);
+        if (b && b->bound)
+            emit_int(out, b->value);
+        else
+            emit_str(out, node->name);
         break;
+    }
 
     case NODE_BINARY_EXPR:
-        if (node->child_count == 2)
+        if (binding_count > 0 && constant_value(node, &value))
         {
-            fprintf(out, "(");
-            print_expression(node->children[0], out);
-            fprintf(out, " %s ", node->op);
-            print_expression(node->children[1], out);
-            fprintf(out, ")");
+            emit_int(out, value);
+        }
+        else if (node->child_count == 2)
+        {
+            const OperatorInfo *info = operator_info(node->op);
+            print_operand(node->children[0], info, 0, out);
+            emit_char(out, ' ');
+            emit_str(out, info->spelling);
+            emit_char(out, ' ');
+            print_operand(node->children[1], info, 1, out);
         }
         break;
 
     case NODE_UNARY_EXPR:
         if (node->child_count == 1)
         {
-            fprintf(out, "%s%s", node->children[0]->name, node->op);
+            emit_str(out, node->children[0]->name);
+            emit_str(out, operator_info(node->op)->spelling);
         }
         break;
 
     case NODE_FUNCTION_CALL:
-        fprintf(out, "%s(", node->name);
+        emit_str(out, node->name);
+        emit_char(out, '(');
         if (node->child_count == 1 && node->children[0]->type == NODE_EXPR_LIST)
         {
             ASTNode *expr_list = node->children[0];
             for (int i = 0; i < expr_list->child_count; i++)
             {
                 if (i > 0)
-                    fprintf(out, ", ");
+                    emit_str(out, ", ");
                 print_expression(expr_list->children[i], out);
             }
         }
-        fprintf(out, ")");
+        emit_char(out, ')');
         break;
 
     case NODE_STRING:
-        fprintf(out, "\"%s\"", node->string_value);
+        emit_char(out, '"');
+        emit_str(out, node->string_value);
+        emit_char(out, '"');
         break;
 
     default:
         // Unknown expression fallback
-        fprintf(out, "/* expr */");
+        emit_str(out, "/* expr */");
         break;
     }
 }
 
-int main()
+// Hash of a node's own fields; merkle_step then adds each child's hash.
+// Must match ast_optimize.c, which looks profile sites up by this hash.
+uint64_t merkle_seed(ASTNode *node)
+{
+    uint64_t h = cache_hash_int(CACHE_HASH_SEED, node->type);
+    h = cache_hash_string(h, node->name);
+    h = cache_hash_literal(h, node->string_value);
+    h = cache_hash_int(h, node->int_value);
+    h = cache_hash_int(h, node->op);
+    h = cache_hash_int(h, node->expect);
+    return cache_hash_int(h, node->child_count);
+}
+
+uint64_t merkle_step(uint64_t h, uint64_t child)
+{
+    return cache_hash_bytes(h, &child, sizeof(child));
+}
+
+// Hash of a subtree's contents, used as the cache key
+uint64_t merkle_hash(ASTNode *node)
 {
-    FILE *in = fopen("newOutput.txt", "r");
+    uint64_t h = merkle_seed(node);
+    for (int i = 0; i < node->child_count; i++)
+        h = merkle_step(h, merkle_hash(node->children[i]));
+    return h;
+}
+
+// Give every profile site a counter slot, hashing the tree bottom-up in
+// one walk. Returns the subtree's hash.
+uint64_t number_sites(ASTNode *node)
+{
+    uint64_t h = merkle_seed(node);
+    for (int i = 0; i < node->child_count; i++)
+        h = merkle_step(h, number_sites(node->children[i]));
+    if (node->type != NODE_FUNCTION_DEF && node->type != NODE_IF_STMT && node->type != NODE_FOR_STMT)
+        return h;
+    if (site_count == site_capacity)
+    {
+        site_capacity = site_capacity ? site_capacity * 2 : 16;
+        uint64_t *grown = realloc(site_keys, site_capacity * sizeof(uint64_t));
+        if (!grown)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        site_keys = grown;
+    }
+    site_keys[site_count++] = profile_site_key(&site_counter, h);
+    node->site = site_count;
+    return h;
+}
+
+// Counter tables, the branch counter and a destructor that appends the
+// counts to the profile when the program exits
+void emit_profile_runtime(Emitter *out)
+{
+    emit_str(out, "static unsigned long ast_prof_counts[");
+    emit_int(out, site_count);
+    emit_str(out, "][2];\n");
+    emit_str(out, "static const unsigned long long ast_prof_keys[");
+    emit_int(out, site_count);
+    emit_str(out, "] = {\n");
+    for (int i = 0; i < site_count; i++)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), "    0x%016llxULL,\n", (unsigned long long)site_keys[i]);
+        emit_str(out, key);
+    }
+    emit_str(out, "};\n\n");
+    emit_str(out, "static int ast_prof_branch(int site, int taken) {\n"
+                  "    ast_prof_counts[site][0]++;\n"
+                  "    ast_prof_counts[site][1] += taken != 0;\n"
+                  "    return taken;\n"
+                  "}\n\n");
+    emit_str(out, "__attribute__((destructor)) static void ast_prof_dump(void) {\n"
+                  "    FILE *f = fopen(\"");
+    for (const char *p = profile_path; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+            emit_char(out, '\\');
+        emit_char(out, *p);
+    }
+    emit_str(out, "\", \"a\");\n"
+                  "    if (!f)\n"
+                  "        return;\n"
+                  "    for (int i = 0; i < ");
+    emit_int(out, site_count);
+    emit_str(out, "; i++)\n"
+                  "        fprintf(f, \"%016llx %lu %lu\\n\", ast_prof_keys[i], ast_prof_counts[i][0], ast_prof_counts[i][1]);\n"
+                  "    fclose(f);\n"
+                  "}\n\n");
+}
+
+int main(int argc, char **argv)
+{
+    // Instrumented code is built from the optimizer's input, so that the
+    // profile keys match the subtrees ast_optimize looks up
+    const char *input = "newOutput.txt";
+    const char *output = "optimizedCode.c";
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--instrument") == 0 || strncmp(argv[i], "--instrument=", 13) == 0)
+        {
+            instrument = 1;
+            if (argv[i][12] == '=')
+                profile_path = argv[i] + 13;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [--instrument[=PROFILE]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (instrument)
+    {
+        input = "output.txt";
+        output = "instrumentedCode.c";
+    }
+
+    FILE *in = fopen(input, "r");
     if (!in)
     {
-        fprintf(stderr, "Cannot open newOutput.txt for reading\n");
+        fprintf(stderr, "Cannot open %s for reading\n", input);
         return 1;
     }
 
@@ -485,19 +880,65 @@ int main()
         return 1;
     }
 
-    FILE *out = fopen("optimizedCode.c", "w");
-    if (!out)
+    // C generated earlier for an identical AST is reused from the cache
+    // The settings go into both the key and the material stored with the entry
+    Cache cache;
+    CacheMaterial material = { NULL, 0 };
+    uint64_t key = 0;
+    cache_open(&cache);
+    if (cache.enabled)
+    {
+        const char *counters = instrument ? profile_path : "-";
+        size_t size = strlen(counters) + 32;
+        char *settings = malloc(size);
+        uint64_t tree = merkle_hash(root);
+        if (settings)
+        {
+            snprintf(settings, size, "ast_to_c %d %s", CACHE_FORMAT_VERSION, counters);
+            key = cache_hash_string(CACHE_HASH_SEED, settings);
+            key = cache_hash_bytes(key, &tree, sizeof(tree));
+            cache_material(&material, settings, input);
+            free(settings);
+        }
+    }
+    if (cache_fetch(&cache, key, &material, output))
+    {
+        cache_material_free(&material);
+        free_ast(root);
+        return 0;
+    }
+
+    Emitter out;
+    if (emit_open(&out, output) != 0)
     {
-        fprintf(stderr, "Cannot open output.c for writing\n");
+        fprintf(stderr, "Cannot open %s for writing\n", output);
+        cache_material_free(&material);
         free_ast(root);
         return 1;
     }
 
-    fprintf(out, "#include <stdio.h>\n\n");
-    generate_c_code(root, 0, out);
+    emit_includes(root, &out);
+    if (instrument)
+    {
+        number_sites(root);
+        emit_profile_runtime(&out);
+    }
+    generate_c_code(root, 0, &out);
 
-    fclose(out);
+    if (emit_close(&out) != 0)
+    {
+        fprintf(stderr, "Failed to write %s\n", output);
+        cache_material_free(&material);
+        free_ast(root);
+        free(site_keys);
+        site_counter_free(&site_counter);
+        return 1;
+    }
+    cache_store(&cache, key, &material, output);
+    cache_material_free(&material);
     free_ast(root);
+    free(site_keys);
+    site_counter_free(&site_counter);
 
     return 0;
 }
@@ -0,0 +1,1247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ops.h"
+
+/*
+    Lowers the optimized AST (newOutput.txt) to a control-flow graph of
+    basic blocks in SSA form and writes
+      ssaOutput.txt : the IR with dominator tree and def-use chains
+      ssaCode.c     : C emitted directly from the CFG (out of SSA)
+
+    Values, instructions and blocks are dense integer ids indexing flat
+    arrays. Construction follows Cytron et al.: lower with explicit
+    loads/stores of source variables, compute dominators (Cooper-Harvey-
+    Kennedy) and dominance frontiers, place phis, then rename along the
+    dominator tree. Every step is linear or near-linear in the function size.
+*/
+
+#define MAX_LINE_LEN 256
+
+typedef enum {
+    NODE_FUNCTION_DEF,
+    NODE_SEQUENCE,
+    NODE_DECLARATION,
+    NODE_ASSIGNMENT,
+    NODE_INT,
+    NODE_BINARY_EXPR,
+    NODE_VAR,
+    NODE_IF_STMT,
+    NODE_FUNCTION_CALL,
+    NODE_EXPR_LIST,
+    NODE_FOR_STMT,
+    NODE_UNARY_EXPR,
+    NODE_RETURN_STMT,
+    NODE_STRING,
+    NODE_REPEAT,
+    NODE_UNKNOWN
+} NodeType;
+
+typedef struct ASTNode {
+    NodeType type;
+    char *name;
+    int int_value;
+    char *string_value;
+    Operator op;
+    struct ASTNode **children;
+    int child_count;
+    int child_capacity;
+} ASTNode;
+
+/* Forward declarations */
+ASTNode *parse_ast(FILE *f);
+void free_ast(ASTNode *node);
+void append_child(ASTNode *parent, ASTNode *child);
+
+/* Helper function to skip spaces */
+void skip_spaces(const char **str) {
+    while (**str == ' ' || **str == '\t') (*str)++;
+}
+
+/* Helper to count the leading spaces */
+int count_leading_spaces(const char *line) {
+    int count = 0;
+    while (*line == ' ') {
+        count++;
+        line++;
+    }
+    return count;
+}
+
+/* Convert string to NodeType */
+NodeType node_type_from_string(const char *str) {
+    if (strcmp(str, "FUNCTION_DEF") == 0) return NODE_FUNCTION_DEF;
+    if (strcmp(str, "SEQUENCE") == 0) return NODE_SEQUENCE;
+    if (strcmp(str, "DECLARATION") == 0) return NODE_DECLARATION;
+    if (strcmp(str, "ASSIGNMENT") == 0) return NODE_ASSIGNMENT;
+    if (strcmp(str, "INT") == 0) return NODE_INT;
+    if (strcmp(str, "BINARY_EXPR") == 0) return NODE_BINARY_EXPR;
+    if (strcmp(str, "VAR") == 0) return NODE_VAR;
+    if (strcmp(str, "IF_STMT") == 0) return NODE_IF_STMT;
+    if (strcmp(str, "FUNCTION_CALL") == 0) return NODE_FUNCTION_CALL;
+    if (strcmp(str, "EXPR_LIST") == 0) return NODE_EXPR_LIST;
+    if (strcmp(str, "FOR_STMT") == 0) return NODE_FOR_STMT;
+    if (strcmp(str, "UNARY_EXPR") == 0) return NODE_UNARY_EXPR;
+    if (strcmp(str, "RETURN_STMT") == 0) return NODE_RETURN_STMT;
+    if (strcmp(str, "STRING") == 0) return NODE_STRING;
+    if (strcmp(str, "REPEAT") == 0) return NODE_REPEAT;
+    return NODE_UNKNOWN;
+}
+
+/* Parse a line in the AST text and (optionally) extract an argument */
+NodeType parse_line(const char *line, char **arg) {
+    *arg = NULL;
+    const char *p = line;
+
+    char type_buf[64];
+    int i = 0;
+    while (*p && *p != ' ' && *p != '(' && *p != '\n' && i < 63) {
+        type_buf[i++] = *p++;
+    }
+    type_buf[i] = 0;
+    NodeType t = node_type_from_string(type_buf);
+    if (t == NODE_UNKNOWN) return NODE_UNKNOWN;
+    
+    skip_spaces(&p);
+    if (*p == '(') {
+        p++;
+        const char *start = p;
+        while (*p && *p != ')') p++;
+        if (*p != ')') return NODE_UNKNOWN;
+        int len = (int)(p - start);
+        *arg = malloc(len + 1);
+        strncpy(*arg, start, len);
+        (*arg)[len] = 0;
+    }
+    return t;
+}
+
+/* Remove the quote characters the AST printers wrap around string literals */
+void strip_outer_quotes(char *s) {
+    int len = (int)strlen(s);
+    int start = 0, end = len - 1;
+    while (start < len && s[start] == '"') start++;
+    while (end >= start && s[end] == '"') end--;
+    int new_len = end - start + 1;
+    memmove(s, s + start, new_len);
+    s[new_len] = 0;
+}
+
+/* Recursively parse the AST from a file */
+ASTNode *parse_ast_recursive(FILE *f, int current_indent) {
+    char line[MAX_LINE_LEN];
+    long last_pos = ftell(f);
+    if (!fgets(line, MAX_LINE_LEN, f)) return NULL;
+
+    int indent = count_leading_spaces(line);
+    if (indent < current_indent) {
+        fseek(f, last_pos, SEEK_SET);
+        return NULL;
+    }
+    if (indent > current_indent) {
+        fprintf(stderr, "Unexpected indentation\n");
+        return NULL;
+    }
+    
+    char *arg = NULL;
+    char *trim_line = line + indent;
+    NodeType t = parse_line(trim_line, &arg);
+    if (t == NODE_UNKNOWN) {
+        fprintf(stderr, "Unknown node type in line: %s\n", trim_line);
+        if (arg) free(arg);
+        return NULL;
+    }
+    
+    ASTNode *node = calloc(1, sizeof(ASTNode));
+    node->type = t;
+    node->child_count = 0;
+    
+    if (arg) {
+        switch (t) {
+            case NODE_FUNCTION_DEF:
+            case NODE_DECLARATION:
+            case NODE_ASSIGNMENT:
+            case NODE_VAR:
+            case NODE_FUNCTION_CALL:
+            case NODE_REPEAT:
+                node->name = arg;
+                break;
+            case NODE_BINARY_EXPR:
+            case NODE_UNARY_EXPR:
+                node->op = operator_from_spelling(arg);
+                free(arg);
+                break;
+            case NODE_INT:
+                node->int_value = atoi(arg);
+                free(arg);
+                break;
+            case NODE_STRING:
+                node->string_value = arg;
+                strip_outer_quotes(node->string_value);
+                break;
+            default:
+                free(arg);
+                break;
+        }
+    }
+    
+    while (1) {
+        long pos_before = ftell(f);
+        ASTNode *child = parse_ast_recursive(f, current_indent + 2);
+        if (!child) {
+            fseek(f, pos_before, SEEK_SET);
+            break;
+        }
+        append_child(node, child);
+    }
+    
+    return node;
+}
+
+/* Wrapper to parse AST from file */
+ASTNode *parse_ast(FILE *f) {
+    return parse_ast_recursive(f, 0);
+}
+
+/* Append a child, growing the child array as needed */
+void append_child(ASTNode *parent, ASTNode *child) {
+    if (parent->child_count == parent->child_capacity) {
+        int cap = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        ASTNode **grown = realloc(parent->children, cap * sizeof(ASTNode *));
+        if (!grown) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        parent->children = grown;
+        parent->child_capacity = cap;
+    }
+    parent->children[parent->child_count++] = child;
+}
+
+/* Free the AST recursively */
+void free_ast(ASTNode *node) {
+    if (!node) return;
+    if (node->name) free(node->name);
+    if (node->string_value) free(node->string_value);
+    for (int i = 0; i < node->child_count; i++) {
+        free_ast(node->children[i]);
+    }
+    free(node->children);
+    free(node);
+}
+
+/* ---------------------------------------------------------------------- */
+/* IR                                                                      */
+/* ---------------------------------------------------------------------- */
+
+typedef enum {
+    IR_CONST,   /* imm */
+    IR_STRING,  /* text: string literal, used directly as a call argument */
+    IR_SYMBOL,  /* text: name that is not a local variable (e.g. stdout) */
+    IR_UNDEF,   /* value of a variable read before any store */
+    IR_BINARY,  /* a binop b */
+    IR_CALL,    /* text(args...) */
+    IR_PHI,     /* args[i] flows in from preds[i] */
+    IR_LOAD,    /* read of source variable var; removed by renaming */
+    IR_STORE    /* var = a; removed by renaming */
+} Opcode;
+
+typedef enum {
+    TERM_NONE,
+    TERM_BR,    /* goto succ[0] */
+    TERM_CBR,   /* if (value) goto succ[0] else goto succ[1] */
+    TERM_RET    /* return value (or 0 when value < 0) */
+} TermKind;
+
+typedef struct {
+    Opcode op;
+    int block;
+    int a, b;
+    int imm;
+    Operator binop;
+    char *text;
+    int var;
+    int arg_start, arg_count;   /* slice of IR.operands */
+    int dead;
+} Instr;
+
+typedef struct {
+    int *instrs;                /* non-phi instruction ids, in order */
+    int count, capacity;
+    int *phis;                  /* phi instruction ids */
+    int phi_count, phi_capacity;
+    int *preds;
+    int pred_count, pred_capacity;
+    TermKind term;
+    int value;                  /* CBR condition or RET value */
+    int succ[2];
+    int rpo;                    /* reverse postorder number, -1 if unreachable */
+    int idom;
+    int *frontier;
+    int frontier_count, frontier_capacity;
+} Block;
+
+typedef struct {
+    Instr *instrs;
+    int instr_count, instr_capacity;
+    Block *blocks;
+    int block_count, block_capacity;
+    int *operands;
+    int operand_count, operand_capacity;
+    char **var_names;
+    int var_count, var_capacity;
+    int *rpo_order;             /* reachable blocks in reverse postorder */
+    int rpo_count;
+    int cur;                    /* block being filled while lowering */
+} IR;
+
+/* Grow a dense array so that it can hold at least needed elements */
+void *grow_array(void *data, int *capacity, int needed, size_t elem_size) {
+    if (needed <= *capacity) return data;
+    int cap = *capacity ? *capacity : 8;
+    while (cap < needed) cap *= 2;
+    data = realloc(data, cap * elem_size);
+    if (!data) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    *capacity = cap;
+    return data;
+}
+
+void int_list_push(int **list, int *count, int *capacity, int value) {
+    *list = grow_array(*list, capacity, *count + 1, sizeof(int));
+    (*list)[(*count)++] = value;
+}
+
+int new_block(IR *ir) {
+    ir->blocks = grow_array(ir->blocks, &ir->block_capacity, ir->block_count + 1, sizeof(Block));
+    Block *b = &ir->blocks[ir->block_count];
+    memset(b, 0, sizeof(Block));
+    b->value = -1;
+    b->succ[0] = b->succ[1] = -1;
+    b->rpo = -1;
+    b->idom = -1;
+    return ir->block_count++;
+}
+
+int new_instr(IR *ir, Opcode op, int block) {
+    ir->instrs = grow_array(ir->instrs, &ir->instr_capacity, ir->instr_count + 1, sizeof(Instr));
+    Instr *in = &ir->instrs[ir->instr_count];
+    memset(in, 0, sizeof(Instr));
+    in->op = op;
+    in->block = block;
+    in->a = in->b = -1;
+    in->var = -1;
+    return ir->instr_count++;
+}
+
+/* Append an instruction to the current block */
+int emit(IR *ir, Opcode op) {
+    int id = new_instr(ir, op, ir->cur);
+    Block *b = &ir->blocks[ir->cur];
+    int_list_push(&b->instrs, &b->count, &b->capacity, id);
+    return id;
+}
+
+int alloc_operands(IR *ir, int count) {
+    ir->operands = grow_array(ir->operands, &ir->operand_capacity, ir->operand_count + count, sizeof(int));
+    int start = ir->operand_count;
+    for (int i = 0; i < count; i++) ir->operands[start + i] = -1;
+    ir->operand_count += count;
+    return start;
+}
+
+int new_var(IR *ir, const char *name) {
+    ir->var_names = grow_array(ir->var_names, &ir->var_capacity, ir->var_count + 1, sizeof(char *));
+    ir->var_names[ir->var_count] = strdup(name);
+    return ir->var_count++;
+}
+
+void add_edge(IR *ir, int from, int to) {
+    Block *b = &ir->blocks[to];
+    int_list_push(&b->preds, &b->pred_count, &b->pred_capacity, from);
+}
+
+/* Terminate the current block. A block that already ended (after a
+   return) keeps its terminator; the dead code lands in a fresh block. */
+void terminate(IR *ir, TermKind kind, int value, int succ0, int succ1) {
+    Block *b = &ir->blocks[ir->cur];
+    if (b->term != TERM_NONE) return;
+    b->term = kind;
+    b->value = value;
+    b->succ[0] = succ0;
+    b->succ[1] = succ1;
+    if (succ0 >= 0) add_edge(ir, ir->cur, succ0);
+    if (succ1 >= 0) add_edge(ir, ir->cur, succ1);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Lowering AST -> CFG with loads and stores                               */
+/* ---------------------------------------------------------------------- */
+
+/* Lexical scope: source names bound to dense variable ids, innermost last */
+typedef struct {
+    const char **names;
+    int *vars;
+    int count, capacity, vars_capacity;
+} Scope;
+
+void scope_bind(Scope *s, const char *name, int var) {
+    s->names = grow_array(s->names, &s->capacity, s->count + 1, sizeof(char *));
+    s->vars = grow_array(s->vars, &s->vars_capacity, s->count + 1, sizeof(int));
+    s->names[s->count] = name;
+    s->vars[s->count] = var;
+    s->count++;
+}
+
+int scope_lookup(Scope *s, const char *name) {
+    for (int i = s->count - 1; i >= 0; i--) {
+        if (strcmp(s->names[i], name) == 0) return s->vars[i];
+    }
+    return -1;
+}
+
+int lower_expr(IR *ir, Scope *scope, ASTNode *node);
+void lower_stmt(IR *ir, Scope *scope, ASTNode *node);
+
+int lower_store(IR *ir, int var, int value) {
+    int id = emit(ir, IR_STORE);
+    ir->instrs[id].var = var;
+    ir->instrs[id].a = value;
+    return id;
+}
+
+int lower_expr(IR *ir, Scope *scope, ASTNode *node) {
+    int id;
+    switch (node->type) {
+        case NODE_INT:
+            id = emit(ir, IR_CONST);
+            ir->instrs[id].imm = node->int_value;
+            return id;
+        case NODE_STRING:
+            id = emit(ir, IR_STRING);
+            ir->instrs[id].text = node->string_value;
+            return id;
+        case NODE_VAR: {
+            int var = scope_lookup(scope, node->name);
+            if (var < 0) {
+                id = emit(ir, IR_SYMBOL);
+                ir->instrs[id].text = node->name;
+                return id;
+            }
+            id = emit(ir, IR_LOAD);
+            ir->instrs[id].var = var;
+            return id;
+        }
+        case NODE_BINARY_EXPR: {
+            if (operator_info(node->op)->arity != 2) {
+                fprintf(stderr, "Unsupported binary operator\n");
+                exit(1);
+            }
+            int a = lower_expr(ir, scope, node->children[0]);
+            int b = lower_expr(ir, scope, node->children[1]);
+            id = emit(ir, IR_BINARY);
+            ir->instrs[id].binop = node->op;
+            ir->instrs[id].a = a;
+            ir->instrs[id].b = b;
+            return id;
+        }
+        case NODE_UNARY_EXPR: {
+            /* Postfix: yields the old value, then stores old +/- 1 */
+            int var = scope_lookup(scope, node->children[0]->name);
+            if (var < 0) {
+                fprintf(stderr, "Unknown variable %s\n", node->children[0]->name);
+                exit(1);
+            }
+            int old = emit(ir, IR_LOAD);
+            ir->instrs[old].var = var;
+            int one = emit(ir, IR_CONST);
+            ir->instrs[one].imm = 1;
+            int updated = emit(ir, IR_BINARY);
+            ir->instrs[updated].binop = node->op == OP_DEC ? OP_SUB : OP_ADD;
+            ir->instrs[updated].a = old;
+            ir->instrs[updated].b = one;
+            lower_store(ir, var, updated);
+            return old;
+        }
+        case NODE_FUNCTION_CALL: {
+            ASTNode *args = node->child_count == 1 ? node->children[0] : NULL;
+            int argc = args ? args->child_count : 0;
+            int *values = malloc((argc ? argc : 1) * sizeof(int));
+            for (int i = 0; i < argc; i++) {
+                values[i] = lower_expr(ir, scope, args->children[i]);
+            }
+            id = emit(ir, IR_CALL);
+            ir->instrs[id].text = node->name;
+            ir->instrs[id].arg_start = alloc_operands(ir, argc);
+            ir->instrs[id].arg_count = argc;
+            memcpy(&ir->operands[ir->instrs[id].arg_start], values, argc * sizeof(int));
+            free(values);
+            return id;
+        }
+        default:
+            fprintf(stderr, "Unsupported expression node %d\n", node->type);
+            exit(1);
+    }
+}
+
+void lower_stmt(IR *ir, Scope *scope, ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+        case NODE_SEQUENCE: {
+            int mark = scope->count;
+            for (int i = 0; i < node->child_count; i++) {
+                lower_stmt(ir, scope, node->children[i]);
+            }
+            if (node->type == NODE_FUNCTION_DEF) scope->count = mark;
+            break;
+        }
+        case NODE_DECLARATION: {
+            int value;
+            if (node->child_count == 1) {
+                value = lower_expr(ir, scope, node->children[0]);
+            } else {
+                value = emit(ir, IR_UNDEF);
+            }
+            int var = new_var(ir, node->name);
+            if (node->child_count == 0) ir->instrs[value].var = var;
+            scope_bind(scope, node->name, var);
+            lower_store(ir, var, value);
+            break;
+        }
+        case NODE_ASSIGNMENT: {
+            int value = lower_expr(ir, scope, node->children[0]);
+            int var = scope_lookup(scope, node->name);
+            if (var < 0) {
+                fprintf(stderr, "Unknown variable %s\n", node->name);
+                exit(1);
+            }
+            lower_store(ir, var, value);
+            break;
+        }
+        case NODE_IF_STMT: {
+            int cond = lower_expr(ir, scope, node->children[0]);
+            int then_block = new_block(ir);
+            int join = new_block(ir);
+            terminate(ir, TERM_CBR, cond, then_block, join);
+            ir->cur = then_block;
+            int mark = scope->count;
+            lower_stmt(ir, scope, node->children[1]);
+            scope->count = mark;
+            terminate(ir, TERM_BR, -1, join, -1);
+            ir->cur = join;
+            break;
+        }
+        case NODE_FOR_STMT: {
+            /* children: init, condition, update, body */
+            int mark = scope->count;
+            lower_stmt(ir, scope, node->children[0]);
+            int header = new_block(ir);
+            int body = new_block(ir);
+            int exit_block = new_block(ir);
+            terminate(ir, TERM_BR, -1, header, -1);
+            ir->cur = header;
+            int cond = lower_expr(ir, scope, node->children[1]);
+            terminate(ir, TERM_CBR, cond, body, exit_block);
+            ir->cur = body;
+            int body_mark = scope->count;
+            lower_stmt(ir, scope, node->children[3]);
+            scope->count = body_mark;
+            lower_expr(ir, scope, node->children[2]);
+            terminate(ir, TERM_BR, -1, header, -1);
+            ir->cur = exit_block;
+            scope->count = mark;
+            break;
+        }
+        case NODE_REPEAT: {
+            /* children: first value, count, body. The replicas are laid
+               out in straight line, each after a store of its value. */
+            int first = node->children[0]->int_value;
+            int count = node->children[1]->int_value;
+            int var = new_var(ir, node->name);
+            int mark = scope->count;
+            scope_bind(scope, node->name, var);
+            for (int k = 0; k < count; k++) {
+                int value = emit(ir, IR_CONST);
+                ir->instrs[value].imm = first + k;
+                lower_store(ir, var, value);
+                int body_mark = scope->count;
+                lower_stmt(ir, scope, node->children[2]);
+                scope->count = body_mark;
+            }
+            scope->count = mark;
+            break;
+        }
+        case NODE_RETURN_STMT: {
+            int value = node->child_count == 1 ? lower_expr(ir, scope, node->children[0]) : -1;
+            terminate(ir, TERM_RET, value, -1, -1);
+            ir->cur = new_block(ir);
+            break;
+        }
+        default:
+            lower_expr(ir, scope, node);
+            break;
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Dominators and dominance frontiers                                      */
+/* ---------------------------------------------------------------------- */
+
+void compute_rpo(IR *ir) {
+    int n = ir->block_count;
+    int *stack = malloc(n * sizeof(int));
+    int *next_succ = calloc(n, sizeof(int));
+    int *visited = calloc(n, sizeof(int));
+    int *post = malloc(n * sizeof(int));
+    int post_count = 0, top = 0;
+    stack[top++] = 0;
+    visited[0] = 1;
+    while (top > 0) {
+        int b = stack[top - 1];
+        Block *blk = &ir->blocks[b];
+        if (next_succ[b] < 2) {
+            int s = blk->succ[next_succ[b]++];
+            if (s >= 0 && !visited[s]) {
+                visited[s] = 1;
+                stack[top++] = s;
+            }
+        } else {
+            post[post_count++] = b;
+            top--;
+        }
+    }
+    ir->rpo_order = malloc((post_count ? post_count : 1) * sizeof(int));
+    ir->rpo_count = post_count;
+    for (int i = 0; i < post_count; i++) {
+        int b = post[post_count - 1 - i];
+        ir->rpo_order[i] = b;
+        ir->blocks[b].rpo = i;
+    }
+    free(stack);
+    free(next_succ);
+    free(visited);
+    free(post);
+}
+
+int intersect(IR *ir, int b1, int b2) {
+    while (b1 != b2) {
+        while (ir->blocks[b1].rpo > ir->blocks[b2].rpo) b1 = ir->blocks[b1].idom;
+        while (ir->blocks[b2].rpo > ir->blocks[b1].rpo) b2 = ir->blocks[b2].idom;
+    }
+    return b1;
+}
+
+/* Cooper, Harvey and Kennedy: iterate idom over reverse postorder */
+void compute_dominators(IR *ir) {
+    ir->blocks[0].idom = 0;
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < ir->rpo_count; i++) {
+            int b = ir->rpo_order[i];
+            Block *blk = &ir->blocks[b];
+            int new_idom = -1;
+            for (int p = 0; p < blk->pred_count; p++) {
+                int pred = blk->preds[p];
+                if (ir->blocks[pred].idom < 0) continue;
+                new_idom = new_idom < 0 ? pred : intersect(ir, pred, new_idom);
+            }
+            if (new_idom != blk->idom) {
+                blk->idom = new_idom;
+                changed = 1;
+            }
+        }
+    }
+}
+
+void compute_frontiers(IR *ir) {
+    int *last_added = malloc(ir->block_count * sizeof(int));
+    for (int i = 0; i < ir->block_count; i++) last_added[i] = -1;
+    for (int i = 0; i < ir->rpo_count; i++) {
+        int b = ir->rpo_order[i];
+        Block *blk = &ir->blocks[b];
+        if (blk->pred_count < 2) continue;
+        for (int p = 0; p < blk->pred_count; p++) {
+            int runner = blk->preds[p];
+            if (ir->blocks[runner].rpo < 0) continue;
+            while (runner != blk->idom) {
+                Block *r = &ir->blocks[runner];
+                if (last_added[runner] != b) {
+                    int_list_push(&r->frontier, &r->frontier_count, &r->frontier_capacity, b);
+                    last_added[runner] = b;
+                }
+                runner = r->idom;
+            }
+        }
+    }
+    free(last_added);
+}
+
+/* ---------------------------------------------------------------------- */
+/* SSA construction                                                        */
+/* ---------------------------------------------------------------------- */
+
+/* Semi-pruned SSA: only variables read in some block before being stored
+   there can be live across blocks and need phis */
+int *find_nonlocal_vars(IR *ir) {
+    int *nonlocal = calloc(ir->var_count ? ir->var_count : 1, sizeof(int));
+    int *stored_in = malloc((ir->var_count ? ir->var_count : 1) * sizeof(int));
+    for (int v = 0; v < ir->var_count; v++) stored_in[v] = -1;
+    for (int b = 0; b < ir->block_count; b++) {
+        Block *blk = &ir->blocks[b];
+        for (int i = 0; i < blk->count; i++) {
+            Instr *in = &ir->instrs[blk->instrs[i]];
+            if (in->op == IR_LOAD && stored_in[in->var] != b) nonlocal[in->var] = 1;
+            else if (in->op == IR_STORE) stored_in[in->var] = b;
+        }
+    }
+    free(stored_in);
+    return nonlocal;
+}
+
+/* Place phis at the iterated dominance frontier of each variable's stores */
+void place_phis(IR *ir) {
+    int nvars = ir->var_count, nblocks = ir->block_count;
+    int *nonlocal = find_nonlocal_vars(ir);
+    /* Stores per variable as a CSR list of blocks */
+    int *start = calloc(nvars + 1, sizeof(int));
+    for (int i = 0; i < ir->instr_count; i++) {
+        Instr *in = &ir->instrs[i];
+        if (in->op == IR_STORE && ir->blocks[in->block].rpo >= 0) start[in->var + 1]++;
+    }
+    for (int v = 0; v < nvars; v++) start[v + 1] += start[v];
+    int *fill = malloc((nvars + 1) * sizeof(int));
+    memcpy(fill, start, (nvars + 1) * sizeof(int));
+    int *def_blocks = malloc((start[nvars] ? start[nvars] : 1) * sizeof(int));
+    for (int i = 0; i < ir->instr_count; i++) {
+        Instr *in = &ir->instrs[i];
+        if (in->op == IR_STORE && ir->blocks[in->block].rpo >= 0) def_blocks[fill[in->var]++] = in->block;
+    }
+
+    int *has_phi = malloc(nblocks * sizeof(int));
+    int *queued = malloc(nblocks * sizeof(int));
+    int *work = malloc((nblocks + start[nvars] + 1) * sizeof(int));
+    for (int b = 0; b < nblocks; b++) has_phi[b] = queued[b] = -1;
+    for (int v = 0; v < nvars; v++) {
+        if (!nonlocal[v]) continue;
+        int top = 0;
+        for (int i = start[v]; i < start[v + 1]; i++) {
+            int b = def_blocks[i];
+            if (queued[b] != v) {
+                queued[b] = v;
+                work[top++] = b;
+            }
+        }
+        while (top > 0) {
+            Block *blk = &ir->blocks[work[--top]];
+            for (int f = 0; f < blk->frontier_count; f++) {
+                int d = blk->frontier[f];
+                if (has_phi[d] == v) continue;
+                has_phi[d] = v;
+                Block *target = &ir->blocks[d];
+                int phi = new_instr(ir, IR_PHI, d);
+                ir->instrs[phi].var = v;
+                ir->instrs[phi].arg_count = target->pred_count;
+                ir->instrs[phi].arg_start = alloc_operands(ir, target->pred_count);
+                int_list_push(&target->phis, &target->phi_count, &target->phi_capacity, phi);
+                if (queued[d] != v) {
+                    queued[d] = v;
+                    work[top++] = d;
+                }
+            }
+        }
+    }
+    free(nonlocal);
+    free(start);
+    free(fill);
+    free(def_blocks);
+    free(has_phi);
+    free(queued);
+    free(work);
+}
+
+/* Renaming state: one stack of reaching definitions per variable, kept as
+   a single push log so popping a block's definitions is O(pushed) */
+typedef struct {
+    int value;
+    int var;
+    int prev;           /* previous top of var's stack */
+} DefEntry;
+
+typedef struct {
+    int *top;           /* per variable: index into log, -1 if empty */
+    DefEntry *log;
+    int log_count, log_capacity;
+    int *replace;       /* per value: replacement for removed loads, -1 otherwise */
+    int *undef;         /* per variable: lazily created IR_UNDEF value */
+    int *undefs;
+    int undef_count, undef_capacity;
+} Renamer;
+
+int resolve(Renamer *r, int v) {
+    while (v >= 0 && r->replace[v] >= 0) v = r->replace[v];
+    return v;
+}
+
+int current_def(IR *ir, Renamer *r, int var) {
+    if (r->top[var] >= 0) return r->log[r->top[var]].value;
+    if (r->undef[var] < 0) {
+        int id = new_instr(ir, IR_UNDEF, 0);
+        ir->instrs[id].var = var;
+        r->undef[var] = id;
+        int_list_push(&r->undefs, &r->undef_count, &r->undef_capacity, id);
+        /* keep the replacement map as long as the instruction array */
+        r->replace = realloc(r->replace, ir->instr_count * sizeof(int));
+        r->replace[id] = -1;
+    }
+    return r->undef[var];
+}
+
+void push_def(Renamer *r, int var, int value) {
+    r->log = grow_array(r->log, &r->log_capacity, r->log_count + 1, sizeof(DefEntry));
+    r->log[r->log_count].value = value;
+    r->log[r->log_count].var = var;
+    r->log[r->log_count].prev = r->top[var];
+    r->top[var] = r->log_count++;
+}
+
+void rename_block(IR *ir, Renamer *r, int b, int *dom_start, int *dom_children) {
+    int mark = r->log_count;
+    Block *blk = &ir->blocks[b];
+    for (int i = 0; i < blk->phi_count; i++) {
+        push_def(r, ir->instrs[blk->phis[i]].var, blk->phis[i]);
+    }
+    for (int i = 0; i < blk->count; i++) {
+        int id = blk->instrs[i];
+        Instr *in = &ir->instrs[id];
+        if (in->op == IR_LOAD) {
+            int def = current_def(ir, r, ir->instrs[id].var);
+            ir->instrs[id].dead = 1;
+            r->replace[id] = def;
+        } else if (in->op == IR_STORE) {
+            push_def(r, in->var, resolve(r, in->a));
+            in->dead = 1;
+        }
+    }
+    for (int s = 0; s < 2; s++) {
+        int succ = blk->succ[s];
+        if (succ < 0) continue;
+        Block *sb = &ir->blocks[succ];
+        int j = 0;
+        while (j < sb->pred_count && sb->preds[j] != b) j++;
+        for (int p = 0; p < sb->phi_count; p++) {
+            Instr *phi = &ir->instrs[sb->phis[p]];
+            int value = current_def(ir, r, phi->var);
+            phi = &ir->instrs[sb->phis[p]];
+            ir->operands[phi->arg_start + j] = value;
+        }
+    }
+    for (int c = dom_start[b]; c < dom_start[b + 1]; c++) {
+        rename_block(ir, r, dom_children[c], dom_start, dom_children);
+    }
+    while (r->log_count > mark) {
+        r->log_count--;
+        r->top[r->log[r->log_count].var] = r->log[r->log_count].prev;
+    }
+}
+
+/* Dominator tree children as CSR arrays: children of b are
+   dom_children[dom_start[b] .. dom_start[b + 1]) */
+void build_dom_tree(IR *ir, int **out_start, int **out_children) {
+    int n = ir->block_count;
+    int *start = calloc(n + 1, sizeof(int));
+    for (int i = 1; i < ir->rpo_count; i++) start[ir->blocks[ir->rpo_order[i]].idom + 1]++;
+    for (int b = 0; b < n; b++) start[b + 1] += start[b];
+    int *fill = malloc((n + 1) * sizeof(int));
+    memcpy(fill, start, (n + 1) * sizeof(int));
+    int *children = malloc((ir->rpo_count ? ir->rpo_count : 1) * sizeof(int));
+    for (int i = 1; i < ir->rpo_count; i++) {
+        int b = ir->rpo_order[i];
+        children[fill[ir->blocks[b].idom]++] = b;
+    }
+    free(fill);
+    *out_start = start;
+    *out_children = children;
+}
+
+void construct_ssa(IR *ir) {
+    place_phis(ir);
+
+    Renamer r;
+    memset(&r, 0, sizeof(r));
+    r.top = malloc((ir->var_count ? ir->var_count : 1) * sizeof(int));
+    r.undef = malloc((ir->var_count ? ir->var_count : 1) * sizeof(int));
+    for (int v = 0; v < ir->var_count; v++) r.top[v] = r.undef[v] = -1;
+    r.replace = malloc(ir->instr_count * sizeof(int));
+    for (int i = 0; i < ir->instr_count; i++) r.replace[i] = -1;
+
+    int *dom_start, *dom_children;
+    build_dom_tree(ir, &dom_start, &dom_children);
+    rename_block(ir, &r, 0, dom_start, dom_children);
+
+    /* Point every remaining operand at its SSA definition */
+    for (int i = 0; i < ir->instr_count; i++) {
+        Instr *in = &ir->instrs[i];
+        if (in->dead) continue;
+        in->a = resolve(&r, in->a);
+        in->b = resolve(&r, in->b);
+        if (in->op == IR_CALL) {
+            for (int k = 0; k < in->arg_count; k++) {
+                int *slot = &ir->operands[in->arg_start + k];
+                *slot = resolve(&r, *slot);
+            }
+        }
+    }
+    for (int b = 0; b < ir->block_count; b++) {
+        Block *blk = &ir->blocks[b];
+        blk->value = resolve(&r, blk->value);
+        int kept = 0;
+        for (int i = 0; i < blk->count; i++) {
+            if (!ir->instrs[blk->instrs[i]].dead) blk->instrs[kept++] = blk->instrs[i];
+        }
+        blk->count = kept;
+    }
+    /* Undefined initial values live at the top of the entry block */
+    if (r.undef_count > 0) {
+        Block *entry = &ir->blocks[0];
+        entry->instrs = grow_array(entry->instrs, &entry->capacity, entry->count + r.undef_count, sizeof(int));
+        memmove(entry->instrs + r.undef_count, entry->instrs, entry->count * sizeof(int));
+        memcpy(entry->instrs, r.undefs, r.undef_count * sizeof(int));
+        entry->count += r.undef_count;
+    }
+
+    free(dom_start);
+    free(dom_children);
+    free(r.top);
+    free(r.log);
+    free(r.replace);
+    free(r.undef);
+    free(r.undefs);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Def-use chains                                                          */
+/* ---------------------------------------------------------------------- */
+
+/* Uses of value v are use_list[use_start[v] .. use_start[v + 1]); a user
+   is an instruction id, or -(block + 1) for a block terminator */
+typedef struct {
+    int *use_start;
+    int *use_list;
+} DefUse;
+
+void for_each_operand(IR *ir, int id, void (*visit)(int value, int user, void *ctx), void *ctx) {
+    Instr *in = &ir->instrs[id];
+    if (in->a >= 0) visit(in->a, id, ctx);
+    if (in->b >= 0) visit(in->b, id, ctx);
+    if (in->op == IR_CALL || in->op == IR_PHI) {
+        for (int k = 0; k < in->arg_count; k++) {
+            int v = ir->operands[in->arg_start + k];
+            if (v >= 0) visit(v, id, ctx);
+        }
+    }
+}
+
+void count_use(int value, int user, void *ctx) {
+    (void)user;
+    ((int *)ctx)[value + 1]++;
+}
+
+typedef struct {
+    int *fill;
+    int *list;
+} UseFill;
+
+void record_use(int value, int user, void *ctx) {
+    UseFill *uf = ctx;
+    uf->list[uf->fill[value]++] = user;
+}
+
+int is_live_instr(IR *ir, int id) {
+    Instr *in = &ir->instrs[id];
+    return !in->dead && in->op != IR_LOAD && in->op != IR_STORE && ir->blocks[in->block].rpo >= 0;
+}
+
+DefUse build_def_use(IR *ir) {
+    DefUse du;
+    int n = ir->instr_count;
+    du.use_start = calloc(n + 1, sizeof(int));
+    for (int i = 0; i < n; i++) {
+        if (is_live_instr(ir, i)) for_each_operand(ir, i, count_use, du.use_start);
+    }
+    for (int b = 0; b < ir->block_count; b++) {
+        if (ir->blocks[b].rpo >= 0 && ir->blocks[b].value >= 0) du.use_start[ir->blocks[b].value + 1]++;
+    }
+    for (int i = 0; i < n; i++) du.use_start[i + 1] += du.use_start[i];
+    du.use_list = malloc((du.use_start[n] ? du.use_start[n] : 1) * sizeof(int));
+    UseFill uf;
+    uf.fill = malloc((n + 1) * sizeof(int));
+    uf.list = du.use_list;
+    memcpy(uf.fill, du.use_start, (n + 1) * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        if (is_live_instr(ir, i)) for_each_operand(ir, i, record_use, &uf);
+    }
+    for (int b = 0; b < ir->block_count; b++) {
+        if (ir->blocks[b].rpo >= 0 && ir->blocks[b].value >= 0) du.use_list[uf.fill[ir->blocks[b].value]++] = -(b + 1);
+    }
+    free(uf.fill);
+    return du;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Output                                                                  */
+/* ---------------------------------------------------------------------- */
+
+const char *opcode_name(Opcode op) {
+    switch (op) {
+        case IR_CONST: return "const";
+        case IR_STRING: return "string";
+        case IR_SYMBOL: return "symbol";
+        case IR_UNDEF: return "undef";
+        case IR_BINARY: return "binary";
+        case IR_CALL: return "call";
+        case IR_PHI: return "phi";
+        case IR_LOAD: return "load";
+        case IR_STORE: return "store";
+        default: return "?";
+    }
+}
+
+void print_instr(IR *ir, int id, FILE *out) {
+    Instr *in = &ir->instrs[id];
+    fprintf(out, "    v%d = %s", id, opcode_name(in->op));
+    switch (in->op) {
+        case IR_CONST: fprintf(out, " %d", in->imm); break;
+        case IR_STRING: fprintf(out, " \"%s\"", in->text); break;
+        case IR_SYMBOL: fprintf(out, " %s", in->text); break;
+        case IR_UNDEF: fprintf(out, " %s", ir->var_names[in->var]); break;
+        case IR_CALL:
+            fprintf(out, " %s(", in->text);
+            for (int k = 0; k < in->arg_count; k++) {
+                fprintf(out, "%sv%d", k ? ", " : "", ir->operands[in->arg_start + k]);
+            }
+            fprintf(out, ")");
+            break;
+        case IR_PHI: {
+            Block *blk = &ir->blocks[in->block];
+            for (int k = 0; k < in->arg_count; k++) {
+                fprintf(out, "%s [v%d, bb%d]", k ? "," : "", ir->operands[in->arg_start + k], blk->preds[k]);
+            }
+            fprintf(out, "    ; %s", ir->var_names[in->var]);
+            break;
+        }
+        case IR_BINARY: fprintf(out, " v%d %s v%d", in->a, operator_info(in->binop)->spelling, in->b); break;
+        default: break;
+    }
+    fprintf(out, "\n");
+}
+
+void print_ir(IR *ir, DefUse *du, FILE *out) {
+    for (int i = 0; i < ir->rpo_count; i++) {
+        int b = ir->rpo_order[i];
+        Block *blk = &ir->blocks[b];
+        fprintf(out, "bb%d:    ; preds", b);
+        for (int p = 0; p < blk->pred_count; p++) {
+            if (ir->blocks[blk->preds[p]].rpo >= 0) fprintf(out, " bb%d", blk->preds[p]);
+        }
+        if (b == 0) fprintf(out, ", idom -");
+        else fprintf(out, ", idom bb%d", blk->idom);
+        fprintf(out, ", frontier");
+        for (int f = 0; f < blk->frontier_count; f++) fprintf(out, " bb%d", blk->frontier[f]);
+        fprintf(out, "\n");
+        for (int p = 0; p < blk->phi_count; p++) print_instr(ir, blk->phis[p], out);
+        for (int k = 0; k < blk->count; k++) print_instr(ir, blk->instrs[k], out);
+        switch (blk->term) {
+            case TERM_BR: fprintf(out, "    br bb%d\n", blk->succ[0]); break;
+            case TERM_CBR: fprintf(out, "    cbr v%d, bb%d, bb%d\n", blk->value, blk->succ[0], blk->succ[1]); break;
+            case TERM_RET:
+                if (blk->value >= 0) fprintf(out, "    ret v%d\n", blk->value);
+                else fprintf(out, "    ret\n");
+                break;
+            default: fprintf(out, "    ret\n"); break;
+        }
+    }
+    fprintf(out, "\n; def-use chains\n");
+    for (int v = 0; v < ir->instr_count; v++) {
+        if (!is_live_instr(ir, v)) continue;
+        fprintf(out, "v%d (bb%d):", v, ir->instrs[v].block);
+        for (int u = du->use_start[v]; u < du->use_start[v + 1]; u++) {
+            int user = du->use_list[u];
+            if (user >= 0) fprintf(out, " v%d", user);
+            else fprintf(out, " bb%d.term", -user - 1);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+/* Does the value get its own C variable? Strings and symbols are inlined. */
+int is_int_value(IR *ir, int v) {
+    Opcode op = ir->instrs[v].op;
+    return op != IR_STRING && op != IR_SYMBOL;
+}
+
+void emit_operand(IR *ir, int v, FILE *out) {
+    Instr *in = &ir->instrs[v];
+    if (in->op == IR_STRING) fprintf(out, "\"%s\"", in->text);
+    else if (in->op == IR_SYMBOL) fprintf(out, "%s", in->text);
+    else fprintf(out, "v%d", v);
+}
+
+/* Out of SSA: every phi reads a private temporary that each predecessor
+   assigns just before branching, which keeps the copies parallel */
+void emit_phi_copies(IR *ir, int from, int to, FILE *out) {
+    Block *target = &ir->blocks[to];
+    int j = 0;
+    while (j < target->pred_count && target->preds[j] != from) j++;
+    for (int p = 0; p < target->phi_count; p++) {
+        Instr *phi = &ir->instrs[target->phis[p]];
+        int value = ir->operands[phi->arg_start + j];
+        fprintf(out, "    t%d = ", target->phis[p]);
+        emit_operand(ir, value, out);
+        fprintf(out, ";\n");
+    }
+}
+
+void emit_c(IR *ir, const char *function_name, FILE *out) {
+    int calls_write = 0;
+    for (int v = 0; v < ir->instr_count; v++) {
+        Instr *in = &ir->instrs[v];
+        if (in->op == IR_CALL && is_live_instr(ir, v) && strcmp(in->text, "write") == 0) calls_write = 1;
+    }
+    fprintf(out, "#include <stdio.h>\n");
+    if (calls_write) fprintf(out, "#include <unistd.h>\n");
+    fprintf(out, "\n");
+    fprintf(out, "int %s() {\n", function_name);
+    for (int v = 0; v < ir->instr_count; v++) {
+        if (!is_live_instr(ir, v) || !is_int_value(ir, v)) continue;
+        fprintf(out, "    int v%d;\n", v);
+        if (ir->instrs[v].op == IR_PHI) fprintf(out, "    int t%d;\n", v);
+    }
+    for (int i = 0; i < ir->rpo_count; i++) {
+        int b = ir->rpo_order[i];
+        Block *blk = &ir->blocks[b];
+        fprintf(out, "bb%d:\n", b);
+        for (int p = 0; p < blk->phi_count; p++) {
+            fprintf(out, "    v%d = t%d;\n", blk->phis[p], blk->phis[p]);
+        }
+        for (int k = 0; k < blk->count; k++) {
+            int v = blk->instrs[k];
+            Instr *in = &ir->instrs[v];
+            switch (in->op) {
+                case IR_CONST:
+                    fprintf(out, "    v%d = %d;\n", v, in->imm);
+                    break;
+                case IR_CALL:
+                    fprintf(out, "    v%d = %s(", v, in->text);
+                    for (int a = 0; a < in->arg_count; a++) {
+                        if (a) fprintf(out, ", ");
+                        emit_operand(ir, ir->operands[in->arg_start + a], out);
+                    }
+                    fprintf(out, ");\n");
+                    break;
+                case IR_BINARY:
+                    fprintf(out, "    v%d = ", v);
+                    emit_operand(ir, in->a, out);
+                    fprintf(out, " %s ", operator_info(in->binop)->spelling);
+                    emit_operand(ir, in->b, out);
+                    fprintf(out, ";\n");
+                    break;
+                default:
+                    break;
+            }
+        }
+        for (int s = 0; s < 2; s++) {
+            if (blk->succ[s] >= 0) emit_phi_copies(ir, b, blk->succ[s], out);
+        }
+        switch (blk->term) {
+            case TERM_BR:
+                fprintf(out, "    goto bb%d;\n", blk->succ[0]);
+                break;
+            case TERM_CBR:
+                fprintf(out, "    if (v%d) goto bb%d;\n", blk->value, blk->succ[0]);
+                fprintf(out, "    goto bb%d;\n", blk->succ[1]);
+                break;
+            case TERM_RET:
+                if (blk->value >= 0) fprintf(out, "    return v%d;\n", blk->value);
+                else fprintf(out, "    return 0;\n");
+                break;
+            default:
+                fprintf(out, "    return 0;\n");
+                break;
+        }
+    }
+    fprintf(out, "}\n");
+}
+
+void free_ir(IR *ir) {
+    for (int b = 0; b < ir->block_count; b++) {
+        free(ir->blocks[b].instrs);
+        free(ir->blocks[b].phis);
+        free(ir->blocks[b].preds);
+        free(ir->blocks[b].frontier);
+    }
+    for (int v = 0; v < ir->var_count; v++) free(ir->var_names[v]);
+    free(ir->var_names);
+    free(ir->blocks);
+    free(ir->instrs);
+    free(ir->operands);
+    free(ir->rpo_order);
+}
+
+int main() {
+    FILE *in = fopen("newOutput.txt", "r");
+    if (!in) {
+        perror("Failed to open input file newOutput.txt");
+        return 1;
+    }
+    ASTNode *root = parse_ast(in);
+    fclose(in);
+    if (!root || root->type != NODE_FUNCTION_DEF) {
+        fprintf(stderr, "Failed to parse AST\n");
+        free_ast(root);
+        return 1;
+    }
+
+    IR ir;
+    memset(&ir, 0, sizeof(ir));
+    Scope scope;
+    memset(&scope, 0, sizeof(scope));
+    ir.cur = new_block(&ir);
+    lower_stmt(&ir, &scope, root);
+    terminate(&ir, TERM_RET, -1, -1, -1);
+
+    compute_rpo(&ir);
+    compute_dominators(&ir);
+    compute_frontiers(&ir);
+    construct_ssa(&ir);
+    DefUse du = build_def_use(&ir);
+
+    FILE *out = fopen("ssaOutput.txt", "w");
+    if (!out) {
+        perror("Failed to open output file ssaOutput.txt");
+        return 1;
+    }
+    fprintf(out, "function %s\n", root->name);
+    print_ir(&ir, &du, out);
+    fclose(out);
+
+    out = fopen("ssaCode.c", "w");
+    if (!out) {
+        perror("Failed to open output file ssaCode.c");
+        return 1;
+    }
+    emit_c(&ir, root->name, out);
+    fclose(out);
+
+    printf("SSA IR saved to ssaOutput.txt, C code to ssaCode.c\n");
+    free(du.use_start);
+    free(du.use_list);
+    free(scope.names);
+    free(scope.vars);
+    free_ir(&ir);
+    free_ast(root);
+    return 0;
+}
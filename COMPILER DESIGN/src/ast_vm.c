@@ -0,0 +1,1102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ops.h"
+#include "cache.h"
+
+/*
+    Runs an AST dump on a register bytecode virtual machine and counts the
+    instructions it executes. With no file arguments both output.txt (as
+    parsed) and newOutput.txt (as optimized) are run, so the effect of
+    ast_optimize is measured deterministically instead of by timing a
+    compiled binary.
+
+    The function is compiled to three-address instructions over a flat
+    register file, one register per variable or temporary. Common
+    sequences are fused into superinstructions: arithmetic with an
+    immediate operand, compare-and-branch for conditions, and
+    increment-and-compare for the back edge of a counted loop. Loops are
+    inverted, so an iteration costs a single branch. With GCC or Clang the
+    interpreter dispatches by computed goto on handler addresses stored in
+    the instructions (direct threading), otherwise (or with -DVM_SWITCH)
+    through a switch.
+    printf, putchar, puts, fputs (to stdout), write (to descriptor 1) and
+    abs are built in.
+*/
+
+
+#define MAX_LINE_LEN 256
+
+typedef enum {
+    NODE_FUNCTION_DEF,
+    NODE_SEQUENCE,
+    NODE_DECLARATION,
+    NODE_ASSIGNMENT,
+    NODE_INT,
+    NODE_BINARY_EXPR,
+    NODE_VAR,
+    NODE_IF_STMT,
+    NODE_FUNCTION_CALL,
+    NODE_EXPR_LIST,
+    NODE_FOR_STMT,
+    NODE_UNARY_EXPR,
+    NODE_RETURN_STMT,
+    NODE_STRING,
+    NODE_REPEAT,
+    NODE_UNKNOWN
+} NodeType;
+
+typedef struct ASTNode {
+    NodeType type;
+    char *name;
+    int int_value;
+    char *string_value;
+    Operator op;
+    struct ASTNode **children;
+    int child_count;
+    int child_capacity;
+} ASTNode;
+
+/* Forward declarations */
+ASTNode *parse_ast(FILE *f);
+void free_ast(ASTNode *node);
+void append_child(ASTNode *parent, ASTNode *child);
+
+/* Helper function to skip spaces */
+void skip_spaces(const char **str) {
+    while (**str == ' ' || **str == '\t') (*str)++;
+}
+
+/* Helper to count the leading spaces */
+int count_leading_spaces(const char *line) {
+    int count = 0;
+    while (*line == ' ') {
+        count++;
+        line++;
+    }
+    return count;
+}
+
+/* Convert string to NodeType */
+NodeType node_type_from_string(const char *str) {
+    if (strcmp(str, "FUNCTION_DEF") == 0) return NODE_FUNCTION_DEF;
+    if (strcmp(str, "SEQUENCE") == 0) return NODE_SEQUENCE;
+    if (strcmp(str, "DECLARATION") == 0) return NODE_DECLARATION;
+    if (strcmp(str, "ASSIGNMENT") == 0) return NODE_ASSIGNMENT;
+    if (strcmp(str, "INT") == 0) return NODE_INT;
+    if (strcmp(str, "BINARY_EXPR") == 0) return NODE_BINARY_EXPR;
+    if (strcmp(str, "VAR") == 0) return NODE_VAR;
+    if (strcmp(str, "IF_STMT") == 0) return NODE_IF_STMT;
+    if (strcmp(str, "FUNCTION_CALL") == 0) return NODE_FUNCTION_CALL;
+    if (strcmp(str, "EXPR_LIST") == 0) return NODE_EXPR_LIST;
+    if (strcmp(str, "FOR_STMT") == 0) return NODE_FOR_STMT;
+    if (strcmp(str, "UNARY_EXPR") == 0) return NODE_UNARY_EXPR;
+    if (strcmp(str, "RETURN_STMT") == 0) return NODE_RETURN_STMT;
+    if (strcmp(str, "STRING") == 0) return NODE_STRING;
+    if (strcmp(str, "REPEAT") == 0) return NODE_REPEAT;
+    return NODE_UNKNOWN;
+}
+
+/* Parse a line in the AST text and (optionally) extract an argument */
+NodeType parse_line(const char *line, char **arg) {
+    *arg = NULL;
+    const char *p = line;
+
+    char type_buf[64];
+    int i = 0;
+    while (*p && *p != ' ' && *p != '(' && *p != '\n' && i < 63) {
+        type_buf[i++] = *p++;
+    }
+    type_buf[i] = 0;
+    NodeType t = node_type_from_string(type_buf);
+    if (t == NODE_UNKNOWN) return NODE_UNKNOWN;
+
+    skip_spaces(&p);
+    if (*p == '(') {
+        p++;
+        const char *start = p;
+        while (*p && *p != ')') p++;
+        if (*p != ')') return NODE_UNKNOWN;
+        int len = (int)(p - start);
+        *arg = malloc(len + 1);
+        strncpy(*arg, start, len);
+        (*arg)[len] = 0;
+    }
+    return t;
+}
+
+/* Remove the quote characters the AST printers wrap around string literals */
+void strip_outer_quotes(char *s) {
+    int len = (int)strlen(s);
+    int start = 0, end = len - 1;
+    while (start < len && s[start] == '"') start++;
+    while (end >= start && s[end] == '"') end--;
+    int new_len = end - start + 1;
+    memmove(s, s + start, new_len);
+    s[new_len] = 0;
+}
+
+/* Recursively parse the AST from a file */
+ASTNode *parse_ast_recursive(FILE *f, int current_indent) {
+    char line[MAX_LINE_LEN];
+    long last_pos = ftell(f);
+    if (!fgets(line, MAX_LINE_LEN, f)) return NULL;
+
+    int indent = count_leading_spaces(line);
+    if (indent < current_indent) {
+        fseek(f, last_pos, SEEK_SET);
+        return NULL;
+    }
+    if (indent > current_indent) {
+        fprintf(stderr, "Unexpected indentation\n");
+        return NULL;
+    }
+
+    char *arg = NULL;
+    char *trim_line = line + indent;
+    NodeType t = parse_line(trim_line, &arg);
+    if (t == NODE_UNKNOWN) {
+        fprintf(stderr, "Unknown node type in line: %s\n", trim_line);
+        if (arg) free(arg);
+        return NULL;
+    }
+
+    ASTNode *node = calloc(1, sizeof(ASTNode));
+    node->type = t;
+
+    if (arg) {
+        switch (t) {
+            case NODE_FUNCTION_DEF:
+            case NODE_DECLARATION:
+            case NODE_ASSIGNMENT:
+            case NODE_VAR:
+            case NODE_FUNCTION_CALL:
+            case NODE_REPEAT:
+                node->name = arg;
+                break;
+            case NODE_BINARY_EXPR:
+            case NODE_UNARY_EXPR:
+                node->op = operator_from_spelling(arg);
+                free(arg);
+                break;
+            case NODE_INT:
+                node->int_value = atoi(arg);
+                free(arg);
+                break;
+            case NODE_STRING:
+                node->string_value = arg;
+                strip_outer_quotes(node->string_value);
+                break;
+            default:
+                free(arg);
+                break;
+        }
+    }
+
+    while (1) {
+        long pos_before = ftell(f);
+        ASTNode *child = parse_ast_recursive(f, current_indent + 2);
+        if (!child) {
+            fseek(f, pos_before, SEEK_SET);
+            break;
+        }
+        append_child(node, child);
+    }
+
+    return node;
+}
+
+/* Wrapper to parse AST from file */
+ASTNode *parse_ast(FILE *f) {
+    return parse_ast_recursive(f, 0);
+}
+
+/* Append a child, growing the child array as needed */
+void append_child(ASTNode *parent, ASTNode *child) {
+    if (parent->child_count == parent->child_capacity) {
+        int cap = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        ASTNode **grown = realloc(parent->children, cap * sizeof(ASTNode *));
+        if (!grown) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        parent->children = grown;
+        parent->child_capacity = cap;
+    }
+    parent->children[parent->child_count++] = child;
+}
+
+/* Free the AST recursively */
+void free_ast(ASTNode *node) {
+    if (!node) return;
+    if (node->name) free(node->name);
+    if (node->string_value) free(node->string_value);
+    for (int i = 0; i < node->child_count; i++) {
+        free_ast(node->children[i]);
+    }
+    free(node->children);
+    free(node);
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Bytecode                                                                */
+/* ---------------------------------------------------------------------- */
+
+typedef intptr_t Value;         /* an int, or the address of a string */
+
+typedef enum {
+    VM_LOADI,       /* r[a] = b */
+    VM_LOADS,       /* r[a] = string b */
+    VM_MOV,         /* r[a] = r[b] */
+    VM_ADD,         /* r[a] = r[b] op r[c] */
+    VM_SUB,
+    VM_MUL,
+    VM_DIV,
+    VM_LT,
+    VM_ADDI,        /* r[a] = r[b] op c */
+    VM_SUBI,
+    VM_MULI,
+    VM_DIVI,
+    VM_LTI,
+    VM_JMP,         /* goto c */
+    VM_JZ,          /* if (r[a] == 0) goto c */
+    VM_JNZ,         /* if (r[a] != 0) goto c */
+    VM_JLT,         /* if (r[a] < r[b]) goto c */
+    VM_JGE,         /* if (r[a] >= r[b]) goto c */
+    VM_JLTI,        /* if (r[a] < b) goto c */
+    VM_JGEI,        /* if (r[a] >= b) goto c */
+    VM_INCJLT,      /* if (++r[a] < r[b]) goto c */
+    VM_INCJLTI,     /* if (++r[a] < b) goto c */
+    VM_CALL,        /* r[a] = builtin d(args b .. b + c - 1), a may be -1 */
+    VM_RET,         /* return r[a] */
+    VM_RETI,        /* return b */
+    VM_OPCODE_COUNT
+} Opcode;
+
+static const struct {
+    const char *name;
+    int fused;      /* superinstruction: stands for a sequence of simple ones */
+} opcode_info[VM_OPCODE_COUNT] = {
+    [VM_LOADI]   = { "loadi",   0 },
+    [VM_LOADS]   = { "loads",   0 },
+    [VM_MOV]     = { "mov",     0 },
+    [VM_ADD]     = { "add",     0 },
+    [VM_SUB]     = { "sub",     0 },
+    [VM_MUL]     = { "mul",     0 },
+    [VM_DIV]     = { "div",     0 },
+    [VM_LT]      = { "lt",      0 },
+    [VM_ADDI]    = { "addi",    1 },
+    [VM_SUBI]    = { "subi",    1 },
+    [VM_MULI]    = { "muli",    1 },
+    [VM_DIVI]    = { "divi",    1 },
+    [VM_LTI]     = { "lti",     1 },
+    [VM_JMP]     = { "jmp",     0 },
+    [VM_JZ]      = { "jz",      0 },
+    [VM_JNZ]     = { "jnz",     0 },
+    [VM_JLT]     = { "jlt",     1 },
+    [VM_JGE]     = { "jge",     1 },
+    [VM_JLTI]    = { "jlti",    1 },
+    [VM_JGEI]    = { "jgei",    1 },
+    [VM_INCJLT]  = { "incjlt",  1 },
+    [VM_INCJLTI] = { "incjlti", 1 },
+    [VM_CALL]    = { "call",    0 },
+    [VM_RET]     = { "ret",     0 },
+    [VM_RETI]    = { "reti",    0 },
+};
+
+typedef struct {
+    const void *handler;        /* code address of op, when threaded */
+    Opcode op;
+    int a, b, c, d;
+} Insn;
+
+typedef enum {
+    BUILTIN_PRINTF,
+    BUILTIN_PUTCHAR,
+    BUILTIN_PUTS,
+    BUILTIN_ABS,
+    BUILTIN_FPUTS,
+    BUILTIN_WRITE,
+    BUILTIN_COUNT
+} Builtin;
+
+static const char *builtin_names[BUILTIN_COUNT] = { "printf", "putchar", "puts", "abs", "fputs", "write" };
+
+/* Arguments a builtin takes; printf takes at least one */
+static const int builtin_arity[BUILTIN_COUNT] = { 1, 1, 1, 1, 2, 3 };
+
+/* Value of the global stdout, the only stream a program can name */
+#define VM_STDOUT 1
+
+typedef enum {
+    OPND_REG,       /* value: register */
+    OPND_IMM,       /* value: constant */
+    OPND_STR        /* value: string number */
+} OperandKind;
+
+typedef struct {
+    OperandKind kind;
+    int value;
+} Operand;
+
+typedef struct {
+    Insn *code;
+    int count, capacity;
+    Operand *args;              /* call arguments, sliced by VM_CALL */
+    int arg_count, arg_capacity;
+    int max_call_args;
+    char **strings;             /* decoded string literals */
+    int string_count, string_capacity;
+    int *labels;                /* label -> instruction index */
+    int label_count, label_capacity;
+    int reg_count;
+} Program;
+
+/* Grow a dense array so that it can hold at least needed elements */
+void *grow_array(void *data, int *capacity, int needed, size_t elem_size) {
+    if (needed <= *capacity) return data;
+    int cap = *capacity ? *capacity : 8;
+    while (cap < needed) cap *= 2;
+    data = realloc(data, cap * elem_size);
+    if (!data) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    *capacity = cap;
+    return data;
+}
+
+Operand make_operand(OperandKind kind, int value) {
+    Operand o = { kind, value };
+    return o;
+}
+
+int new_reg(Program *prog) {
+    return prog->reg_count++;
+}
+
+Insn *emit_insn(Program *prog, Opcode op, int a, int b, int c) {
+    prog->code = grow_array(prog->code, &prog->capacity, prog->count + 1, sizeof(Insn));
+    Insn *in = &prog->code[prog->count++];
+    in->handler = NULL;
+    in->op = op;
+    in->a = a;
+    in->b = b;
+    in->c = c;
+    in->d = 0;
+    return in;
+}
+
+int new_label(Program *prog) {
+    prog->labels = grow_array(prog->labels, &prog->label_capacity, prog->label_count + 1, sizeof(int));
+    prog->labels[prog->label_count] = -1;
+    return prog->label_count++;
+}
+
+void place_label(Program *prog, int label) {
+    prog->labels[label] = prog->count;
+}
+
+int is_jump(Opcode op) {
+    return op >= VM_JMP && op <= VM_INCJLTI;
+}
+
+/* Decode the C escapes of a string literal into the bytes it stands for */
+char *decode_string(const char *s) {
+    char *out = malloc(strlen(s) + 1);
+    char *p = out;
+    while (*s) {
+        int c = (unsigned char)*s++;
+        if (c == '\\' && *s) {
+            c = (unsigned char)*s++;
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'a': c = '\a'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                case 'x': {
+                    int value = 0;
+                    while ((*s >= '0' && *s <= '9') || (*s >= 'a' && *s <= 'f') || (*s >= 'A' && *s <= 'F')) {
+                        int digit = *s <= '9' ? *s - '0' : (*s | 0x20) - 'a' + 10;
+                        value = value * 16 + digit;
+                        s++;
+                    }
+                    c = value & 0xff;
+                    break;
+                }
+                default:
+                    if (c >= '0' && c <= '7') {
+                        int value = c - '0';
+                        for (int k = 0; k < 2 && *s >= '0' && *s <= '7'; k++) value = value * 8 + (*s++ - '0');
+                        c = value & 0xff;
+                    }
+                    break;
+            }
+        }
+        *p++ = (char)c;
+    }
+    *p = 0;
+    return out;
+}
+
+void free_program(Program *prog) {
+    for (int i = 0; i < prog->string_count; i++) free(prog->strings[i]);
+    free(prog->strings);
+    free(prog->code);
+    free(prog->args);
+    free(prog->labels);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Compiling AST -> bytecode                                               */
+/* ---------------------------------------------------------------------- */
+
+/* Lexical scope: source names bound to a register, or to a constant for
+   the induction variable of a REPEAT replica */
+typedef struct {
+    const char *name;
+    Operand value;
+} Binding;
+
+typedef struct {
+    Binding *bindings;
+    int count, capacity;
+} Scope;
+
+void scope_bind(Scope *s, const char *name, Operand value) {
+    s->bindings = grow_array(s->bindings, &s->capacity, s->count + 1, sizeof(Binding));
+    s->bindings[s->count].name = name;
+    s->bindings[s->count].value = value;
+    s->count++;
+}
+
+Binding *scope_lookup(Scope *s, const char *name) {
+    for (int i = s->count - 1; i >= 0; i--) {
+        if (strcmp(s->bindings[i].name, name) == 0) return &s->bindings[i];
+    }
+    return NULL;
+}
+
+/* The operand in a register, loading constants into a fresh one */
+int materialize(Program *prog, Operand o) {
+    if (o.kind == OPND_REG) return o.value;
+    int reg = new_reg(prog);
+    emit_insn(prog, o.kind == OPND_IMM ? VM_LOADI : VM_LOADS, reg, o.value, 0);
+    return reg;
+}
+
+/* Register of a variable that is about to be written: the VAR of a
+   ++/--, or the target of an ASSIGNMENT */
+int lvalue_reg(Scope *scope, ASTNode *var) {
+    Binding *b = var->type == NODE_VAR || var->type == NODE_ASSIGNMENT ? scope_lookup(scope, var->name) : NULL;
+    if (!b || b->value.kind != OPND_REG) {
+        fprintf(stderr, "Cannot assign to %s\n", var->name ? var->name : "expression");
+        exit(1);
+    }
+    return b->value.value;
+}
+
+Operand lower_binary(Program *prog, Operator op, Operand a, Operand b) {
+    const OperatorInfo *info = operator_info(op);
+    int folded;
+    Opcode base;
+    switch (op) {
+        case OP_ADD: base = VM_ADD; break;
+        case OP_SUB: base = VM_SUB; break;
+        case OP_MUL: base = VM_MUL; break;
+        case OP_DIV: base = VM_DIV; break;
+        case OP_LT:  base = VM_LT; break;
+        default:
+            fprintf(stderr, "Unsupported binary operator %s\n", info->spelling);
+            exit(1);
+    }
+    if (a.kind == OPND_IMM && b.kind == OPND_IMM && info->fold(a.value, b.value, &folded))
+        return make_operand(OPND_IMM, folded);
+    if (a.kind != OPND_REG && info->commutative) {
+        Operand t = a;
+        a = b;
+        b = t;
+    }
+    int dest = new_reg(prog);
+    int ra = materialize(prog, a);
+    if (b.kind == OPND_IMM) {
+        emit_insn(prog, base + (VM_ADDI - VM_ADD), dest, ra, b.value);
+    } else {
+        emit_insn(prog, base, dest, ra, materialize(prog, b));
+    }
+    return make_operand(OPND_REG, dest);
+}
+
+Operand lower_expr(Program *prog, Scope *scope, ASTNode *node, int want_result) {
+    switch (node->type) {
+        case NODE_INT:
+            return make_operand(OPND_IMM, node->int_value);
+        case NODE_STRING:
+            prog->strings = grow_array(prog->strings, &prog->string_capacity, prog->string_count + 1, sizeof(char *));
+            prog->strings[prog->string_count] = decode_string(node->string_value);
+            return make_operand(OPND_STR, prog->string_count++);
+        case NODE_VAR: {
+            Binding *b = scope_lookup(scope, node->name);
+            if (!b && strcmp(node->name, "stdout") == 0) return make_operand(OPND_IMM, VM_STDOUT);
+            if (!b) {
+                fprintf(stderr, "Unknown variable %s\n", node->name);
+                exit(1);
+            }
+            return b->value;
+        }
+        case NODE_BINARY_EXPR: {
+            if (node->child_count != 2) {
+                fprintf(stderr, "Malformed binary expression\n");
+                exit(1);
+            }
+            Operand a = lower_expr(prog, scope, node->children[0], 1);
+            Operand b = lower_expr(prog, scope, node->children[1], 1);
+            return lower_binary(prog, node->op, a, b);
+        }
+        case NODE_UNARY_EXPR: {
+            /* Postfix: yields the old value, then writes old +/- 1 */
+            int var = lvalue_reg(scope, node->children[0]);
+            Operand old = make_operand(OPND_REG, var);
+            if (want_result) {
+                old.value = new_reg(prog);
+                emit_insn(prog, VM_MOV, old.value, var, 0);
+            }
+            emit_insn(prog, node->op == OP_DEC ? VM_SUBI : VM_ADDI, var, var, 1);
+            return old;
+        }
+        case NODE_FUNCTION_CALL: {
+            int builtin = 0;
+            while (builtin < BUILTIN_COUNT && strcmp(builtin_names[builtin], node->name) != 0) builtin++;
+            if (builtin == BUILTIN_COUNT) {
+                fprintf(stderr, "Unsupported call to %s\n", node->name);
+                exit(1);
+            }
+            ASTNode *args = node->child_count == 1 ? node->children[0] : NULL;
+            int argc = args ? args->child_count : 0;
+            if (builtin == BUILTIN_PRINTF ? argc < 1 : argc != builtin_arity[builtin]) {
+                fprintf(stderr, "Wrong number of arguments to %s\n", node->name);
+                exit(1);
+            }
+            Operand *values = malloc(argc * sizeof(Operand));
+            for (int i = 0; i < argc; i++) {
+                values[i] = lower_expr(prog, scope, args->children[i], 1);
+            }
+            prog->args = grow_array(prog->args, &prog->arg_capacity, prog->arg_count + argc, sizeof(Operand));
+            memcpy(&prog->args[prog->arg_count], values, argc * sizeof(Operand));
+            free(values);
+            int dest = want_result ? new_reg(prog) : -1;
+            emit_insn(prog, VM_CALL, dest, prog->arg_count, argc)->d = builtin;
+            prog->arg_count += argc;
+            if (argc > prog->max_call_args) prog->max_call_args = argc;
+            return dest >= 0 ? make_operand(OPND_REG, dest) : make_operand(OPND_IMM, 0);
+        }
+        default:
+            fprintf(stderr, "Unsupported expression node %d\n", node->type);
+            exit(1);
+    }
+}
+
+/* Jump to label when the condition's truth equals jump_if. A comparison
+   becomes one compare-and-branch; constant conditions jump unconditionally
+   or not at all. */
+void lower_cond(Program *prog, Scope *scope, ASTNode *node, int jump_if, int label) {
+    if (node->type == NODE_BINARY_EXPR && node->op == OP_LT && node->child_count == 2) {
+        Operand a = lower_expr(prog, scope, node->children[0], 1);
+        Operand b = lower_expr(prog, scope, node->children[1], 1);
+        if (a.kind == OPND_IMM && b.kind == OPND_IMM) {
+            if ((a.value < b.value) == jump_if) emit_insn(prog, VM_JMP, 0, 0, label);
+            return;
+        }
+        int ra = materialize(prog, a);
+        if (b.kind == OPND_IMM) {
+            emit_insn(prog, jump_if ? VM_JLTI : VM_JGEI, ra, b.value, label);
+        } else {
+            emit_insn(prog, jump_if ? VM_JLT : VM_JGE, ra, materialize(prog, b), label);
+        }
+        return;
+    }
+    Operand value = lower_expr(prog, scope, node, 1);
+    if (value.kind != OPND_REG) {
+        /* A string literal is a non-null pointer */
+        int truth = value.kind == OPND_STR || value.value != 0;
+        if (truth == jump_if) emit_insn(prog, VM_JMP, 0, 0, label);
+        return;
+    }
+    emit_insn(prog, jump_if ? VM_JNZ : VM_JZ, value.value, 0, label);
+}
+
+/* The back edge of a loop counting with i++ while i < n, as one
+   increment-and-compare. Returns 0 when the loop does not have that shape. */
+int lower_counted_latch(Scope *scope, Program *prog, ASTNode *cond, ASTNode *update, int body) {
+    if (update->type != NODE_UNARY_EXPR || update->op != OP_INC || update->children[0]->type != NODE_VAR)
+        return 0;
+    if (cond->type != NODE_BINARY_EXPR || cond->op != OP_LT || cond->child_count != 2 ||
+        cond->children[0]->type != NODE_VAR || strcmp(cond->children[0]->name, update->children[0]->name) != 0)
+        return 0;
+    Binding *var = scope_lookup(scope, update->children[0]->name);
+    if (!var || var->value.kind != OPND_REG) return 0;
+    /* The bound is read after the increment, so it must not depend on it */
+    ASTNode *limit = cond->children[1];
+    if (limit->type == NODE_INT) {
+        emit_insn(prog, VM_INCJLTI, var->value.value, limit->int_value, body);
+        return 1;
+    }
+    if (limit->type != NODE_VAR) return 0;
+    Binding *bound = scope_lookup(scope, limit->name);
+    if (!bound || (bound->value.kind == OPND_REG && bound->value.value == var->value.value)) return 0;
+    if (bound->value.kind == OPND_IMM) {
+        emit_insn(prog, VM_INCJLTI, var->value.value, bound->value.value, body);
+    } else if (bound->value.kind == OPND_REG) {
+        emit_insn(prog, VM_INCJLT, var->value.value, bound->value.value, body);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void lower_stmt(Program *prog, Scope *scope, ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+        case NODE_FUNCTION_DEF:
+        case NODE_SEQUENCE:
+            for (int i = 0; i < node->child_count; i++) {
+                lower_stmt(prog, scope, node->children[i]);
+            }
+            break;
+        case NODE_DECLARATION: {
+            int first_new = prog->reg_count;
+            int var;
+            if (node->child_count == 1) {
+                Operand value = lower_expr(prog, scope, node->children[0], 1);
+                if (value.kind == OPND_REG && value.value >= first_new) {
+                    /* A fresh temporary has no other readers: it becomes the variable */
+                    var = value.value;
+                } else if (value.kind == OPND_REG) {
+                    var = new_reg(prog);
+                    emit_insn(prog, VM_MOV, var, value.value, 0);
+                } else {
+                    var = materialize(prog, value);
+                }
+            } else {
+                var = new_reg(prog);
+            }
+            scope_bind(scope, node->name, make_operand(OPND_REG, var));
+            break;
+        }
+        case NODE_ASSIGNMENT: {
+            Operand value = lower_expr(prog, scope, node->children[0], 1);
+            int var = lvalue_reg(scope, node);
+            if (value.kind == OPND_REG) {
+                emit_insn(prog, VM_MOV, var, value.value, 0);
+            } else {
+                emit_insn(prog, value.kind == OPND_IMM ? VM_LOADI : VM_LOADS, var, value.value, 0);
+            }
+            break;
+        }
+        case NODE_IF_STMT: {
+            int join = new_label(prog);
+            lower_cond(prog, scope, node->children[0], 0, join);
+            int mark = scope->count;
+            lower_stmt(prog, scope, node->children[1]);
+            scope->count = mark;
+            place_label(prog, join);
+            break;
+        }
+        case NODE_FOR_STMT: {
+            /* children: init, condition, update, body. The loop is
+               inverted: the condition is tested once on entry and again
+               at the bottom, where it branches back to the body. */
+            int mark = scope->count;
+            lower_stmt(prog, scope, node->children[0]);
+            int body = new_label(prog);
+            int exit_label = new_label(prog);
+            lower_cond(prog, scope, node->children[1], 0, exit_label);
+            place_label(prog, body);
+            int body_mark = scope->count;
+            lower_stmt(prog, scope, node->children[3]);
+            scope->count = body_mark;
+            if (!lower_counted_latch(scope, prog, node->children[1], node->children[2], body)) {
+                lower_expr(prog, scope, node->children[2], 0);
+                lower_cond(prog, scope, node->children[1], 1, body);
+            }
+            place_label(prog, exit_label);
+            scope->count = mark;
+            break;
+        }
+        case NODE_REPEAT: {
+            /* children: first value, count, body. The replicas are laid
+               out in straight line with the induction variable constant. */
+            int first = node->children[0]->int_value;
+            int count = node->children[1]->int_value;
+            for (int k = 0; k < count; k++) {
+                int mark = scope->count;
+                scope_bind(scope, node->name, make_operand(OPND_IMM, first + k));
+                lower_stmt(prog, scope, node->children[2]);
+                scope->count = mark;
+            }
+            break;
+        }
+        case NODE_RETURN_STMT: {
+            Operand value = node->child_count == 1 ? lower_expr(prog, scope, node->children[0], 1)
+                                                   : make_operand(OPND_IMM, 0);
+            if (value.kind == OPND_IMM) {
+                emit_insn(prog, VM_RETI, 0, value.value, 0);
+            } else {
+                emit_insn(prog, VM_RET, materialize(prog, value), 0, 0);
+            }
+            break;
+        }
+        default:
+            lower_expr(prog, scope, node, 0);
+            break;
+    }
+}
+
+void compile_function(Program *prog, ASTNode *root) {
+    Scope scope;
+    memset(&scope, 0, sizeof(scope));
+    lower_stmt(prog, &scope, root);
+    /* Falling off the end returns 0 */
+    emit_insn(prog, VM_RETI, 0, 0, 0);
+    for (int i = 0; i < prog->count; i++) {
+        if (is_jump(prog->code[i].op)) prog->code[i].c = prog->labels[prog->code[i].c];
+    }
+    free(scope.bindings);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Interpreter                                                             */
+/* ---------------------------------------------------------------------- */
+
+/* Build with -DVM_SWITCH to compare against switch dispatch */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(VM_SWITCH)
+#define VM_THREADED 1
+#endif
+
+typedef struct {
+    unsigned long executed[VM_OPCODE_COUNT];
+    unsigned long total, fused;
+    uint64_t output_hash;       /* of everything the program printed */
+    long output_bytes;
+    Value result;
+} RunStats;
+
+static int quiet = 0;
+
+void vm_write(RunStats *stats, const char *s, size_t n) {
+    stats->output_hash = cache_hash_bytes(stats->output_hash, s, n);
+    stats->output_bytes += (long)n;
+    if (!quiet) fwrite(s, 1, n, stdout);
+}
+
+/* Format one printf conversion, spec being "%[flags][width][.precision]c"
+   with any '*' taken from star */
+int format_conversion(char *buf, size_t size, const char *spec, int stars, const int *star, Value arg) {
+    char conv = spec[strlen(spec) - 1];
+#define FORMAT_WITH(value) \
+    (stars == 0 ? snprintf(buf, size, spec, value) : \
+     stars == 1 ? snprintf(buf, size, spec, star[0], value) : \
+                  snprintf(buf, size, spec, star[0], star[1], value))
+    switch (conv) {
+        case 'd': case 'i': case 'c':
+            return FORMAT_WITH((int)arg);
+        case 'o': case 'u': case 'x': case 'X':
+            return FORMAT_WITH((unsigned)arg);
+        case 's':
+            return FORMAT_WITH(arg ? (const char *)arg : "(null)");
+        case 'p':
+            return FORMAT_WITH((void *)arg);
+        default:
+            return -1;
+    }
+#undef FORMAT_WITH
+}
+
+/* printf over VM values: each conversion goes through snprintf with the
+   argument as the type it expects. Length modifiers are dropped, since
+   every value is an int or a string. */
+Value vm_printf(RunStats *stats, const Value *args, int argc) {
+    const char *fmt = (const char *)args[0];
+    int next = 1;
+    long written = 0;
+    if (!fmt) return -1;
+    while (*fmt) {
+        if (*fmt != '%' || fmt[1] == '%') {
+            const char *start = fmt;
+            if (*fmt == '%') {
+                fmt += 2;
+                start++;
+            } else {
+                while (*fmt && *fmt != '%') fmt++;
+            }
+            size_t n = *start == '%' ? 1 : (size_t)(fmt - start);
+            vm_write(stats, start, n);
+            written += (long)n;
+            continue;
+        }
+        const char *begin = fmt;
+        char spec[32];
+        int n = 0, stars = 0, star[2];
+        spec[n++] = *fmt++;
+        while (*fmt && strchr("-+ #0", *fmt) && n < 8) spec[n++] = *fmt++;
+        for (int part = 0; part < 2; part++) {
+            if (part == 1) {
+                if (*fmt != '.') break;
+                spec[n++] = *fmt++;
+            }
+            if (*fmt == '*') {
+                spec[n++] = *fmt++;
+                star[stars++] = next < argc ? (int)args[next++] : 0;
+            } else {
+                while (*fmt >= '0' && *fmt <= '9' && n < 24) spec[n++] = *fmt++;
+            }
+        }
+        while (*fmt && strchr("hlLqjzt", *fmt)) fmt++;
+        if (!*fmt) break;
+        spec[n++] = *fmt++;
+        spec[n] = 0;
+
+        char small[256];
+        Value arg = next < argc ? args[next] : 0;
+        int len = format_conversion(small, sizeof(small), spec, stars, star, arg);
+        if (len < 0) {
+            /* Not an int or string conversion: print it as written */
+            vm_write(stats, begin, (size_t)(fmt - begin));
+            written += (long)(fmt - begin);
+            continue;
+        }
+        next++;
+        if ((size_t)len < sizeof(small)) {
+            vm_write(stats, small, (size_t)len);
+        } else {
+            char *big = malloc((size_t)len + 1);
+            format_conversion(big, (size_t)len + 1, spec, stars, star, arg);
+            vm_write(stats, big, (size_t)len);
+            free(big);
+        }
+        written += len;
+    }
+    return (Value)written;
+}
+
+Value call_builtin(RunStats *stats, Builtin builtin, const Value *args, int argc) {
+    switch (builtin) {
+        case BUILTIN_PRINTF:
+            return vm_printf(stats, args, argc);
+        case BUILTIN_PUTCHAR: {
+            char c = (char)args[0];
+            vm_write(stats, &c, 1);
+            return (unsigned char)c;
+        }
+        case BUILTIN_PUTS: {
+            const char *s = args[0] ? (const char *)args[0] : "(null)";
+            vm_write(stats, s, strlen(s));
+            vm_write(stats, "\n", 1);
+            return 0;
+        }
+        case BUILTIN_FPUTS: {
+            const char *s = args[0] ? (const char *)args[0] : "(null)";
+            vm_write(stats, s, strlen(s));
+            return 0;
+        }
+        case BUILTIN_WRITE: {
+            /* Descriptor 1 only; the length never exceeds the literal */
+            const char *s = args[1] ? (const char *)args[1] : "";
+            size_t n = strlen(s);
+            if (args[0] != 1 || (int)args[2] < 0) return -1;
+            if ((size_t)(int)args[2] < n) n = (size_t)(int)args[2];
+            vm_write(stats, s, n);
+            return (Value)n;
+        }
+        case BUILTIN_ABS:
+            return (int)args[0] < 0 ? (Value)(int)(0u - (unsigned)args[0]) : args[0];
+        default:
+            return 0;
+    }
+}
+
+/* Wrapping int arithmetic, as ops.h folds it */
+#define VM_INT(x) ((Value)(int)(unsigned)(x))
+
+/* Run the program; returns 0, or -1 on a runtime error */
+int vm_run(Program *prog, RunStats *stats) {
+    Value *r = calloc(prog->reg_count ? prog->reg_count : 1, sizeof(Value));
+    Value *argv = malloc((prog->max_call_args ? prog->max_call_args : 1) * sizeof(Value));
+    unsigned long *executed = stats->executed;
+    Insn *code = prog->code;
+    Insn *pc = code;
+    int status = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->output_hash = CACHE_HASH_SEED;
+
+#ifdef VM_THREADED
+    static const void *handlers[VM_OPCODE_COUNT] = {
+        &&op_LOADI, &&op_LOADS, &&op_MOV,
+        &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_LT,
+        &&op_ADDI, &&op_SUBI, &&op_MULI, &&op_DIVI, &&op_LTI,
+        &&op_JMP, &&op_JZ, &&op_JNZ, &&op_JLT, &&op_JGE, &&op_JLTI, &&op_JGEI,
+        &&op_INCJLT, &&op_INCJLTI, &&op_CALL, &&op_RET, &&op_RETI
+    };
+    for (int i = 0; i < prog->count; i++) code[i].handler = handlers[code[i].op];
+#define CASE(name) op_##name:
+#define NEXT() do { executed[pc->op]++; goto *pc->handler; } while (0)
+    NEXT();
+#else
+#define CASE(name) case VM_##name:
+#define NEXT() continue
+    for (;;) {
+        executed[pc->op]++;
+        switch (pc->op) {
+#endif
+
+    CASE(LOADI) r[pc->a] = pc->b; pc++; NEXT();
+    CASE(LOADS) r[pc->a] = (Value)prog->strings[pc->b]; pc++; NEXT();
+    CASE(MOV) r[pc->a] = r[pc->b]; pc++; NEXT();
+    CASE(ADD) r[pc->a] = VM_INT((unsigned)r[pc->b] + (unsigned)r[pc->c]); pc++; NEXT();
+    CASE(SUB) r[pc->a] = VM_INT((unsigned)r[pc->b] - (unsigned)r[pc->c]); pc++; NEXT();
+    CASE(MUL) r[pc->a] = VM_INT((unsigned)r[pc->b] * (unsigned)r[pc->c]); pc++; NEXT();
+    CASE(DIV)
+        if (r[pc->c] == 0 || (r[pc->b] == INT32_MIN && r[pc->c] == -1)) goto division_error;
+        r[pc->a] = r[pc->b] / r[pc->c]; pc++; NEXT();
+    CASE(LT) r[pc->a] = r[pc->b] < r[pc->c]; pc++; NEXT();
+    CASE(ADDI) r[pc->a] = VM_INT((unsigned)r[pc->b] + (unsigned)pc->c); pc++; NEXT();
+    CASE(SUBI) r[pc->a] = VM_INT((unsigned)r[pc->b] - (unsigned)pc->c); pc++; NEXT();
+    CASE(MULI) r[pc->a] = VM_INT((unsigned)r[pc->b] * (unsigned)pc->c); pc++; NEXT();
+    CASE(DIVI)
+        if (pc->c == 0 || (r[pc->b] == INT32_MIN && pc->c == -1)) goto division_error;
+        r[pc->a] = r[pc->b] / pc->c; pc++; NEXT();
+    CASE(LTI) r[pc->a] = r[pc->b] < pc->c; pc++; NEXT();
+    CASE(JMP) pc = code + pc->c; NEXT();
+    CASE(JZ) pc = r[pc->a] == 0 ? code + pc->c : pc + 1; NEXT();
+    CASE(JNZ) pc = r[pc->a] != 0 ? code + pc->c : pc + 1; NEXT();
+    CASE(JLT) pc = r[pc->a] < r[pc->b] ? code + pc->c : pc + 1; NEXT();
+    CASE(JGE) pc = r[pc->a] >= r[pc->b] ? code + pc->c : pc + 1; NEXT();
+    CASE(JLTI) pc = r[pc->a] < pc->b ? code + pc->c : pc + 1; NEXT();
+    CASE(JGEI) pc = r[pc->a] >= pc->b ? code + pc->c : pc + 1; NEXT();
+    CASE(INCJLT)
+        r[pc->a] = VM_INT((unsigned)r[pc->a] + 1u);
+        pc = r[pc->a] < r[pc->b] ? code + pc->c : pc + 1; NEXT();
+    CASE(INCJLTI)
+        r[pc->a] = VM_INT((unsigned)r[pc->a] + 1u);
+        pc = r[pc->a] < pc->b ? code + pc->c : pc + 1; NEXT();
+    CASE(CALL) {
+        const Operand *args = &prog->args[pc->b];
+        for (int i = 0; i < pc->c; i++) {
+            argv[i] = args[i].kind == OPND_REG ? r[args[i].value]
+                    : args[i].kind == OPND_STR ? (Value)prog->strings[args[i].value]
+                    : args[i].value;
+        }
+        Value result = call_builtin(stats, (Builtin)pc->d, argv, pc->c);
+        if (pc->a >= 0) r[pc->a] = VM_INT(result);
+        pc++;
+        NEXT();
+    }
+    CASE(RET) stats->result = r[pc->a]; goto done;
+    CASE(RETI) stats->result = pc->b; goto done;
+
+#ifndef VM_THREADED
+        default:
+            goto done;
+        }
+    }
+#endif
+#undef CASE
+#undef NEXT
+
+division_error:
+    fprintf(stderr, "vm: division by zero or overflow at instruction %d\n", (int)(pc - code));
+    status = -1;
+done:
+    for (int op = 0; op < VM_OPCODE_COUNT; op++) {
+        stats->total += executed[op];
+        if (opcode_info[op].fused) stats->fused += executed[op];
+    }
+    free(r);
+    free(argv);
+    return status;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Driver                                                                  */
+/* ---------------------------------------------------------------------- */
+
+static int show_stats = 0;
+
+/* Compile and run one AST dump, then report on it; returns 0 on success */
+int run_file(const char *path, RunStats *stats) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "vm: cannot open %s\n", path);
+        return -1;
+    }
+    ASTNode *root = parse_ast(in);
+    fclose(in);
+    if (!root || root->type != NODE_FUNCTION_DEF) {
+        fprintf(stderr, "vm: failed to parse %s\n", path);
+        free_ast(root);
+        return -1;
+    }
+
+    Program prog;
+    memset(&prog, 0, sizeof(prog));
+    compile_function(&prog, root);
+    int status = vm_run(&prog, stats);
+    fflush(stdout);
+
+    fprintf(stderr, "vm: %s: returned %ld, %lu instructions executed (%lu fused), %d in program\n",
+            path, (long)stats->result, stats->total, stats->fused, prog.count);
+    if (show_stats) {
+        for (int op = 0; op < VM_OPCODE_COUNT; op++) {
+            if (stats->executed[op])
+                fprintf(stderr, "vm:   %-8s %10lu\n", opcode_info[op].name, stats->executed[op]);
+        }
+    }
+    free_program(&prog);
+    free_ast(root);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    const char *files[2];
+    int file_count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0)
+            quiet = 1;
+        else if (strcmp(argv[i], "--stats") == 0)
+            show_stats = 1;
+        else if (argv[i][0] != '-' && file_count < 2)
+            files[file_count++] = argv[i];
+        else {
+            fprintf(stderr, "Usage: %s [--quiet] [--stats] [BEFORE.txt [AFTER.txt]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (file_count == 0) {
+        files[file_count++] = "output.txt";
+        files[file_count++] = "newOutput.txt";
+    }
+
+    RunStats stats[2];
+    for (int i = 0; i < file_count; i++) {
+        if (run_file(files[i], &stats[i]) != 0) return 1;
+    }
+    if (file_count < 2) return 0;
+
+    /* Optimization must not change what the program does */
+    if (stats[0].result != stats[1].result || stats[0].output_hash != stats[1].output_hash ||
+        stats[0].output_bytes != stats[1].output_bytes) {
+        fprintf(stderr, "vm: %s and %s behave differently\n", files[0], files[1]);
+        return 1;
+    }
+    double change = stats[0].total ? 100.0 * ((double)stats[0].total - (double)stats[1].total) / (double)stats[0].total : 0.0;
+    fprintf(stderr, "vm: %s -> %s: %lu -> %lu instructions executed (%.1f%% %s)\n",
+            files[0], files[1], stats[0].total, stats[1].total,
+            change < 0 ? -change : change, change < 0 ? "more" : "fewer");
+    return 0;
+}
@@ -0,0 +1,530 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*
+    Differential benchmark of the pipeline: for every program of a corpus
+    (the .c files of test/ by default), runs ast, ast_optimize and ast_to_c on it in a
+    scratch directory, compiles input.c and optimizedCode.c with the
+    system compiler at several -O levels, and runs both binaries many
+    times pinned to one CPU. Their stdout and exit codes must match byte
+    for byte; the exit status is 1 if any pair differs.
+
+    Reported per test, level and variant: median and p95 wall time,
+    retired user-space instructions (via perf_event_open, when the kernel
+    allows it) and binary size, as bench.csv and bench.json plus a
+    summary on stdout.
+*/
+
+#define PATH_LEN 1024
+#define MAX_LEVELS 8
+
+typedef struct {
+    int status;                 /* exit code, or 128 + signal number */
+    double ms;
+    long long instructions;     /* -1 when not counted */
+} RunResult;
+
+typedef struct {
+    char test[256];
+    char level[8];
+    const char *variant;        /* "original" or "optimized" */
+    double median_ms, p95_ms;
+    long long instructions;     /* median, -1 when not counted */
+    long binary_bytes;
+    int exit_code;
+    int output_match;
+} Row;
+
+static int runs = 21;
+static int cpu = 0;
+static const char *cc = "gcc";
+static const char *levels[MAX_LEVELS] = { "-O0", "-O1", "-O2", "-O3" };
+static int level_count = 4;
+static int perf_available = 1;  /* cleared on the first failure */
+
+static Row *rows = NULL;
+static int row_count = 0, row_capacity = 0;
+
+double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Running processes                                                       */
+/* ---------------------------------------------------------------------- */
+
+#ifdef __linux__
+/* Counter of user-space instructions retired by pid, armed to start when
+   it calls exec; -1 when unavailable */
+int open_instruction_counter(pid_t pid) {
+    if (!perf_available) return -1;
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+    if (fd < 0) {
+        fprintf(stderr, "bench: perf_event_open: %s, instruction counts omitted\n", strerror(errno));
+        perf_available = 0;
+    }
+    return fd;
+}
+#endif
+
+/* Run argv in dir with stdin from /dev/null and stdout to stdout_path
+   (NULL discards it). With count, instructions are counted. Returns 0 when
+   the process could be started. */
+int run_process(char *const argv[], const char *dir, const char *stdout_path, int quiet,
+                int count, RunResult *result) {
+    int gate[2];
+    if (pipe(gate) != 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(gate[0]);
+        close(gate[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        char go;
+        close(gate[1]);
+        /* Wait until the parent has attached the counter */
+        if (read(gate[0], &go, 1) != 1) _exit(127);
+        close(gate[0]);
+#ifdef __linux__
+        if (cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+#endif
+        if (chdir(dir) != 0) _exit(127);
+        int in = open("/dev/null", O_RDONLY);
+        int out = stdout_path ? open(stdout_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : open("/dev/null", O_WRONLY);
+        if (in < 0 || out < 0) _exit(127);
+        dup2(in, 0);
+        dup2(out, 1);
+        if (quiet) dup2(open("/dev/null", O_WRONLY), 2);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    close(gate[0]);
+    int counter = -1;
+#ifdef __linux__
+    if (count) counter = open_instruction_counter(pid);
+#else
+    (void)count;
+#endif
+    double start = now_ms();
+    int written = (int)write(gate[1], "x", 1);
+    close(gate[1]);
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    result->ms = now_ms() - start;
+    result->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    result->instructions = -1;
+    if (counter >= 0) {
+        long long value;
+        if (read(counter, &value, sizeof(value)) == sizeof(value)) result->instructions = value;
+        close(counter);
+    }
+    return written == 1 ? 0 : -1;
+}
+
+/* Run a build step, reporting how it failed; returns 0 on success */
+int run_step(char *const argv[], const char *dir) {
+    RunResult r;
+    if (run_process(argv, dir, NULL, 0, 0, &r) != 0 || r.status != 0) {
+        fprintf(stderr, "bench: %s failed with status %d\n", argv[0], r.status);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Files                                                                   */
+/* ---------------------------------------------------------------------- */
+
+/* Whole file in a malloc'ed buffer, or NULL */
+char *read_file(const char *path, long *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    long capacity = 4096, n = 0;
+    char *data = malloc(capacity);
+    size_t got;
+    while ((got = fread(data + n, 1, capacity - n, f)) > 0) {
+        n += (long)got;
+        if (n == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    fclose(f);
+    *size = n;
+    return data;
+}
+
+int copy_file(const char *from, const char *to) {
+    long size;
+    char *data = read_file(from, &size);
+    if (!data) return -1;
+    FILE *f = fopen(to, "wb");
+    int ok = f && fwrite(data, 1, size, f) == (size_t)size;
+    if (f && fclose(f) != 0) ok = 0;
+    free(data);
+    return ok ? 0 : -1;
+}
+
+int same_contents(const char *a, const char *b) {
+    long size_a, size_b;
+    char *data_a = read_file(a, &size_a);
+    char *data_b = read_file(b, &size_b);
+    int same = data_a && data_b && size_a == size_b && memcmp(data_a, data_b, size_a) == 0;
+    free(data_a);
+    free(data_b);
+    return same;
+}
+
+long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+void remove_directory(const char *dir) {
+    DIR *d = opendir(dir);
+    char path[PATH_LEN];
+    struct dirent *de;
+    if (!d) return;
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        unlink(path);
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+int compare_string_ptr(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Measurement                                                             */
+/* ---------------------------------------------------------------------- */
+
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+int compare_long_long(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Nearest-rank percentile of sorted values */
+int percentile_index(int n, int percent) {
+    int rank = (n * percent + 99) / 100;
+    return rank > 0 ? rank - 1 : 0;
+}
+
+Row *add_row(void) {
+    if (row_count == row_capacity) {
+        row_capacity = row_capacity ? row_capacity * 2 : 32;
+        rows = realloc(rows, row_capacity * sizeof(Row));
+        if (!rows) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+    }
+    memset(&rows[row_count], 0, sizeof(Row));
+    return &rows[row_count++];
+}
+
+/* One warm-up run that records stdout in output_path, then the timed
+   runs. Returns 0 when the binary could be run. */
+int measure(const char *dir, const char *binary, const char *output_path, Row *row) {
+    char *argv[] = { (char *)binary, NULL };
+    RunResult r;
+    if (run_process(argv, dir, output_path, 1, 0, &r) != 0) return -1;
+    row->exit_code = r.status;
+
+    double *times = malloc(runs * sizeof(double));
+    long long *counts = malloc(runs * sizeof(long long));
+    int counted = 0;
+    for (int i = 0; i < runs; i++) {
+        if (run_process(argv, dir, NULL, 1, 1, &r) != 0) {
+            free(times);
+            free(counts);
+            return -1;
+        }
+        times[i] = r.ms;
+        if (r.instructions >= 0) counts[counted++] = r.instructions;
+    }
+    qsort(times, runs, sizeof(double), compare_double);
+    row->median_ms = runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+    row->p95_ms = times[percentile_index(runs, 95)];
+    row->instructions = -1;
+    if (counted == runs) {
+        qsort(counts, counted, sizeof(long long), compare_long_long);
+        row->instructions = counts[counted / 2];
+    }
+    row->binary_bytes = file_size(binary);
+    free(times);
+    free(counts);
+    return 0;
+}
+
+/* Run the pipeline on one program and benchmark both versions at every
+   level. Returns the number of mismatching pairs, or -1 when the program
+   could not be benchmarked. */
+int bench_program(const char *source, const char *tools) {
+    char dir[PATH_LEN / 2], path[PATH_LEN], tool[PATH_LEN];
+    const char *tmp = getenv("TMPDIR");
+    snprintf(dir, sizeof(dir), "%s/bench.XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(dir)) {
+        perror("bench: mkdtemp");
+        return -1;
+    }
+    const char *name = strrchr(source, '/') ? strrchr(source, '/') + 1 : source;
+    int mismatches = 0;
+
+    snprintf(path, sizeof(path), "%s/input.c", dir);
+    if (copy_file(source, path) != 0) {
+        fprintf(stderr, "bench: cannot read %s\n", source);
+        remove_directory(dir);
+        return -1;
+    }
+    static const char *pipeline[] = { "ast", "ast_optimize", "ast_to_c" };
+    for (int i = 0; i < 3; i++) {
+        snprintf(tool, sizeof(tool), "%s/%s", tools, pipeline[i]);
+        char *argv[] = { tool, NULL };
+        if (run_step(argv, dir) != 0) {
+            fprintf(stderr, "bench: %s: pipeline failed, skipped\n", name);
+            remove_directory(dir);
+            return -1;
+        }
+    }
+
+    for (int l = 0; l < level_count; l++) {
+        Row *pair[2];
+        char binary[2][PATH_LEN], output[2][PATH_LEN];
+        static const char *sources[2] = { "input.c", "optimizedCode.c" };
+        static const char *variants[2] = { "original", "optimized" };
+        int ok = 1;
+        for (int v = 0; v < 2 && ok; v++) {
+            snprintf(binary[v], PATH_LEN, "%s/%s%s", dir, variants[v], levels[l]);
+            snprintf(output[v], PATH_LEN, "%s/%s%s.out", dir, variants[v], levels[l]);
+            /* The sources may call printf without including stdio.h */
+            char *argv[] = { (char *)cc, (char *)levels[l], "-w", "-include", "stdio.h",
+                             "-o", binary[v], (char *)sources[v], NULL };
+            if (run_step(argv, dir) != 0) ok = 0;
+        }
+        for (int v = 0; v < 2 && ok; v++) {
+            pair[v] = add_row();
+            snprintf(pair[v]->test, sizeof(pair[v]->test), "%s", name);
+            snprintf(pair[v]->level, sizeof(pair[v]->level), "%s", levels[l]);
+            pair[v]->variant = variants[v];
+            if (measure(dir, binary[v], output[v], pair[v]) != 0) {
+                fprintf(stderr, "bench: %s: cannot run %s\n", name, binary[v]);
+                row_count -= v + 1;
+                ok = 0;
+            }
+        }
+        if (!ok) continue;
+
+        int match = pair[0]->exit_code == pair[1]->exit_code && same_contents(output[0], output[1]);
+        pair[0]->output_match = pair[1]->output_match = match;
+        if (!match) {
+            fprintf(stderr, "bench: %s %s: optimized program behaves differently\n", name, levels[l]);
+            mismatches++;
+        }
+    }
+    remove_directory(dir);
+    return mismatches;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Reports                                                                 */
+/* ---------------------------------------------------------------------- */
+
+void write_csv(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    fprintf(f, "test,level,variant,median_ms,p95_ms,instructions,binary_bytes,exit_code,output_match\n");
+    for (int i = 0; i < row_count; i++) {
+        Row *r = &rows[i];
+        fprintf(f, "%s,%s,%s,%.4f,%.4f,", r->test, r->level, r->variant, r->median_ms, r->p95_ms);
+        if (r->instructions >= 0) fprintf(f, "%lld", r->instructions);
+        fprintf(f, ",%ld,%d,%d\n", r->binary_bytes, r->exit_code, r->output_match);
+    }
+    fclose(f);
+}
+
+/* Test names are file names: only quotes and backslashes need escaping */
+void write_json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+void write_json(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    fprintf(f, "{\n  \"cc\": ");
+    write_json_string(f, cc);
+    fprintf(f, ",\n  \"runs\": %d,\n  \"cpu\": %d,\n  \"results\": [", runs, cpu);
+    for (int i = 0; i < row_count; i++) {
+        Row *r = &rows[i];
+        fprintf(f, "%s\n    {\"test\": ", i ? "," : "");
+        write_json_string(f, r->test);
+        fprintf(f, ", \"level\": \"%s\", \"variant\": \"%s\", \"median_ms\": %.4f, \"p95_ms\": %.4f, \"instructions\": ",
+                r->level, r->variant, r->median_ms, r->p95_ms);
+        if (r->instructions >= 0) fprintf(f, "%lld", r->instructions);
+        else fprintf(f, "null");
+        fprintf(f, ", \"binary_bytes\": %ld, \"exit_code\": %d, \"output_match\": %s}",
+                r->binary_bytes, r->exit_code, r->output_match ? "true" : "false");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+/* Rows come in original/optimized pairs */
+void print_summary(void) {
+    printf("%-16s %-4s %12s %12s %8s %14s %14s %s\n", "test", "opt", "orig ms", "optim ms", "speedup",
+           "orig insns", "optim insns", "output");
+    for (int i = 0; i + 1 < row_count; i += 2) {
+        Row *a = &rows[i], *b = &rows[i + 1];
+        printf("%-16s %-4s %12.3f %12.3f %7.2fx ", a->test, a->level, a->median_ms, b->median_ms,
+               b->median_ms > 0 ? a->median_ms / b->median_ms : 0.0);
+        if (a->instructions >= 0 && b->instructions >= 0)
+            printf("%14lld %14lld ", a->instructions, b->instructions);
+        else
+            printf("%14s %14s ", "-", "-");
+        printf("%s\n", a->output_match ? "same" : "DIFFERENT");
+    }
+}
+
+int parse_levels(char *list) {
+    level_count = 0;
+    for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        static char storage[MAX_LEVELS][8];
+        if (level_count == MAX_LEVELS || strlen(tok) > 4) return -1;
+        snprintf(storage[level_count], sizeof(storage[level_count]), "-O%s", tok);
+        levels[level_count] = storage[level_count];
+        level_count++;
+    }
+    return level_count > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *tools_dir = ".";
+    const char *corpus = "test";
+    const char *prefix = "bench";
+    char **files = NULL;
+    int file_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--runs=", 7) == 0 && atoi(argv[i] + 7) > 0)
+            runs = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--cpu=", 6) == 0)
+            cpu = atoi(argv[i] + 6);
+        else if (strncmp(argv[i], "--cc=", 5) == 0)
+            cc = argv[i] + 5;
+        else if (strncmp(argv[i], "--levels=", 9) == 0 && parse_levels(argv[i] + 9) == 0)
+            continue;
+        else if (strncmp(argv[i], "--tools=", 8) == 0)
+            tools_dir = argv[i] + 8;
+        else if (strncmp(argv[i], "--out=", 6) == 0)
+            prefix = argv[i] + 6;
+        else if (argv[i][0] != '-') {
+            files = realloc(files, (file_count + 1) * sizeof(char *));
+            files[file_count++] = strdup(argv[i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--runs=N] [--cpu=N] [--cc=CC] [--levels=0,1,2,3] "
+                            "[--tools=DIR] [--out=PREFIX] [FILE.c...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (file_count == 0) {
+        DIR *d = opendir(corpus);
+        struct dirent *de;
+        if (!d) {
+            fprintf(stderr, "bench: no files given and no %s directory\n", corpus);
+            return 1;
+        }
+        while ((de = readdir(d)) != NULL) {
+            size_t len = strlen(de->d_name);
+            if (len < 3 || strcmp(de->d_name + len - 2, ".c") != 0) continue;
+            char path[PATH_LEN];
+            snprintf(path, sizeof(path), "%s/%s", corpus, de->d_name);
+            files = realloc(files, (file_count + 1) * sizeof(char *));
+            files[file_count++] = strdup(path);
+        }
+        closedir(d);
+        qsort(files, file_count, sizeof(char *), compare_string_ptr);
+    }
+
+    /* The pipeline runs in scratch directories, so the tools need an
+       absolute path */
+    char tools[PATH_LEN];
+    if (!realpath(tools_dir, tools)) {
+        perror(tools_dir);
+        return 1;
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < file_count; i++) {
+        char source[PATH_LEN];
+        if (realpath(files[i], source)) {
+            int n = bench_program(source, tools);
+            if (n > 0) mismatches += n;
+        } else {
+            perror(files[i]);
+        }
+        free(files[i]);
+    }
+    free(files);
+
+    char path[PATH_LEN];
+    snprintf(path, sizeof(path), "%s.csv", prefix);
+    write_csv(path);
+    snprintf(path, sizeof(path), "%s.json", prefix);
+    write_json(path);
+    print_summary();
+    free(rows);
+    return mismatches ? 1 : 0;
+}
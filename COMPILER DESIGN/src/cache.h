@@ -0,0 +1,355 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* Persistent content-addressed cache shared by the pipeline tools. An
+   entry is the output file a tool produced for some input, stored under a
+   64-bit key that the tool derives from a Merkle hash of its input AST and
+   its configuration, so a later run on the same input copies the entry
+   instead of doing the work again.
+
+   The cache is a directory named by AST_CACHE_DIR (disabled when unset)
+   and holds at most AST_CACHE_LIMIT bytes (default 64 MiB), evicting the
+   least recently used entries. Entries are written to a temporary file
+   and renamed into place, so readers never see a partial entry; eviction
+   and the hit/miss counters are serialized by a lock file, so any number
+   of processes may share one directory.
+
+   A key only names the entry. The entry also stores the key material (the
+   tool's settings and input file) ahead of the output, and a lookup
+   compares it, so inputs whose keys collide never share an output. */
+
+#define CACHE_DEFAULT_LIMIT (64L * 1024 * 1024)
+#define CACHE_PATH_LEN 1024
+/* Room for the longest file name the cache creates: an entry name, which
+   cache_evict keeps below 64 characters, and its separator */
+#define CACHE_DIR_LEN (CACHE_PATH_LEN - 65)
+
+/* Bump when a change to any tool alters its output for the same input */
+#define CACHE_FORMAT_VERSION 8
+
+typedef struct {
+    int enabled;
+    char dir[CACHE_DIR_LEN];
+    long limit;
+} Cache;
+
+/* FNV-1a, 64-bit: building blocks for the tools' Merkle hashes */
+static inline uint64_t cache_hash_bytes(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static inline uint64_t cache_hash_int(uint64_t h, long value) {
+    return cache_hash_bytes(h, &value, sizeof(value));
+}
+
+/* Strings hash with their terminator so "ab","c" differs from "a","bc";
+   NULL hashes differently from "" */
+static inline uint64_t cache_hash_string(uint64_t h, const char *s) {
+    if (!s) return cache_hash_int(h, -1);
+    return cache_hash_bytes(h, s, strlen(s) + 1);
+}
+
+/* A string literal hashes without its surrounding quotes, which some tools
+   keep when they load a dump and others strip */
+static inline uint64_t cache_hash_literal(uint64_t h, const char *s) {
+    if (!s) return cache_hash_int(h, -1);
+    size_t len = strlen(s);
+    while (len > 0 && *s == '"') {
+        s++;
+        len--;
+    }
+    while (len > 0 && s[len - 1] == '"') len--;
+    h = cache_hash_bytes(h, s, len);
+    return cache_hash_bytes(h, "", 1);
+}
+
+#define CACHE_HASH_SEED 14695981039346656037ULL
+
+/* What a key was derived from */
+typedef struct {
+    char *bytes;
+    size_t length;
+} CacheMaterial;
+
+/* Key material of a tool run: its settings, then the contents of its input
+   file. Left empty, which no entry matches, if the file cannot be read. */
+static inline void cache_material(CacheMaterial *material, const char *settings, const char *input) {
+    size_t prefix = strlen(settings) + 1;
+    material->bytes = NULL;
+    material->length = 0;
+    FILE *f = fopen(input, "rb");
+    if (!f) return;
+    size_t capacity = prefix + 4096, length = prefix;
+    char *bytes = malloc(capacity);
+    size_t n;
+    if (!bytes) {
+        fclose(f);
+        return;
+    }
+    memcpy(bytes, settings, prefix);
+    while ((n = fread(bytes + length, 1, capacity - length, f)) > 0) {
+        length += n;
+        if (length < capacity) continue;
+        char *grown = realloc(bytes, capacity * 2);
+        if (!grown) {
+            length = 0;
+            break;
+        }
+        bytes = grown;
+        capacity *= 2;
+    }
+    if (ferror(f) || length == 0) {
+        free(bytes);
+    } else {
+        material->bytes = bytes;
+        material->length = length;
+    }
+    fclose(f);
+}
+
+static inline void cache_material_free(CacheMaterial *material) {
+    free(material->bytes);
+    material->bytes = NULL;
+    material->length = 0;
+}
+
+#ifdef _WIN32
+
+/* No flock or atomic rename over an existing file: the cache is off */
+static inline int cache_open(Cache *cache) { cache->enabled = 0; return 0; }
+static inline int cache_fetch(Cache *cache, uint64_t key, const CacheMaterial *material, const char *dest) {
+    (void)cache; (void)key; (void)material; (void)dest; return 0;
+}
+static inline void cache_store(Cache *cache, uint64_t key, const CacheMaterial *material, const char *src) {
+    (void)cache; (void)key; (void)material; (void)src;
+}
+static inline int cache_read_stats(Cache *cache, long *hits, long *misses) {
+    (void)cache; *hits = *misses = 0; return 0;
+}
+
+#else
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+/* Set up the cache from the environment; returns whether it is enabled */
+static inline int cache_open(Cache *cache) {
+    const char *dir = getenv("AST_CACHE_DIR");
+    const char *limit = getenv("AST_CACHE_LIMIT");
+    cache->enabled = 0;
+    if (!dir || !*dir || strlen(dir) >= CACHE_DIR_LEN) return 0;
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "cache: cannot create %s, caching disabled\n", dir);
+        return 0;
+    }
+    strcpy(cache->dir, dir);
+    cache->limit = limit ? atol(limit) : CACHE_DEFAULT_LIMIT;
+    if (cache->limit <= 0) cache->limit = CACHE_DEFAULT_LIMIT;
+    cache->enabled = 1;
+    return 1;
+}
+
+static inline void cache_entry_path(Cache *cache, uint64_t key, char *path) {
+    snprintf(path, CACHE_PATH_LEN, "%s/%016llx.entry", cache->dir, (unsigned long long)key);
+}
+
+/* Exclusive lock over the whole directory; returns the fd to unlock, or -1 */
+static inline int cache_lock(Cache *cache) {
+    char path[CACHE_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/lock", cache->dir);
+    int fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) return -1;
+    if (flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static inline void cache_unlock(int fd) {
+    if (fd < 0) return;
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+/* Copy one open file to another; returns 0 on a short read or write */
+static inline int cache_copy_stream(FILE *from, FILE *to) {
+    char buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), from)) > 0) {
+        if (fwrite(buf, 1, n, to) != n) return 0;
+    }
+    return !ferror(from);
+}
+
+/* Read an entry's header and check that it was stored for material. On a
+   match the stream is left at the start of the output. */
+static inline int cache_match_material(FILE *in, const CacheMaterial *material) {
+    char buf[8192];
+    size_t length, done = 0;
+    if (material->length == 0) return 0;
+    if (fscanf(in, "%zu", &length) != 1 || fgetc(in) != '\n') return 0;
+    if (length != material->length) return 0;
+    while (done < length) {
+        size_t want = length - done < sizeof(buf) ? length - done : sizeof(buf);
+        if (fread(buf, 1, want, in) != want) return 0;
+        if (memcmp(buf, material->bytes + done, want) != 0) return 0;
+        done += want;
+    }
+    return 1;
+}
+
+/* Add one hit or miss to the counters kept in the directory */
+static inline void cache_count(Cache *cache, int hit) {
+    char path[CACHE_PATH_LEN];
+    long hits = 0, misses = 0;
+    int lock = cache_lock(cache);
+    if (lock < 0) return;
+    snprintf(path, sizeof(path), "%s/stats", cache->dir);
+    FILE *f = fopen(path, "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &hits, &misses) != 2) hits = misses = 0;
+        fclose(f);
+    }
+    if (hit) hits++; else misses++;
+    f = fopen(path, "w");
+    if (f) {
+        fprintf(f, "%ld %ld\n", hits, misses);
+        fclose(f);
+    }
+    cache_unlock(lock);
+}
+
+static inline int cache_read_stats(Cache *cache, long *hits, long *misses) {
+    char path[CACHE_PATH_LEN];
+    *hits = *misses = 0;
+    if (!cache->enabled) return 0;
+    snprintf(path, sizeof(path), "%s/stats", cache->dir);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int ok = fscanf(f, "%ld %ld", hits, misses) == 2;
+    fclose(f);
+    return ok;
+}
+
+/* Copy the entry for key to dest if it was stored for material. Returns 1
+   on a hit, which also marks the entry as recently used. */
+static inline int cache_fetch(Cache *cache, uint64_t key, const CacheMaterial *material, const char *dest) {
+    char path[CACHE_PATH_LEN];
+    if (!cache->enabled) return 0;
+    cache_entry_path(cache, key, path);
+    FILE *in = fopen(path, "rb");
+    int hit = 0;
+    if (in && cache_match_material(in, material)) {
+        FILE *out = fopen(dest, "wb");
+        if (out) {
+            hit = cache_copy_stream(in, out);
+            if (fclose(out) != 0) hit = 0;
+        }
+        if (hit) utime(path, NULL);
+    }
+    if (in) fclose(in);
+    cache_count(cache, hit);
+    return hit;
+}
+
+typedef struct {
+    char name[64];
+    time_t used;
+    off_t size;
+} CacheEntryInfo;
+
+static inline int cache_compare_used(const void *a, const void *b) {
+    const CacheEntryInfo *x = a, *y = b;
+    if (x->used != y->used) return x->used < y->used ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+/* Delete least recently used entries until the directory fits the limit.
+   Called with the lock held. */
+static inline void cache_evict(Cache *cache) {
+    DIR *dir = opendir(cache->dir);
+    if (!dir) return;
+    CacheEntryInfo *entries = NULL;
+    int count = 0, capacity = 0;
+    long total = 0;
+    struct dirent *de;
+    char path[CACHE_PATH_LEN];
+    while ((de = readdir(dir)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (len < 6 || len >= sizeof(entries->name) || strcmp(de->d_name + len - 6, ".entry") != 0)
+            continue;
+        struct stat st;
+        if (fstatat(dirfd(dir), de->d_name, &st, 0) != 0) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            CacheEntryInfo *grown = realloc(entries, capacity * sizeof(CacheEntryInfo));
+            if (!grown) break;
+            entries = grown;
+        }
+        strcpy(entries[count].name, de->d_name);
+        entries[count].used = st.st_mtime;
+        entries[count].size = st.st_size;
+        total += st.st_size;
+        count++;
+    }
+    closedir(dir);
+    if (total > cache->limit) {
+        qsort(entries, count, sizeof(CacheEntryInfo), cache_compare_used);
+        for (int i = 0; i < count && total > cache->limit; i++) {
+            snprintf(path, sizeof(path), "%s/%s", cache->dir, entries[i].name);
+            if (unlink(path) == 0) total -= entries[i].size;
+        }
+    }
+    free(entries);
+}
+
+/* Store the file src as the entry for key, headed by the material the key
+   was derived from */
+static inline void cache_store(Cache *cache, uint64_t key, const CacheMaterial *material, const char *src) {
+    char tmp[CACHE_PATH_LEN], path[CACHE_PATH_LEN];
+    if (!cache->enabled || material->length == 0) return;
+    FILE *in = fopen(src, "rb");
+    if (!in) return;
+    snprintf(tmp, sizeof(tmp), "%s/tmp.XXXXXX", cache->dir);
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        fclose(in);
+        return;
+    }
+    fchmod(fd, 0644);
+    FILE *out = fdopen(fd, "wb");
+    int ok = out && fprintf(out, "%zu\n", material->length) > 0 &&
+             fwrite(material->bytes, 1, material->length, out) == material->length &&
+             cache_copy_stream(in, out);
+    if (out && fclose(out) != 0) ok = 0;
+    if (!out) close(fd);
+    fclose(in);
+    cache_entry_path(cache, key, path);
+    int lock = cache_lock(cache);
+    if (ok && rename(tmp, path) == 0) {
+        cache_evict(cache);
+    } else {
+        unlink(tmp);
+    }
+    cache_unlock(lock);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef EMIT_H
+#define EMIT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#define EMIT_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC | O_BINARY)
+#define emit_sys_open _open
+#define emit_sys_write _write
+#define emit_sys_close _close
+#else
+#include <unistd.h>
+#define EMIT_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC)
+#define emit_sys_open open
+#define emit_sys_write write
+#define emit_sys_close close
+#endif
+
+/* Buffered output writer shared by the tools that print ASTs and code.
+   Text is appended to a growable buffer with plain memcpy and a hand
+   rolled integer formatter, and handed to the OS in write calls of up to
+   EMIT_FLUSH_SIZE bytes, instead of one stdio call (format parsing and
+   locking included) per token. */
+
+#define EMIT_FLUSH_SIZE (64 * 1024)
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+    int fd;
+    int error;      /* set once any write has failed */
+} Emitter;
+
+/* Indentation is copied from here instead of written a space at a time */
+static const char emit_spaces[] =
+    "                                                                "
+    "                                                                ";
+
+/* Open path for writing, truncating it. Returns 0 on success. */
+static inline int emit_open(Emitter *e, const char *path) {
+    memset(e, 0, sizeof(*e));
+    e->fd = emit_sys_open(path, EMIT_OPEN_FLAGS, 0666);
+    return e->fd < 0 ? -1 : 0;
+}
+
+static inline void emit_flush(Emitter *e) {
+    size_t done = 0;
+    while (done < e->len && !e->error) {
+        long n = (long)emit_sys_write(e->fd, e->buf + done, (unsigned)(e->len - done));
+        if (n <= 0) e->error = 1;
+        else done += (size_t)n;
+    }
+    e->len = 0;
+}
+
+/* Make room for n more bytes, writing out what is buffered when full */
+static inline char *emit_reserve(Emitter *e, size_t n) {
+    if (e->len + n > e->cap) {
+        emit_flush(e);
+        if (n > e->cap) {
+            size_t cap = e->cap ? e->cap : EMIT_FLUSH_SIZE;
+            while (cap < n) cap *= 2;
+            char *grown = realloc(e->buf, cap);
+            if (!grown) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            e->buf = grown;
+            e->cap = cap;
+        }
+    }
+    return e->buf + e->len;
+}
+
+static inline void emit_bytes(Emitter *e, const char *s, size_t n) {
+    memcpy(emit_reserve(e, n), s, n);
+    e->len += n;
+}
+
+static inline void emit_str(Emitter *e, const char *s) {
+    emit_bytes(e, s, strlen(s));
+}
+
+static inline void emit_char(Emitter *e, char c) {
+    *emit_reserve(e, 1) = c;
+    e->len++;
+}
+
+static inline void emit_int(Emitter *e, long value) {
+    char digits[24];
+    int n = 0;
+    /* Work on the magnitude as unsigned so LONG_MIN is formatted too */
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    char *p = emit_reserve(e, n + 1);
+    if (value < 0) *p++ = '-';
+    while (n > 0) *p++ = digits[--n];
+    e->len = p - e->buf;
+}
+
+static inline void emit_indent(Emitter *e, int count) {
+    while (count > 0) {
+        int n = count < (int)sizeof(emit_spaces) - 1 ? count : (int)sizeof(emit_spaces) - 1;
+        emit_bytes(e, emit_spaces, n);
+        count -= n;
+    }
+}
+
+/* Flush and close; returns 0 when everything was written */
+static inline int emit_close(Emitter *e) {
+    emit_flush(e);
+    if (emit_sys_close(e->fd) != 0) e->error = 1;
+    free(e->buf);
+    e->buf = NULL;
+    e->cap = 0;
+    return e->error ? -1 : 0;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#!/bin/sh
+# Run the sample inputs through the optimizer and the back ends built with
+# AddressSanitizer, and fail if any run leaks memory or reports an error.
+#
+#   ./leak_check.sh [input.c test/*.c ...]
+#
+# The parser (ast) is built without sanitizers: it only produces the dumps
+# the checked tools read. Everything happens in a scratch directory.
+
+SRC=$(cd "$(dirname "$0")" && pwd)
+CC=${CC:-gcc}
+CFLAGS="-g -fsanitize=address,undefined -fno-omit-frame-pointer"
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+if [ $# -eq 0 ]; then
+    set -- "$SRC/input.c" "$SRC"/test/*.c
+fi
+
+$CC -w -o "$WORK/ast" "$SRC/parser.tab.c" "$SRC/lex.yy.c" "$SRC/ast.c" "$SRC/main.c" || exit 1
+$CC $CFLAGS -o "$WORK/ast_optimize" "$SRC/ast_optimize.c" -pthread || exit 1
+for tool in ast_to_c ast_to_ssa ast_to_asm ast_vm; do
+    $CC $CFLAGS -o "$WORK/$tool" "$SRC/$tool.c" || exit 1
+done
+
+export ASAN_OPTIONS=detect_leaks=1
+export UBSAN_OPTIONS=halt_on_error=1:print_stacktrace=1
+unset AST_CACHE_DIR
+failed=0
+for input in "$@"; do
+    name=$(basename "$input")
+    mkdir "$WORK/run" && cp "$input" "$WORK/run/input.c" || exit 1
+    cd "$WORK/run" || exit 1
+    if ! "$WORK/ast" > /dev/null 2>&1 || [ ! -s output.txt ]; then
+        echo "skip $name: does not parse"
+        cd "$WORK" && rm -rf "$WORK/run"
+        continue
+    fi
+    for run in "ast_optimize --evaluate" "ast_optimize --jobs=4" "ast_optimize" \
+               "ast_to_c" "ast_to_ssa" "ast_to_asm" "ast_vm"; do
+        "$WORK"/$run > /dev/null 2> sanitizer.log
+        if grep -q "Sanitizer\|runtime error" sanitizer.log; then
+            echo "FAIL $name: $run"
+            grep "SUMMARY\|runtime error" sanitizer.log
+            failed=1
+        fi
+    done
+    cd "$WORK" && rm -rf "$WORK/run"
+done
+
+if [ $failed -ne 0 ]; then
+    exit 1
+fi
+echo "no leaks"
@@ -14,18 +14,21 @@ int main() {
     }
 
    
-    FILE* out = fopen("output.txt", "w");
-    if (!out) {
+    Emitter out;
+    if (emit_open(&out, "output.txt") != 0) {
         perror("output.txt");
         return 1;
     }
 
     yyparse();
 
-    print_ast(ast_root, out, 0);
+    print_ast(ast_root, &out, 0);
 
     fclose(yyin);
-    fclose(out);
+    if (emit_close(&out) != 0) {
+        perror("output.txt");
+        return 1;
+    }
 
     printf("AST saved to output.txt\n");
     return 0;
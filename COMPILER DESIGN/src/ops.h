@@ -0,0 +1,72 @@
+#ifndef OPS_H
+#define OPS_H
+
+#include <limits.h>
+#include <string.h>
+
+/* Operators of the source language. The parser builds nodes from these,
+   the AST dump spells them as in C, and every tool that reads the dump
+   maps the spelling back once and then dispatches on the enum. */
+typedef enum {
+    OP_NONE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_LT,
+    OP_INC,     /* postfix ++ */
+    OP_DEC,     /* postfix -- */
+    OP_COUNT
+} Operator;
+
+typedef struct {
+    const char *spelling;
+    int arity;          /* 2 for binary, 1 for postfix unary */
+    int precedence;     /* higher binds tighter, as in C */
+    int left_assoc;
+    int commutative;
+    int pure;           /* 0 when evaluating may write the operand */
+    /* Fold constant operands (b is ignored by unary operators). Returns 0
+       when the result is not a well-defined int. */
+    int (*fold)(int a, int b, int *result);
+} OperatorInfo;
+
+/* Arithmetic wraps like the two's complement hardware instead of relying
+   on signed overflow, which C leaves undefined */
+static int fold_add(int a, int b, int *result) { *result = (int)((unsigned)a + (unsigned)b); return 1; }
+static int fold_sub(int a, int b, int *result) { *result = (int)((unsigned)a - (unsigned)b); return 1; }
+static int fold_mul(int a, int b, int *result) { *result = (int)((unsigned)a * (unsigned)b); return 1; }
+static int fold_lt(int a, int b, int *result) { *result = a < b; return 1; }
+static int fold_inc(int a, int b, int *result) { (void)b; *result = (int)((unsigned)a + 1u); return 1; }
+static int fold_dec(int a, int b, int *result) { (void)b; *result = (int)((unsigned)a - 1u); return 1; }
+
+static int fold_div(int a, int b, int *result) {
+    if (b == 0 || (a == INT_MIN && b == -1)) return 0;
+    *result = a / b;
+    return 1;
+}
+
+static const OperatorInfo operator_table[OP_COUNT] = {
+    [OP_NONE] = { "",   0, 0,  0, 0, 0, NULL },
+    [OP_ADD]  = { "+",  2, 12, 1, 1, 1, fold_add },
+    [OP_SUB]  = { "-",  2, 12, 1, 0, 1, fold_sub },
+    [OP_MUL]  = { "*",  2, 13, 1, 1, 1, fold_mul },
+    [OP_DIV]  = { "/",  2, 13, 1, 0, 1, fold_div },
+    [OP_LT]   = { "<",  2, 10, 1, 0, 1, fold_lt },
+    [OP_INC]  = { "++", 1, 16, 1, 0, 0, fold_inc },
+    [OP_DEC]  = { "--", 1, 16, 1, 0, 0, fold_dec },
+};
+
+static inline const OperatorInfo *operator_info(Operator op) {
+    return &operator_table[op < OP_COUNT ? op : OP_NONE];
+}
+
+/* Operator spelled by s, or OP_NONE */
+static inline Operator operator_from_spelling(const char *s) {
+    for (int op = OP_NONE + 1; op < OP_COUNT; op++) {
+        if (strcmp(operator_table[op].spelling, s) == 0) return (Operator)op;
+    }
+    return OP_NONE;
+}
+
+#endif
@@ -137,12 +137,13 @@ enum yysymbol_kind_t
   YYSYMBOL_compound_stmt = 29,             /* compound_stmt  */
   YYSYMBOL_stmt = 30,                      /* stmt  */
   YYSYMBOL_decl_stmt = 31,                 /* decl_stmt  */
-  YYSYMBOL_if_stmt = 32,                   /* if_stmt  */
-  YYSYMBOL_for_init = 33,                  /* for_init  */
-  YYSYMBOL_for_stmt = 34,                  /* for_stmt  */
-  YYSYMBOL_return_stmt = 35,               /* return_stmt  */
-  YYSYMBOL_expr = 36,                      /* expr  */
-  YYSYMBOL_expr_list = 37                  /* expr_list  */
+  YYSYMBOL_assign_stmt = 32,               /* assign_stmt  */
+  YYSYMBOL_if_stmt = 33,                   /* if_stmt  */
+  YYSYMBOL_for_init = 34,                  /* for_init  */
+  YYSYMBOL_for_stmt = 35,                  /* for_stmt  */
+  YYSYMBOL_return_stmt = 36,               /* return_stmt  */
+  YYSYMBOL_expr = 37,                      /* expr  */
+  YYSYMBOL_expr_list = 38                  /* expr_list  */
 };
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
@@ -470,16 +471,16 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  5
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   109
+#define YYLAST   120
 
 /* YYNTOKENS -- Number of terminals.  */
 #define YYNTOKENS  24
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  14
+#define YYNNTS  15
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  35
+#define YYNRULES  37
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  71
+#define YYNSTATES  76
 
 /* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   278
@@ -531,9 +532,9 @@ static const yytype_int8 yytranslate[] =
 static const yytype_int8 yyrline[] =
 {
        0,    42,    42,    46,    51,    55,    56,    60,    64,    65,
-      66,    67,    68,    72,    74,    78,    83,    84,    85,    86,
-      90,    95,    99,   100,   101,   102,   103,   104,   105,   106,
-     107,   108,   109,   110,   115,   116
+      66,    67,    68,    69,    73,    75,    79,    83,    88,    89,
+      90,    91,    95,   100,   104,   105,   106,   107,   108,   109,
+     110,   111,   112,   113,   114,   115,   120,   121
 };
 #endif
 
@@ -553,8 +554,8 @@ static const char *const yytname[] =
   "STRING", "KW_INT", "KW_IF", "KW_FOR", "KW_RETURN", "LPAREN", "RPAREN",
   "LBRACE", "RBRACE", "SEMICOLON", "ASSIGN", "COMMA", "PLUS", "MINUS",
   "MUL", "DIV", "LT", "INCR", "DECR", "$accept", "program", "function",
-  "type", "stmt_list", "compound_stmt", "stmt", "decl_stmt", "if_stmt",
-  "for_init", "for_stmt", "return_stmt", "expr", "expr_list", YY_NULLPTR
+  "type", "stmt_list", "compound_stmt", "stmt", "decl_stmt", "assign_stmt",
+  "if_stmt", "for_init", "for_stmt", "return_stmt", "expr", "expr_list", YY_NULLPTR
 };
 
 static const char *
@@ -564,7 +565,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-54)
+#define YYPACT_NINF (-63)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -578,14 +579,14 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-       1,   -54,    42,   -54,    44,   -54,    36,    33,    37,    96,
-     -54,   -54,    -8,   -54,    64,    59,    66,    32,    25,   -54,
-     -54,   -54,   -54,   -54,    53,     6,   -54,   -54,   -11,    32,
-      20,    61,   -54,   -54,   -54,    32,    32,    32,    32,    32,
-     -54,    40,   -10,   -54,    32,    34,    73,    70,    40,   -54,
-      21,    21,   -54,   -54,    89,   -54,    32,    69,    37,    78,
-      32,    40,   -54,   -54,    32,    77,    40,    32,    45,    37,
-     -54
+      -3,   -63,     5,   -63,     4,   -63,     3,    38,    58,    98,
+     -63,   -63,    -4,   -63,    67,    68,    69,    41,    29,   -63,
+     -63,   -63,   -63,   -63,   -63,    47,    36,    41,   -63,   -63,
+      48,    41,   110,    -6,    55,   -63,   -63,   -63,    41,    41,
+      41,    41,    41,   -63,    91,    -9,    63,   -63,    41,     9,
+      82,    37,    91,   -63,    34,    34,   -63,   -63,   100,   -63,
+      41,   -63,    71,    58,    72,    41,    91,   -63,   -63,    41,
+      79,    91,    41,    39,    58,   -63
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -594,27 +595,27 @@ static const yytype_int8 yypact[] =
 static const yytype_int8 yydefact[] =
 {
        0,     4,     0,     2,     0,     1,     0,     0,     0,     0,
-       3,    29,    31,    30,     0,     0,     0,     0,     0,     5,
-       8,    10,    11,    12,     0,     0,    27,    28,     0,     0,
-      19,     0,     7,     6,     9,     0,     0,     0,     0,     0,
-      32,    34,     0,    14,     0,     0,     0,     0,    18,    21,
-      22,    23,    24,    25,    26,    33,     0,     0,     0,    17,
-       0,    35,    13,    15,     0,     0,    16,     0,     0,     0,
-      20
+       3,    31,    33,    32,     0,     0,     0,     0,     0,     5,
+       8,     9,    11,    12,    13,     0,     0,     0,    29,    30,
+       0,     0,    21,    33,     0,     7,     6,    10,     0,     0,
+       0,     0,     0,    34,    36,     0,     0,    15,     0,     0,
+       0,     0,    20,    23,    24,    25,    26,    27,    28,    35,
+       0,    16,     0,     0,    19,     0,    37,    14,    17,     0,
+       0,    18,     0,     0,     0,    22
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -54,   -54,   -54,   -54,   -54,   -53,    67,   -54,   -54,   -54,
-     -54,   -54,   -17,   -54
+     -63,   -63,   -63,   -63,   -63,   -62,    76,   -63,   -63,   -63,
+     -63,   -63,   -63,   -17,   -63
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     2,     3,     4,    18,    10,    19,    20,    21,    47,
-      22,    23,    24,    42
+       0,     2,     3,     4,    18,    10,    19,    20,    21,    22,
+      51,    23,    24,    25,    45
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -622,32 +623,36 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-      31,    55,    25,    43,    44,    63,    56,     1,    41,    11,
-      12,    13,    45,    48,    26,    27,    70,    40,    50,    51,
-      52,    53,    54,    11,    12,    13,    46,    57,    11,    12,
-      13,    14,    15,    16,    17,    11,    12,    13,    32,    61,
-      37,    38,     5,    65,     8,    58,     7,    66,     6,     9,
-      68,    35,    36,    37,    38,    39,    69,    35,    36,    37,
-      38,    39,    35,    36,    37,    38,    39,    34,    28,    29,
-      35,    36,    37,    38,    39,    49,    30,    59,    35,    36,
-      37,    38,    39,    62,    60,    33,    35,    36,    37,    38,
-      39,    67,     0,    64,    35,    36,    37,    38,    39,    11,
-      12,    13,    14,    15,    16,    17,    35,    36,    37,    38
+      34,    68,    59,     1,    26,     5,    26,    60,     6,    44,
+      46,    27,    75,     7,    49,    52,    28,    29,    28,    29,
+      63,    54,    55,    56,    57,    58,    38,    39,    40,    41,
+      42,    62,    11,    12,    13,    14,    15,    16,    17,    11,
+      33,    13,    35,    66,    11,    33,    13,    43,    70,     8,
+      74,    65,    71,    40,    41,    73,    38,    39,    40,    41,
+      42,    37,    47,    48,    38,    39,    40,    41,    42,    53,
+       9,    30,    38,    39,    40,    41,    42,    61,    31,    32,
+      38,    39,    40,    41,    42,    67,    64,    69,    38,    39,
+      40,    41,    42,    72,    36,     0,    38,    39,    40,    41,
+      42,    11,    12,    13,    14,    15,    16,    17,    38,    39,
+      40,    41,    42,    11,    33,    13,    50,    38,    39,    40,
+      41
 };
 
 static const yytype_int8 yycheck[] =
 {
-      17,    11,    10,    14,    15,    58,    16,     6,    25,     3,
-       4,     5,    29,    30,    22,    23,    69,    11,    35,    36,
-      37,    38,    39,     3,     4,     5,     6,    44,     3,     4,
-       5,     6,     7,     8,     9,     3,     4,     5,    13,    56,
-      19,    20,     0,    60,    11,    11,    10,    64,     4,    12,
-      67,    17,    18,    19,    20,    21,    11,    17,    18,    19,
-      20,    21,    17,    18,    19,    20,    21,    14,     4,    10,
-      17,    18,    19,    20,    21,    14,    10,     4,    17,    18,
-      19,    20,    21,    14,    14,    18,    17,    18,    19,    20,
-      21,    14,    -1,    15,    17,    18,    19,    20,    21,     3,
-       4,     5,     6,     7,     8,     9,    17,    18,    19,    20
+      17,    63,    11,     6,    10,     0,    10,    16,     4,    26,
+      27,    15,    74,    10,    31,    32,    22,    23,    22,    23,
+      11,    38,    39,    40,    41,    42,    17,    18,    19,    20,
+      21,    48,     3,     4,     5,     6,     7,     8,     9,     3,
+       4,     5,    13,    60,     3,     4,     5,    11,    65,    11,
+      11,    14,    69,    19,    20,    72,    17,    18,    19,    20,
+      21,    14,    14,    15,    17,    18,    19,    20,    21,    14,
+      12,     4,    17,    18,    19,    20,    21,    14,    10,    10,
+      17,    18,    19,    20,    21,    14,     4,    15,    17,    18,
+      19,    20,    21,    14,    18,    -1,    17,    18,    19,    20,
+      21,     3,     4,     5,     6,     7,     8,     9,    17,    18,
+      19,    20,    21,     3,     4,     5,     6,    17,    18,    19,
+      20
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
@@ -656,30 +661,30 @@ static const yytype_int8 yystos[] =
 {
        0,     6,    25,    26,    27,     0,     4,    10,    11,    12,
       29,     3,     4,     5,     6,     7,     8,     9,    28,    30,
-      31,    32,    34,    35,    36,    10,    22,    23,     4,    10,
-      10,    36,    13,    30,    14,    17,    18,    19,    20,    21,
-      11,    36,    37,    14,    15,    36,     6,    33,    36,    14,
-      36,    36,    36,    36,    36,    11,    16,    36,    11,     4,
-      14,    36,    14,    29,    15,    36,    36,    14,    36,    11,
-      29
+      31,    32,    33,    35,    36,    37,    10,    15,    22,    23,
+       4,    10,    10,     4,    37,    13,    30,    14,    17,    18,
+      19,    20,    21,    11,    37,    38,    37,    14,    15,    37,
+       6,    34,    37,    14,    37,    37,    37,    37,    37,    11,
+      16,    14,    37,    11,     4,    14,    37,    14,    29,    15,
+      37,    37,    14,    37,    11,    29
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
        0,    24,    25,    26,    27,    28,    28,    29,    30,    30,
-      30,    30,    30,    31,    31,    32,    33,    33,    33,    33,
-      34,    35,    36,    36,    36,    36,    36,    36,    36,    36,
-      36,    36,    36,    36,    37,    37
+      30,    30,    30,    30,    31,    31,    32,    33,    34,    34,
+      34,    34,    35,    36,    37,    37,    37,    37,    37,    37,
+      37,    37,    37,    37,    37,    37,    38,    38
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
-       0,     2,     1,     5,     1,     1,     2,     3,     1,     2,
-       1,     1,     1,     5,     3,     5,     4,     2,     1,     0,
-       9,     3,     3,     3,     3,     3,     3,     2,     2,     1,
-       1,     1,     3,     4,     1,     3
+       0,     2,     1,     5,     1,     1,     2,     3,     1,     1,
+       2,     1,     1,     1,     5,     3,     4,     5,     4,     2,
+       1,     0,     9,     3,     3,     3,     3,     3,     3,     2,
+       2,     1,     1,     1,     3,     4,     1,     3
 };
 
 
@@ -1145,209 +1150,221 @@ yyreduce:
   case 2: /* program: function  */
 #line 42 "parser.y"
                                         { ast_root = (yyvsp[0].node); }
-#line 1149 "parser.tab.c"
+#line 1154 "parser.tab.c"
     break;
 
   case 3: /* function: type IDENTIFIER LPAREN RPAREN compound_stmt  */
 #line 47 "parser.y"
                                         { (yyval.node) = make_function_node((yyvsp[-3].str), (yyvsp[0].node)); }
-#line 1155 "parser.tab.c"
+#line 1160 "parser.tab.c"
     break;
 
   case 4: /* type: KW_INT  */
 #line 51 "parser.y"
                                         { (yyval.node) = make_type_node("int"); }
-#line 1161 "parser.tab.c"
+#line 1166 "parser.tab.c"
     break;
 
   case 5: /* stmt_list: stmt  */
 #line 55 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1167 "parser.tab.c"
+#line 1172 "parser.tab.c"
     break;
 
   case 6: /* stmt_list: stmt_list stmt  */
 #line 56 "parser.y"
                                         { (yyval.node) = make_seq_node((yyvsp[-1].node), (yyvsp[0].node)); }
-#line 1173 "parser.tab.c"
+#line 1178 "parser.tab.c"
     break;
 
   case 7: /* compound_stmt: LBRACE stmt_list RBRACE  */
 #line 60 "parser.y"
                                         { (yyval.node) = (yyvsp[-1].node); }
-#line 1179 "parser.tab.c"
+#line 1184 "parser.tab.c"
     break;
 
   case 8: /* stmt: decl_stmt  */
 #line 64 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1185 "parser.tab.c"
+#line 1190 "parser.tab.c"
     break;
 
-  case 9: /* stmt: expr SEMICOLON  */
+  case 9: /* stmt: assign_stmt  */
 #line 65 "parser.y"
-                                        { (yyval.node) = (yyvsp[-1].node); }
-#line 1191 "parser.tab.c"
+                                        { (yyval.node) = (yyvsp[0].node); }
+#line 1196 "parser.tab.c"
     break;
 
-  case 10: /* stmt: if_stmt  */
+  case 10: /* stmt: expr SEMICOLON  */
 #line 66 "parser.y"
-                                        { (yyval.node) = (yyvsp[0].node); }
-#line 1197 "parser.tab.c"
+                                        { (yyval.node) = (yyvsp[-1].node); }
+#line 1202 "parser.tab.c"
     break;
 
-  case 11: /* stmt: for_stmt  */
+  case 11: /* stmt: if_stmt  */
 #line 67 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1203 "parser.tab.c"
+#line 1208 "parser.tab.c"
     break;
 
-  case 12: /* stmt: return_stmt  */
+  case 12: /* stmt: for_stmt  */
 #line 68 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1209 "parser.tab.c"
+#line 1214 "parser.tab.c"
     break;
 
-  case 13: /* decl_stmt: KW_INT IDENTIFIER ASSIGN expr SEMICOLON  */
-#line 73 "parser.y"
-                                        { (yyval.node) = make_decl_node((yyvsp[-3].str), (yyvsp[-1].node)); }
-#line 1215 "parser.tab.c"
+  case 13: /* stmt: return_stmt  */
+#line 69 "parser.y"
+                                        { (yyval.node) = (yyvsp[0].node); }
+#line 1220 "parser.tab.c"
     break;
 
-  case 14: /* decl_stmt: KW_INT IDENTIFIER SEMICOLON  */
+  case 14: /* decl_stmt: KW_INT IDENTIFIER ASSIGN expr SEMICOLON  */
 #line 74 "parser.y"
+                                        { (yyval.node) = make_decl_node((yyvsp[-3].str), (yyvsp[-1].node)); }
+#line 1226 "parser.tab.c"
+    break;
+
+  case 15: /* decl_stmt: KW_INT IDENTIFIER SEMICOLON  */
+#line 75 "parser.y"
                                         { (yyval.node) = make_decl_node((yyvsp[-1].str), NULL); }
-#line 1221 "parser.tab.c"
+#line 1232 "parser.tab.c"
     break;
 
-  case 15: /* if_stmt: KW_IF LPAREN expr RPAREN compound_stmt  */
+  case 16: /* assign_stmt: IDENTIFIER ASSIGN expr SEMICOLON  */
 #line 79 "parser.y"
+                                        { (yyval.node) = make_assign_node((yyvsp[-3].str), (yyvsp[-1].node)); }
+#line 1238 "parser.tab.c"
+    break;
+
+  case 17: /* if_stmt: KW_IF LPAREN expr RPAREN compound_stmt  */
+#line 84 "parser.y"
                                         { (yyval.node) = make_if_node((yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1227 "parser.tab.c"
+#line 1244 "parser.tab.c"
     break;
 
-  case 16: /* for_init: KW_INT IDENTIFIER ASSIGN expr  */
-#line 83 "parser.y"
+  case 18: /* for_init: KW_INT IDENTIFIER ASSIGN expr  */
+#line 88 "parser.y"
                                         { (yyval.node) = make_decl_node((yyvsp[-2].str), (yyvsp[0].node)); }
-#line 1233 "parser.tab.c"
+#line 1250 "parser.tab.c"
     break;
 
-  case 17: /* for_init: KW_INT IDENTIFIER  */
-#line 84 "parser.y"
+  case 19: /* for_init: KW_INT IDENTIFIER  */
+#line 89 "parser.y"
                                         { (yyval.node) = make_decl_node((yyvsp[0].str), NULL); }
-#line 1239 "parser.tab.c"
+#line 1256 "parser.tab.c"
     break;
 
-  case 18: /* for_init: expr  */
-#line 85 "parser.y"
+  case 20: /* for_init: expr  */
+#line 90 "parser.y"
                                         { (yyval.node) = (yyvsp[0].node); }
-#line 1245 "parser.tab.c"
+#line 1262 "parser.tab.c"
     break;
 
-  case 19: /* for_init: %empty  */
-#line 86 "parser.y"
+  case 21: /* for_init: %empty  */
+#line 91 "parser.y"
                                         { (yyval.node) = NULL; }
-#line 1251 "parser.tab.c"
+#line 1268 "parser.tab.c"
     break;
 
-  case 20: /* for_stmt: KW_FOR LPAREN for_init SEMICOLON expr SEMICOLON expr RPAREN compound_stmt  */
-#line 91 "parser.y"
+  case 22: /* for_stmt: KW_FOR LPAREN for_init SEMICOLON expr SEMICOLON expr RPAREN compound_stmt  */
+#line 96 "parser.y"
                                         { (yyval.node) = make_for_node((yyvsp[-6].node), (yyvsp[-4].node), (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1257 "parser.tab.c"
+#line 1274 "parser.tab.c"
     break;
 
-  case 21: /* return_stmt: KW_RETURN expr SEMICOLON  */
-#line 95 "parser.y"
+  case 23: /* return_stmt: KW_RETURN expr SEMICOLON  */
+#line 100 "parser.y"
                                         { (yyval.node) = make_return_node((yyvsp[-1].node)); }
-#line 1263 "parser.tab.c"
+#line 1280 "parser.tab.c"
     break;
 
-  case 22: /* expr: expr PLUS expr  */
-#line 99 "parser.y"
-                                        { (yyval.node) = make_binop_node('+', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1269 "parser.tab.c"
+  case 24: /* expr: expr PLUS expr  */
+#line 104 "parser.y"
+                                        { (yyval.node) = make_binop_node(OP_ADD, (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1286 "parser.tab.c"
     break;
 
-  case 23: /* expr: expr MINUS expr  */
-#line 100 "parser.y"
-                                        { (yyval.node) = make_binop_node('-', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1275 "parser.tab.c"
+  case 25: /* expr: expr MINUS expr  */
+#line 105 "parser.y"
+                                        { (yyval.node) = make_binop_node(OP_SUB, (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1292 "parser.tab.c"
     break;
 
-  case 24: /* expr: expr MUL expr  */
-#line 101 "parser.y"
-                                        { (yyval.node) = make_binop_node('*', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1281 "parser.tab.c"
+  case 26: /* expr: expr MUL expr  */
+#line 106 "parser.y"
+                                        { (yyval.node) = make_binop_node(OP_MUL, (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1298 "parser.tab.c"
     break;
 
-  case 25: /* expr: expr DIV expr  */
-#line 102 "parser.y"
-                                        { (yyval.node) = make_binop_node('/', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1287 "parser.tab.c"
+  case 27: /* expr: expr DIV expr  */
+#line 107 "parser.y"
+                                        { (yyval.node) = make_binop_node(OP_DIV, (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1304 "parser.tab.c"
     break;
 
-  case 26: /* expr: expr LT expr  */
-#line 103 "parser.y"
-                                        { (yyval.node) = make_binop_node('<', (yyvsp[-2].node), (yyvsp[0].node)); }
-#line 1293 "parser.tab.c"
+  case 28: /* expr: expr LT expr  */
+#line 108 "parser.y"
+                                        { (yyval.node) = make_binop_node(OP_LT, (yyvsp[-2].node), (yyvsp[0].node)); }
+#line 1310 "parser.tab.c"
     break;
 
-  case 27: /* expr: IDENTIFIER INCR  */
-#line 104 "parser.y"
-                                        { (yyval.node) = make_unary_node("++", make_var_node((yyvsp[-1].str))); }
-#line 1299 "parser.tab.c"
+  case 29: /* expr: IDENTIFIER INCR  */
+#line 109 "parser.y"
+                                        { (yyval.node) = make_unary_node(OP_INC, make_var_node((yyvsp[-1].str))); }
+#line 1316 "parser.tab.c"
     break;
 
-  case 28: /* expr: IDENTIFIER DECR  */
-#line 105 "parser.y"
-                                        { (yyval.node) = make_unary_node("--", make_var_node((yyvsp[-1].str))); }
-#line 1305 "parser.tab.c"
+  case 30: /* expr: IDENTIFIER DECR  */
+#line 110 "parser.y"
+                                        { (yyval.node) = make_unary_node(OP_DEC, make_var_node((yyvsp[-1].str))); }
+#line 1322 "parser.tab.c"
     break;
 
-  case 29: /* expr: NUMBER  */
-#line 106 "parser.y"
+  case 31: /* expr: NUMBER  */
+#line 111 "parser.y"
                                         { (yyval.node) = make_int_node((yyvsp[0].ival)); }
-#line 1311 "parser.tab.c"
+#line 1328 "parser.tab.c"
     break;
 
-  case 30: /* expr: STRING  */
-#line 107 "parser.y"
+  case 32: /* expr: STRING  */
+#line 112 "parser.y"
                                         { (yyval.node) = make_string_node((yyvsp[0].str)); }
-#line 1317 "parser.tab.c"
+#line 1334 "parser.tab.c"
     break;
 
-  case 31: /* expr: IDENTIFIER  */
-#line 108 "parser.y"
+  case 33: /* expr: IDENTIFIER  */
+#line 113 "parser.y"
                                         { (yyval.node) = make_var_node((yyvsp[0].str)); }
-#line 1323 "parser.tab.c"
+#line 1340 "parser.tab.c"
     break;
 
-  case 32: /* expr: IDENTIFIER LPAREN RPAREN  */
-#line 109 "parser.y"
+  case 34: /* expr: IDENTIFIER LPAREN RPAREN  */
+#line 114 "parser.y"
                                         { (yyval.node) = make_func_call_node((yyvsp[-2].str), NULL); }
-#line 1329 "parser.tab.c"
+#line 1346 "parser.tab.c"
     break;
 
-  case 33: /* expr: IDENTIFIER LPAREN expr_list RPAREN  */
-#line 111 "parser.y"
+  case 35: /* expr: IDENTIFIER LPAREN expr_list RPAREN  */
+#line 116 "parser.y"
                                         { (yyval.node) = make_func_call_node((yyvsp[-3].str), (yyvsp[-1].node)); }
-#line 1335 "parser.tab.c"
+#line 1352 "parser.tab.c"
     break;
 
-  case 34: /* expr_list: expr  */
-#line 115 "parser.y"
+  case 36: /* expr_list: expr  */
+#line 120 "parser.y"
                                         { (yyval.node) = make_expr_list_node((yyvsp[0].node), NULL); }
-#line 1341 "parser.tab.c"
+#line 1358 "parser.tab.c"
     break;
 
-  case 35: /* expr_list: expr_list COMMA expr  */
-#line 116 "parser.y"
+  case 37: /* expr_list: expr_list COMMA expr  */
+#line 121 "parser.y"
                                         { (yyval.node) = make_expr_list_node((yyvsp[0].node), (yyvsp[-2].node)); }
-#line 1347 "parser.tab.c"
+#line 1364 "parser.tab.c"
     break;
 
 
-#line 1351 "parser.tab.c"
+#line 1368 "parser.tab.c"
 
       default: break;
     }
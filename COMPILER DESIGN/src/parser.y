@@ -27,7 +27,7 @@ ASTNode* ast_root;
 %token PLUS MINUS MUL DIV LT
 %token INCR DECR
 
-%type <node> stmt stmt_list compound_stmt expr expr_list decl_stmt
+%type <node> stmt stmt_list compound_stmt expr expr_list decl_stmt assign_stmt
                if_stmt for_stmt return_stmt function type program for_init
 
 %left LT
@@ -62,6 +62,7 @@ compound_stmt:
 
 stmt:
       decl_stmt                         { $$ = $1; }
+    | assign_stmt                       { $$ = $1; }
     | expr SEMICOLON                    { $$ = $1; }
     | if_stmt                           { $$ = $1; }
     | for_stmt                          { $$ = $1; }
@@ -74,6 +75,10 @@ decl_stmt:
     | KW_INT IDENTIFIER SEMICOLON       { $$ = make_decl_node($2, NULL); }
     ;
 
+assign_stmt:
+      IDENTIFIER ASSIGN expr SEMICOLON  { $$ = make_assign_node($1, $3); }
+    ;
+
 if_stmt:
       KW_IF LPAREN expr RPAREN compound_stmt
                                         { $$ = make_if_node($3, $5); }
@@ -96,13 +101,13 @@ return_stmt:
     ;
 
 expr:
-      expr PLUS expr                    { $$ = make_binop_node('+', $1, $3); }
-    | expr MINUS expr                   { $$ = make_binop_node('-', $1, $3); }
-    | expr MUL expr                     { $$ = make_binop_node('*', $1, $3); }
-    | expr DIV expr                     { $$ = make_binop_node('/', $1, $3); }
-    | expr LT expr                      { $$ = make_binop_node('<', $1, $3); }
-    | IDENTIFIER INCR                   { $$ = make_unary_node("++", make_var_node($1)); }
-    | IDENTIFIER DECR                   { $$ = make_unary_node("--", make_var_node($1)); }
+      expr PLUS expr                    { $$ = make_binop_node(OP_ADD, $1, $3); }
+    | expr MINUS expr                   { $$ = make_binop_node(OP_SUB, $1, $3); }
+    | expr MUL expr                     { $$ = make_binop_node(OP_MUL, $1, $3); }
+    | expr DIV expr                     { $$ = make_binop_node(OP_DIV, $1, $3); }
+    | expr LT expr                      { $$ = make_binop_node(OP_LT, $1, $3); }
+    | IDENTIFIER INCR                   { $$ = make_unary_node(OP_INC, make_var_node($1)); }
+    | IDENTIFIER DECR                   { $$ = make_unary_node(OP_DEC, make_var_node($1)); }
     | NUMBER                            { $$ = make_int_node($1); }
     | STRING                            { $$ = make_string_node($1); }
     | IDENTIFIER                        { $$ = make_var_node($1); }
@@ -0,0 +1,158 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "cache.h"
+
+/* Execution profile shared by ast_to_c, which instruments a program to
+   record one, and ast_optimize, which reads it back. A site is a
+   FUNCTION_DEF, IF_STMT or FOR_STMT of the unoptimized AST, named by the
+   Merkle hash of its subtree, so a profile stays valid for the parts of a
+   program that did not change. Identical subtrees are told apart by their
+   order in the walk (see profile_site_key). Each line of the file holds
+
+       <key in hex> <runs> <hits>
+
+   where runs counts calls of a function, evaluations of an if condition
+   or entries into a loop, and hits counts taken branches or loop
+   iterations. The instrumented program appends one line per site on
+   every run, and loading sums the lines of a key, so runs accumulate
+   until the file is deleted. */
+
+#define PROFILE_DEFAULT_PATH "profile.txt"
+
+typedef struct {
+    uint64_t key;
+    unsigned long runs;
+    unsigned long hits;
+} ProfileEntry;
+
+typedef struct {
+    ProfileEntry *entries;  /* sorted by key, one per key */
+    int count;
+    uint64_t digest;        /* hash of the contents, for cache keys */
+} Profile;
+
+static inline int profile_compare_key(const void *a, const void *b) {
+    const ProfileEntry *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return 0;
+}
+
+/* Read a profile; returns 0 when the file cannot be read */
+static inline int profile_load(Profile *profile, const char *path) {
+    memset(profile, 0, sizeof(*profile));
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int capacity = 0;
+    unsigned long long key;
+    unsigned long runs, hits;
+    while (fscanf(f, "%llx %lu %lu", &key, &runs, &hits) == 3) {
+        if (profile->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            ProfileEntry *grown = realloc(profile->entries, capacity * sizeof(ProfileEntry));
+            if (!grown) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            profile->entries = grown;
+        }
+        profile->entries[profile->count].key = key;
+        profile->entries[profile->count].runs = runs;
+        profile->entries[profile->count].hits = hits;
+        profile->count++;
+    }
+    fclose(f);
+
+    /* Merge the records of repeated runs */
+    if (profile->count > 0)
+        qsort(profile->entries, profile->count, sizeof(ProfileEntry), profile_compare_key);
+    int merged = 0;
+    for (int i = 0; i < profile->count; i++) {
+        ProfileEntry *e = &profile->entries[i];
+        if (merged > 0 && profile->entries[merged - 1].key == e->key) {
+            profile->entries[merged - 1].runs += e->runs;
+            profile->entries[merged - 1].hits += e->hits;
+        } else {
+            profile->entries[merged++] = *e;
+        }
+    }
+    profile->count = merged;
+
+    uint64_t h = cache_hash_string(CACHE_HASH_SEED, "profile");
+    for (int i = 0; i < profile->count; i++) {
+        h = cache_hash_bytes(h, &profile->entries[i].key, sizeof(uint64_t));
+        h = cache_hash_int(h, (long)profile->entries[i].runs);
+        h = cache_hash_int(h, (long)profile->entries[i].hits);
+    }
+    profile->digest = h;
+    return 1;
+}
+
+/* Counts recorded for a site, or NULL */
+static inline ProfileEntry *profile_find(Profile *profile, uint64_t key) {
+    ProfileEntry probe = { key, 0, 0 };
+    if (profile->count == 0) return NULL;
+    return bsearch(&probe, profile->entries, profile->count, sizeof(ProfileEntry),
+                   profile_compare_key);
+}
+
+static inline void profile_free(Profile *profile) {
+    free(profile->entries);
+    profile->entries = NULL;
+    profile->count = 0;
+}
+
+/* How many sites of each subtree hash a walk has met so far */
+typedef struct {
+    uint64_t *hashes;
+    unsigned *seen;         /* 0 marks an empty slot */
+    size_t capacity, used;
+} SiteCounter;
+
+/* Key of the next site with the given subtree hash. The first site of a
+   hash is keyed by the hash itself, and a later identical subtree by the
+   hash and how many came before it, so two identical loops get separate
+   counters. Both tools walk the tree in the same order (children first,
+   left to right), so they agree on every key. */
+static inline uint64_t profile_site_key(SiteCounter *counter, uint64_t subtree) {
+    if (counter->used * 2 >= counter->capacity) {
+        SiteCounter grown = { NULL, NULL, counter->capacity ? counter->capacity * 2 : 64, 0 };
+        grown.hashes = malloc(grown.capacity * sizeof(uint64_t));
+        grown.seen = calloc(grown.capacity, sizeof(unsigned));
+        if (!grown.hashes || !grown.seen) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < counter->capacity; i++) {
+            if (!counter->seen[i]) continue;
+            size_t slot = counter->hashes[i] & (grown.capacity - 1);
+            while (grown.seen[slot]) slot = (slot + 1) & (grown.capacity - 1);
+            grown.hashes[slot] = counter->hashes[i];
+            grown.seen[slot] = counter->seen[i];
+        }
+        grown.used = counter->used;
+        free(counter->hashes);
+        free(counter->seen);
+        *counter = grown;
+    }
+    size_t slot = subtree & (counter->capacity - 1);
+    while (counter->seen[slot] && counter->hashes[slot] != subtree)
+        slot = (slot + 1) & (counter->capacity - 1);
+    if (!counter->seen[slot]) {
+        counter->hashes[slot] = subtree;
+        counter->used++;
+    }
+    unsigned before = counter->seen[slot]++;
+    return before == 0 ? subtree : cache_hash_int(subtree, (long)before);
+}
+
+static inline void site_counter_free(SiteCounter *counter) {
+    free(counter->hashes);
+    free(counter->seen);
+    memset(counter, 0, sizeof(*counter));
+}
+
+#endif
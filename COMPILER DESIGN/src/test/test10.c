@@ -0,0 +1,22 @@
+int main() {
+    int n = 3;
+    int s = 0;
+    int t = 0;
+    if (5 < putchar(10)) {
+        n = 1000;
+    }
+    for (int i = 0; i < n; i++) {
+        s = s + i;
+    }
+    for (int j = 0; j < n; j++) {
+        printf("%d\n", j);
+    }
+    for (int i = 0; i < n; i++) {
+        s = s + i;
+    }
+    for (int j = 0; j < n; j++) {
+        t = t + j * j;
+    }
+    printf("%d %d\n", s, t);
+    return 0;
+}
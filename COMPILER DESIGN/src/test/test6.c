@@ -0,0 +1,16 @@
+int main()
+{
+    int a = 0;
+
+    for (int i = a; i < 3; i++)
+    {
+        a = a + 1;
+    }
+
+    for (int j = a; j < 3; j++)
+    {
+        printf("x\n");
+    }
+
+    return 0;
+}
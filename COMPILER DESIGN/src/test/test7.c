@@ -0,0 +1,18 @@
+int main()
+{
+    int a = 0;
+    int b = 0;
+
+    for (int i = 0; i < putchar(99) - 97; i++)
+    {
+        a++;
+    }
+
+    for (int i = 0; i < putchar(99) - 97; i++)
+    {
+        b++;
+    }
+
+    printf("\n%d %d\n", a, b);
+    return 0;
+}
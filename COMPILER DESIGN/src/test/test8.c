@@ -0,0 +1,18 @@
+int main()
+{
+    int a = 0;
+    int b = 0;
+
+    for (int i = putchar(66) - 66; i < 3; i++)
+    {
+        a++;
+    }
+
+    for (int i = putchar(66) - 66; i < 3; i++)
+    {
+        b++;
+    }
+
+    printf("\n%d %d\n", a, b);
+    return 0;
+}
@@ -0,0 +1,21 @@
+int main() {
+    int big = 2147483000;
+    int t = 3;
+    int s = 0;
+    if (putchar(10) < 5) {
+        t = 4;
+        big = putchar(33);
+    }
+    for (int i = 0; i < t; i++) {
+        if (i < t - 3) {
+            s = s + big * 2;
+        }
+        s = s + i;
+    }
+    for (int j = 0; j < t; j++) {
+        printf("%d\n", j);
+        s = s + big / 1000;
+    }
+    printf("%d\n", s);
+    return 0;
+}